@@ -0,0 +1,197 @@
+#!/bin/bash
+
+################################################################################
+# READ ME                                                                      #
+#------------------------------------------------------------------------------#
+# MOTIVATION                                                                   #
+# A single wall time on a single configuration says little about an           #
+# optimisation: it may help one grid size and hurt another, scale with threads #
+# but not with processes, or just be noise. This script runs the C CPU         #
+# versions over a matrix of grid sizes, OpenMP thread counts, MPI process      #
+# counts and stencil kernels, on the local machine, so that the same matrix    #
+# can be run before and after every change.                                    #
+#                                                                              #
+# HOW IT WORKS                                                                 #
+# Each configuration runs a fixed number of iterations (the tolerance is set   #
+# so low that the simulation never converges), once to warm up then several   #
+# times; the best and average times are kept. Times come from the performance  #
+# report of the applications (--profile), which is more precise than the      #
+# 'Total time' line, and so does the number of cells the stencil updated,      #
+# which leaves out the cells the heat has not reached yet. For each            #
+# configuration it reports:                                                    #
+# - the millions of cells updated per second;                                  #
+# - the memory bandwidth achieved, counting 16 bytes per cell updated, and its #
+#   fraction of the copy bandwidth measured by a STREAM-style run beforehand;  #
+# - the parallel efficiency against the serial version on the same grid size  #
+#   and kernel: serial time / (processes x threads x time).                    #
+# Results are printed and written as CSV.                                      #
+#                                                                              #
+# PARAMETERS                                                                   #
+# They are all optional environment variables:                                 #
+# - BENCHMARK_VERSIONS: versions to run, 'serial openmp mpi hybrid_cpu'.       #
+# - BENCHMARK_SIZES: grid sizes (square), '672 2048'.                          #
+# - BENCHMARK_THREADS: OpenMP thread counts, '1 2 4'.                          #
+# - BENCHMARK_PROCESSES: MPI process counts, '1 2 4'.                          #
+# - BENCHMARK_KERNELS: kernels, see LAPLACE_KERNEL, 'scalar avx2 avx512';      #
+#   those the processor does not support are skipped.                          #
+# - BENCHMARK_ITERATIONS: iterations per run, 1000.                            #
+# - BENCHMARK_REPETITIONS: timed runs per configuration, 3.                    #
+# - BENCHMARK_MPIRUN: command launching MPI processes, 'mpirun'.               #
+# - BENCHMARK_OUTPUT: CSV file to write, 'benchmark.csv'.                      #
+#                                                                              #
+# EXAMPLES                                                                     #
+# make benchmark                                                               #
+# BENCHMARK_SIZES="672" BENCHMARK_KERNELS="avx2" ./benchmark.sh                #
+################################################################################
+
+function echo_good
+{
+	echo -e "\033[32m$1\033[0m\c"
+}
+
+function echo_bad
+{
+	echo -e "\033[31m$1\033[0m\c"
+}
+
+function echo_warning
+{
+	echo -e "\033[33m$1\033[0m\c"
+}
+
+function echo_success
+{
+	echo_good "[SUCCESS]"
+	echo " $1"
+}
+
+function echo_failure
+{
+	echo_bad "[FAILURE]"
+	echo " $1"
+	exit -1
+}
+
+function echo_skipped
+{
+	echo_warning "[SKIPPED]"
+	echo " $1"
+}
+
+versions=${BENCHMARK_VERSIONS:-"serial openmp mpi hybrid_cpu"};
+sizes=${BENCHMARK_SIZES:-"672 2048"};
+thread_counts=${BENCHMARK_THREADS:-"1 2 4"};
+process_counts=${BENCHMARK_PROCESSES:-"1 2 4"};
+kernels=${BENCHMARK_KERNELS:-"scalar avx2 avx512"};
+iterations=${BENCHMARK_ITERATIONS:-1000};
+repetitions=${BENCHMARK_REPETITIONS:-3};
+mpirun=${BENCHMARK_MPIRUN:-"mpirun"};
+output=${BENCHMARK_OUTPUT:-"benchmark.csv"};
+profile=`mktemp --suffix=.json`;
+trap "rm -f ${profile}" EXIT;
+
+#############################################
+# Measure the memory bandwidth of this node #
+#############################################
+stream="./bin/C/stream";
+if [ ! -f "${stream}" ]; then
+	echo_failure "The executable ${stream} does not exist, please run 'make benchmark'.";
+fi
+max_threads=1;
+for threads in ${thread_counts}; do
+	if [ "${threads}" -gt "${max_threads}" ]; then
+		max_threads=${threads};
+	fi
+done
+stream_gbs=`OMP_NUM_THREADS=${max_threads} ${stream} | awk '$1 == "copy_gbs" { print $2 }'`;
+if [ -z "${stream_gbs}" ]; then
+	echo_failure "The STREAM-style measurement failed.";
+fi
+echo_success "Copy bandwidth measured with ${max_threads} threads: ${stream_gbs} GB/s.";
+
+####################################
+# Run every configuration required #
+####################################
+# Runs a configuration and prints its best and average times, then the number of cells the stencil updated, or nothing
+# if it failed.
+# Parameters: the command to run.
+function measure
+{
+	local command="$1";
+	local times="";
+	local cells="";
+	for (( r = 0; r <= ${repetitions}; r++ )); do
+		rm -f ${profile};
+		if ! eval ${command} --profile ${profile} > /dev/null 2>&1; then
+			return;
+		fi
+		local seconds=`awk -F'[:,]' '/"total_seconds"/ { print $2 }' ${profile}`;
+		cells=`awk -F'[:, ]+' '/"cells"/ { print $3 }' ${profile}`;
+		if [ -z "${seconds}" ] || [ -z "${cells}" ]; then
+			return;
+		fi
+		# The first run only warms up
+		if [ "${r}" -gt "0" ]; then
+			times="${times} ${seconds}";
+		fi
+	done
+	echo ${times} | awk -v cells=${cells} '{ best = $1; sum = 0; for(i = 1; i <= NF; i++) { if($i < best) best = $i; sum += $i; } printf("%.6f %.6f %s", best, sum / NF, cells); }';
+}
+
+echo "version,size,processes,threads,kernel,iterations,cells,best_seconds,average_seconds,mcells_per_second,gbs,stream_fraction,parallel_efficiency" > ${output};
+printf "%-10s %6s %9s %7s %7s %10s %10s %8s %7s %10s\n" "VERSION" "SIZE" "PROCESSES" "THREADS" "KERNEL" "BEST (s)" "MCELLS/S" "GB/S" "STREAM" "EFFICIENCY";
+for size in ${sizes}; do
+	for kernel in ${kernels}; do
+		serial_seconds="";
+		for version in ${versions}; do
+			executable="./bin/C/${version}_small";
+			if [ ! -f "${executable}" ]; then
+				echo_skipped "The executable ${executable} does not exist.";
+				continue;
+			fi
+
+			# Configurations of processes and threads that make sense for this version
+			configurations="";
+			case ${version} in
+				serial) configurations="1x1";;
+				openmp) for t in ${thread_counts}; do configurations="${configurations} 1x${t}"; done;;
+				mpi) for p in ${process_counts}; do configurations="${configurations} ${p}x1"; done;;
+				hybrid_cpu) for p in ${process_counts}; do for t in ${thread_counts}; do configurations="${configurations} ${p}x${t}"; done; done;;
+			esac
+
+			for configuration in ${configurations}; do
+				processes=${configuration%x*};
+				threads=${configuration#*x};
+				arguments="--rows ${size} --columns ${size} --tolerance 1e-300 --max-iterations ${iterations}";
+				case ${version} in
+					serial) command="LAPLACE_KERNEL=${kernel} ${executable} ${arguments}";;
+					openmp) command="LAPLACE_KERNEL=${kernel} OMP_NUM_THREADS=${threads} ${executable} ${arguments}";;
+					*) command="${mpirun} -n ${processes} -x LAPLACE_KERNEL=${kernel} -x OMP_NUM_THREADS=${threads} ${executable} ${arguments}";;
+				esac
+
+				result=`measure "${command}"`;
+				if [ -z "${result}" ]; then
+					echo_skipped "${version} on ${size}x${size} with ${processes} processes, ${threads} threads and the ${kernel} kernel failed or is not supported.";
+					continue;
+				fi
+				read best average cells <<< "${result}";
+				if [ "${version}" == "serial" ]; then
+					serial_seconds=${best};
+				fi
+
+				# Only the cells the stencil updated count, not size x size per iteration
+				line=`awk -v cells=${cells} -v best=${best} -v stream=${stream_gbs} -v serial=${serial_seconds} -v workers=$((processes * threads)) 'BEGIN {
+					gbs = cells * 16 / best / 1e9;
+					efficiency = (serial == "") ? "n/a" : sprintf("%.3f", serial / (workers * best));
+					printf("%.1f %.3f %.3f %s", cells / best / 1e6, gbs, gbs / stream, efficiency);
+				}'`;
+				read mcells gbs fraction efficiency <<< "${line}";
+				# The simulation stops after the iteration following the maximum
+				echo "${version},${size},${processes},${threads},${kernel},$((iterations + 1)),${cells},${best},${average},${mcells},${gbs},${fraction},${efficiency}" >> ${output};
+				printf "%-10s %6s %9s %7s %7s %10s %10s %8s %7s %10s\n" "${version}" "${size}" "${processes}" "${threads}" "${kernel}" "${best}" "${mcells}" "${gbs}" "${fraction}" "${efficiency}";
+			done
+		done
+	done
+done
+
+echo_success "Results written to ${output}.";
@@ -0,0 +1,234 @@
+/**
+ * @file checkpoint.c
+ **/
+
+#include "checkpoint.h"
+#include "util.h"
+#include "decomposition.h"
+#include "profile.h"
+#include "progress.h"
+#include <mpi.h> // MPI_*
+#include <stdio.h> // printf, fprintf, rename
+#include <stdlib.h> // malloc, free, EXIT_FAILURE
+#include <string.h> // memcpy, memcmp, strlen, strcpy, strcat
+
+/// The fixed part of a checkpoint, see checkpoint.h.
+typedef struct
+{
+	/// CHECKPOINT_MAGIC, without its terminating null character.
+	char magic[8];
+	/// The number of rows (excluding boundaries) of the grid.
+	int rows_global;
+	/// The number of columns (excluding boundaries) of the grid.
+	int columns_global;
+	/// The iteration completed.
+	int iteration;
+	/// The number of iterations between two progress printings.
+	int print_frequency;
+	/// The temperature change across all MPI processes at that iteration.
+	double dt_global;
+} checkpoint_header;
+
+/// The cells printed at each multiple of PRINT_FREQUENCY so far, on the MPI process holding the bottom-right tile.
+static double* checkpoint_progress = NULL;
+/// My tile within the temperatures of a checkpoint.
+static MPI_Datatype checkpoint_file_tile = MPI_DATATYPE_NULL;
+/// My tile within a grid, halos excluded.
+static MPI_Datatype checkpoint_grid_tile = MPI_DATATYPE_NULL;
+/// Whether my MPI process holds the bottom-right tile, and therefore tracks progress.
+static int checkpoint_tracking = 0;
+/// The number of checkpoints written.
+static int checkpoint_count = 0;
+/// The time spent writing them, in microseconds.
+static double checkpoint_time = 0.0;
+
+/**
+ * @brief Aborts the program if an MPI-IO call failed, since file errors are returned rather than fatal by default.
+ * @param[in] error The error code returned.
+ * @param[in] what What was being done, for the error message.
+ * @param[in] path The file concerned.
+ **/
+static void checkpoint_check(int error, const char* what, const char* path)
+{
+	if(error != MPI_SUCCESS)
+	{
+		char message[MPI_MAX_ERROR_STRING];
+		int length;
+		MPI_Error_string(error, message, &length);
+		printf("Failed to %s checkpoint %s: %s.\n", what, path, message);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+}
+
+/**
+ * @brief Gives the offset, in the file, of the temperatures of a checkpoint.
+ * @param[in] iteration The iteration of the checkpoint.
+ * @return The offset, in bytes.
+ **/
+static MPI_Offset checkpoint_field_offset(int iteration)
+{
+	return (MPI_Offset)sizeof(checkpoint_header) + (MPI_Offset)(iteration / PRINT_FREQUENCY) * TRACKED_CELLS * sizeof(double);
+}
+
+void checkpoint_initialise(void)
+{
+	int my_rank;
+	int comm_size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+	checkpoint_tracking = (my_rank == comm_size - 1);
+
+	if(checkpoint_tracking)
+	{
+		checkpoint_progress = malloc(sizeof(double) * (MAX_NUMBER_OF_ITERATIONS / PRINT_FREQUENCY + 1) * TRACKED_CELLS);
+		if(checkpoint_progress == NULL)
+		{
+			printf("Failed to allocate the progress history.\n");
+			MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+		}
+	}
+
+	int file_sizes[2] = {ROWS_GLOBAL, COLUMNS_GLOBAL};
+	int grid_sizes[2] = {ROWS + 2, COLUMNS + 2};
+	int tile_sizes[2] = {ROWS, COLUMNS};
+	int grid_starts[2] = {1, 1};
+	MPI_Type_create_subarray(2, file_sizes, tile_sizes, decomposition_offsets, MPI_ORDER_C, MPI_DOUBLE, &checkpoint_file_tile);
+	MPI_Type_commit(&checkpoint_file_tile);
+	MPI_Type_create_subarray(2, grid_sizes, tile_sizes, grid_starts, MPI_ORDER_C, MPI_DOUBLE, &checkpoint_grid_tile);
+	MPI_Type_commit(&checkpoint_grid_tile);
+}
+
+void checkpoint_track_progress(int iteration, double temperature[ROWS+2][COLUMNS+2])
+{
+	double* cells = checkpoint_progress + (iteration / PRINT_FREQUENCY - 1) * TRACKED_CELLS;
+	for(int i = TRACKED_CELLS; i > 0; i--)
+	{
+		cells[TRACKED_CELLS-i] = temperature[ROWS-i+1][COLUMNS-i+1];
+	}
+	progress_record_cells(iteration, cells);
+}
+
+int checkpoint_due(int iteration)
+{
+	return config_checkpoint_frequency > 0 && iteration % config_checkpoint_frequency == 0;
+}
+
+void checkpoint_write(int iteration, double temperature[ROWS+2][COLUMNS+2], double dt_global)
+{
+	double timer;
+	start_timer(&timer);
+	double profile_start = profile_now();
+
+	int my_rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+	// Write next to the checkpoint, which is only replaced once complete
+	const char* path = config_checkpoint_file;
+	char* temporary_path = malloc(strlen(path) + sizeof(".tmp"));
+	if(temporary_path == NULL)
+	{
+		printf("Failed to allocate the checkpoint file name.\n");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	strcpy(temporary_path, path);
+	strcat(temporary_path, ".tmp");
+
+	MPI_File file;
+	checkpoint_check(MPI_File_open(MPI_COMM_WORLD, temporary_path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &file), "create", temporary_path);
+	MPI_Offset field_offset = checkpoint_field_offset(iteration);
+	checkpoint_check(MPI_File_set_size(file, field_offset + (MPI_Offset)ROWS_GLOBAL * COLUMNS_GLOBAL * sizeof(double)), "size", temporary_path);
+
+	if(my_rank == 0)
+	{
+		checkpoint_header header;
+		memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+		header.rows_global = ROWS_GLOBAL;
+		header.columns_global = COLUMNS_GLOBAL;
+		header.iteration = iteration;
+		header.print_frequency = PRINT_FREQUENCY;
+		header.dt_global = dt_global;
+		checkpoint_check(MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE), "write", temporary_path);
+	}
+	if(checkpoint_tracking && iteration >= PRINT_FREQUENCY)
+	{
+		checkpoint_check(MPI_File_write_at(file, sizeof(checkpoint_header), checkpoint_progress, (iteration / PRINT_FREQUENCY) * TRACKED_CELLS, MPI_DOUBLE, MPI_STATUS_IGNORE), "write", temporary_path);
+	}
+
+	checkpoint_check(MPI_File_set_view(file, field_offset, MPI_DOUBLE, checkpoint_file_tile, "native", MPI_INFO_NULL), "write", temporary_path);
+	checkpoint_check(MPI_File_write_all(file, &temperature[0][0], 1, checkpoint_grid_tile, MPI_STATUS_IGNORE), "write", temporary_path);
+	checkpoint_check(MPI_File_close(&file), "close", temporary_path);
+
+	if(my_rank == 0 && rename(temporary_path, path) != 0)
+	{
+		printf("Failed to rename checkpoint %s to %s.\n", temporary_path, path);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	free(temporary_path);
+
+	checkpoint_count++;
+	profile_add(PROFILE_CHECKPOINT, profile_start, 0);
+	stop_timer(&timer);
+	checkpoint_time += timer;
+}
+
+int checkpoint_read(double temperature[ROWS+2][COLUMNS+2], double* dt_global)
+{
+	const char* path = config_restart_file;
+	MPI_File file;
+	checkpoint_check(MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &file), "open", path);
+
+	checkpoint_header header;
+	checkpoint_check(MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE), "read", path);
+	if(memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0)
+	{
+		printf("%s is not a checkpoint.\n", path);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	if(header.rows_global != ROWS_GLOBAL || header.columns_global != COLUMNS_GLOBAL || header.print_frequency != PRINT_FREQUENCY)
+	{
+		printf("Checkpoint %s was written for a %dx%d grid printed every %d iterations, not %dx%d every %d.\n", path, header.rows_global, header.columns_global, header.print_frequency, ROWS_GLOBAL, COLUMNS_GLOBAL, PRINT_FREQUENCY);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	if(header.iteration > MAX_NUMBER_OF_ITERATIONS)
+	{
+		printf("Checkpoint %s is past the maximum number of iterations.\n", path);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+
+	// Print the progress again, as the run that wrote the checkpoint did, along with that of this run
+	if(checkpoint_tracking && header.iteration >= PRINT_FREQUENCY)
+	{
+		checkpoint_check(MPI_File_read_at(file, sizeof(checkpoint_header), checkpoint_progress, (header.iteration / PRINT_FREQUENCY) * TRACKED_CELLS, MPI_DOUBLE, MPI_STATUS_IGNORE), "read", path);
+		for(int k = 1; k <= header.iteration / PRINT_FREQUENCY; k++)
+		{
+			progress_record_cells(k * PRINT_FREQUENCY, checkpoint_progress + (k - 1) * TRACKED_CELLS);
+		}
+	}
+
+	checkpoint_check(MPI_File_set_view(file, checkpoint_field_offset(header.iteration), MPI_DOUBLE, checkpoint_file_tile, "native", MPI_INFO_NULL), "read", path);
+	checkpoint_check(MPI_File_read_all(file, &temperature[0][0], 1, checkpoint_grid_tile, MPI_STATUS_IGNORE), "read", path);
+	checkpoint_check(MPI_File_close(&file), "close", path);
+
+	*dt_global = header.dt_global;
+	return header.iteration;
+}
+
+double checkpoint_elapsed(void)
+{
+	return checkpoint_time;
+}
+
+void checkpoint_finalise(void)
+{
+	int my_rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	if(my_rank == 0 && checkpoint_count > 0)
+	{
+		fprintf(stderr, "%d checkpoints written in %.1f seconds, excluded from the total time.\n", checkpoint_count, checkpoint_time / 1000000.0);
+	}
+
+	MPI_Type_free(&checkpoint_file_tile);
+	MPI_Type_free(&checkpoint_grid_tile);
+	free(checkpoint_progress);
+	checkpoint_progress = NULL;
+}
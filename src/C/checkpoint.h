@@ -0,0 +1,72 @@
+/**
+ * @file checkpoint.h
+ * @brief This file contains the checkpoint and restart of the MPI versions.
+ * @details Every config_checkpoint_frequency iterations, the temperatures of the last iteration are saved along with the iteration, the temperature change across all MPI processes and the progress printed so far. A run resumed from a checkpoint prints that progress again, then carries on exactly as the run that wrote it would have, so that its output is identical to that of a run never interrupted.
+ *
+ * A checkpoint is a single binary file, in the byte order of the machine that wrote it:
+ * | Content | Type |
+ * | ------- | ---- |
+ * | CHECKPOINT_MAGIC | 8 chars |
+ * | ROWS_GLOBAL, COLUMNS_GLOBAL, iteration, PRINT_FREQUENCY | 4 ints |
+ * | temperature change across all MPI processes | double |
+ * | the tracked cells printed at each multiple of PRINT_FREQUENCY up to the iteration | TRACKED_CELLS doubles each |
+ * | the temperatures, boundaries excluded, row by row | ROWS_GLOBAL x COLUMNS_GLOBAL doubles |
+ * All MPI processes write and read their tiles at once with MPI-IO, each through a view of the file on its own tile, so that a checkpoint does not depend on the decomposition. Checkpoints are written to a temporary file first, renamed once complete, so that a job killed while writing one keeps the previous one.
+ **/
+
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// The first bytes of a checkpoint.
+#define CHECKPOINT_MAGIC "LAPLACE1"
+
+/**
+ * @brief Prepares the checkpoints.
+ * @pre decomposition_initialise() has been called.
+ **/
+void checkpoint_initialise(void);
+/**
+ * @brief Records information used for tracking, like progress_record(), and keeps it for the next checkpoints.
+ * @param[in] iteration The iteration at which printing progress.
+ * @param[in] temperature The temperatures of that iteration.
+ * @pre It is called by the MPI process holding the bottom-right tile, at every multiple of PRINT_FREQUENCY.
+ **/
+void checkpoint_track_progress(int iteration, double temperature[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Tells whether a checkpoint is due at an iteration.
+ * @param[in] iteration The iteration.
+ * @return 1 if checkpoints are enabled and \p iteration is a multiple of config_checkpoint_frequency, 0 otherwise.
+ **/
+int checkpoint_due(int iteration);
+/**
+ * @brief Writes a checkpoint.
+ * @details The time taken is accumulated in that returned by checkpoint_elapsed().
+ * @param[in] iteration The iteration completed.
+ * @param[in] temperature The temperatures of that iteration.
+ * @param[in] dt_global The temperature change across all MPI processes at that iteration.
+ * @pre It is called by all MPI processes.
+ **/
+void checkpoint_write(int iteration, double temperature[ROWS+2][COLUMNS+2], double dt_global);
+/**
+ * @brief Reads the checkpoint config_restart_file, and records the progress it holds to be printed again, see progress.h.
+ * @details The program is aborted if the file cannot be read or was written for another grid size or printing frequency.
+ * @param[out] temperature The grid in which to read the temperatures; its boundaries must be set already, its halos are left untouched.
+ * @param[out] dt_global The temperature change across all MPI processes at the iteration read.
+ * @return The iteration read.
+ * @pre progress_initialise() has been called.
+ * @pre It is called by all MPI processes.
+ **/
+int checkpoint_read(double temperature[ROWS+2][COLUMNS+2], double* dt_global);
+/**
+ * @brief Gives the time my MPI process spent writing checkpoints.
+ * @return The time spent, in microseconds like the timers of util.h.
+ **/
+double checkpoint_elapsed(void);
+/**
+ * @brief Reports the checkpoints written, if any, on the standard error so that the output stays comparable, and frees what checkpoint_initialise() allocated.
+ **/
+void checkpoint_finalise(void);
+
+#endif
@@ -0,0 +1,393 @@
+/**
+ * @file config.c
+ **/
+
+#include "config.h"
+#include <stdio.h> // printf
+#include <stdlib.h> // getenv, strtol, strtod, exit, EXIT_FAILURE
+#include <string.h> // strcmp
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h>
+#endif
+
+int config_rows_global = CONFIG_DEFAULT_ROWS;
+int config_columns_global = CONFIG_DEFAULT_COLUMNS;
+int config_rows = CONFIG_DEFAULT_ROWS;
+int config_columns = CONFIG_DEFAULT_COLUMNS;
+double config_max_temp_error = 0.01;
+int config_max_number_of_iterations = 4000;
+int config_print_frequency = 100;
+int config_process_columns = 1;
+int config_checkpoint_frequency = 0;
+const char* config_checkpoint_file = "laplace.checkpoint";
+const char* config_restart_file = NULL;
+int config_halo_backend = CONFIG_HALO_SHARED;
+int config_halo_depth = 1;
+const char* config_profile_file = NULL;
+const char* config_dt_log_file = NULL;
+int config_snapshot_frequency = 0;
+const char* config_snapshot_file = "laplace.snapshot";
+int config_solver = CONFIG_SOLVER_JACOBI;
+double config_omega = 0.0;
+int config_smoother = CONFIG_SMOOTHER_GAUSS_SEIDEL;
+int config_reference = CONFIG_REFERENCE_JACOBI;
+int config_precision = CONFIG_PRECISION_DOUBLE;
+int config_threading = CONFIG_THREADING_BANDS;
+int config_convergence_window = 1;
+
+/// The environment variable of each option.
+static const char* config_variables[][2] = {{"LAPLACE_ROWS", "--rows"},
+                                           {"LAPLACE_COLUMNS", "--columns"},
+                                           {"LAPLACE_TOLERANCE", "--tolerance"},
+                                           {"LAPLACE_MAX_ITERATIONS", "--max-iterations"},
+                                           {"LAPLACE_PRINT_FREQUENCY", "--print-frequency"},
+                                           {"LAPLACE_PROCESS_COLUMNS", "--process-columns"},
+                                           {"LAPLACE_CHECKPOINT_FREQUENCY", "--checkpoint-frequency"},
+                                           {"LAPLACE_CHECKPOINT_FILE", "--checkpoint-file"},
+                                           {"LAPLACE_RESTART", "--restart"},
+                                           {"LAPLACE_HALO_BACKEND", "--halo-backend"},
+                                           {"LAPLACE_HALO_DEPTH", "--halo-depth"},
+                                           {"LAPLACE_PROFILE", "--profile"},
+                                           {"LAPLACE_DT_LOG", "--dt-log"},
+                                           {"LAPLACE_SNAPSHOT_FREQUENCY", "--snapshot-frequency"},
+                                           {"LAPLACE_SNAPSHOT_FILE", "--snapshot-file"},
+                                           {"LAPLACE_SOLVER", "--solver"},
+                                           {"LAPLACE_OMEGA", "--omega"},
+                                           {"LAPLACE_SMOOTHER", "--smoother"},
+                                           {"LAPLACE_REFERENCE", "--reference"},
+                                           {"LAPLACE_PRECISION", "--precision"},
+                                           {"LAPLACE_THREADING", "--threading"},
+                                           {"LAPLACE_CONVERGENCE_WINDOW", "--convergence-window"}};
+
+/**
+ * @brief Terminates the program, once the reason is printed.
+ **/
+static void config_fail(void)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	#endif
+	exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Parses a strictly positive integer.
+ * @param[in] option The option being read, used for error messages.
+ * @param[in] value The text to parse.
+ * @return The integer parsed.
+ **/
+static int config_parse_count(const char* option, const char* value)
+{
+	char* end;
+	long count = strtol(value, &end, 10);
+	if(end == value || *end != '\0' || count < 1 || count > 1000000000)
+	{
+		printf("The value of %s must be a strictly positive integer.\n", option);
+		config_fail();
+	}
+	return (int)count;
+}
+
+/**
+ * @brief Parses a strictly positive real.
+ * @param[in] option The option being read, used for error messages.
+ * @param[in] value The text to parse.
+ * @return The real parsed.
+ **/
+static double config_parse_real(const char* option, const char* value)
+{
+	char* end;
+	double real = strtod(value, &end);
+	if(end == value || *end != '\0' || !(real > 0.0))
+	{
+		printf("The value of %s must be a strictly positive real.\n", option);
+		config_fail();
+	}
+	return real;
+}
+
+/**
+ * @brief Reads an option.
+ * @param[in] option The option, as given on the command line.
+ * @param[in] value The value of the option. Paths are kept as given, so it must last until the end of the run.
+ * @return 1 if the option is known, 0 otherwise.
+ **/
+static int config_set(const char* option, const char* value)
+{
+	if(strcmp(option, "--rows") == 0)
+	{
+		config_rows_global = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--columns") == 0)
+	{
+		config_columns_global = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--tolerance") == 0)
+	{
+		config_max_temp_error = config_parse_real(option, value);
+	}
+	else if(strcmp(option, "--max-iterations") == 0)
+	{
+		config_max_number_of_iterations = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--print-frequency") == 0)
+	{
+		config_print_frequency = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--process-columns") == 0)
+	{
+		config_process_columns = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--checkpoint-frequency") == 0)
+	{
+		config_checkpoint_frequency = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--checkpoint-file") == 0)
+	{
+		config_checkpoint_file = value;
+	}
+	else if(strcmp(option, "--restart") == 0)
+	{
+		config_restart_file = value;
+	}
+	else if(strcmp(option, "--halo-backend") == 0)
+	{
+		if(strcmp(value, "messages") == 0)
+		{
+			config_halo_backend = CONFIG_HALO_MESSAGES;
+		}
+		else if(strcmp(value, "shared") == 0)
+		{
+			config_halo_backend = CONFIG_HALO_SHARED;
+		}
+		else if(strcmp(value, "rma") == 0)
+		{
+			config_halo_backend = CONFIG_HALO_RMA;
+		}
+		else if(strcmp(value, "threads") == 0)
+		{
+			config_halo_backend = CONFIG_HALO_THREADS;
+		}
+		else
+		{
+			printf("The value of %s must be 'messages', 'shared', 'rma' or 'threads'.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--halo-depth") == 0)
+	{
+		config_halo_depth = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--profile") == 0)
+	{
+		config_profile_file = value;
+	}
+	else if(strcmp(option, "--dt-log") == 0)
+	{
+		config_dt_log_file = value;
+	}
+	else if(strcmp(option, "--snapshot-frequency") == 0)
+	{
+		config_snapshot_frequency = config_parse_count(option, value);
+	}
+	else if(strcmp(option, "--snapshot-file") == 0)
+	{
+		config_snapshot_file = value;
+	}
+	else if(strcmp(option, "--solver") == 0)
+	{
+		if(strcmp(value, "jacobi") == 0)
+		{
+			config_solver = CONFIG_SOLVER_JACOBI;
+		}
+		else if(strcmp(value, "sor") == 0)
+		{
+			config_solver = CONFIG_SOLVER_SOR;
+		}
+		else if(strcmp(value, "multigrid") == 0)
+		{
+			config_solver = CONFIG_SOLVER_MULTIGRID;
+		}
+		else if(strcmp(value, "cg") == 0)
+		{
+			config_solver = CONFIG_SOLVER_CG;
+		}
+		else
+		{
+			printf("The value of %s must be 'jacobi', 'sor', 'multigrid' or 'cg'.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--omega") == 0)
+	{
+		config_omega = config_parse_real(option, value);
+		if(config_omega >= 2.0)
+		{
+			printf("The value of %s must be lesser than 2.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--smoother") == 0)
+	{
+		if(strcmp(value, "gauss-seidel") == 0)
+		{
+			config_smoother = CONFIG_SMOOTHER_GAUSS_SEIDEL;
+		}
+		else if(strcmp(value, "jacobi") == 0)
+		{
+			config_smoother = CONFIG_SMOOTHER_JACOBI;
+		}
+		else
+		{
+			printf("The value of %s must be 'gauss-seidel' or 'jacobi'.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--reference") == 0)
+	{
+		if(strcmp(value, "jacobi") == 0)
+		{
+			config_reference = CONFIG_REFERENCE_JACOBI;
+		}
+		else if(strcmp(value, "none") == 0)
+		{
+			config_reference = CONFIG_REFERENCE_NONE;
+		}
+		else
+		{
+			printf("The value of %s must be 'jacobi' or 'none'.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--precision") == 0)
+	{
+		if(strcmp(value, "double") == 0)
+		{
+			config_precision = CONFIG_PRECISION_DOUBLE;
+		}
+		else if(strcmp(value, "mixed") == 0)
+		{
+			config_precision = CONFIG_PRECISION_MIXED;
+		}
+		else
+		{
+			printf("The value of %s must be 'double' or 'mixed'.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--threading") == 0)
+	{
+		if(strcmp(value, "bands") == 0)
+		{
+			config_threading = CONFIG_THREADING_BANDS;
+		}
+		else if(strcmp(value, "tasks") == 0)
+		{
+			config_threading = CONFIG_THREADING_TASKS;
+		}
+		else
+		{
+			printf("The value of %s must be 'bands' or 'tasks'.\n", option);
+			config_fail();
+		}
+	}
+	else if(strcmp(option, "--convergence-window") == 0)
+	{
+		config_convergence_window = config_parse_count(option, value);
+	}
+	else
+	{
+		return 0;
+	}
+	return 1;
+}
+
+const char* config_peek(int argc, char* argv[], const char* option)
+{
+	const char* value = NULL;
+	for(unsigned int v = 0; v < sizeof(config_variables) / sizeof(config_variables[0]); v++)
+	{
+		if(strcmp(config_variables[v][1], option) == 0 && getenv(config_variables[v][0]) != NULL)
+		{
+			value = getenv(config_variables[v][0]);
+		}
+	}
+	for(int a = 1; a + 1 < argc; a += 2)
+	{
+		if(strcmp(argv[a], option) == 0)
+		{
+			value = argv[a + 1];
+		}
+	}
+	return value;
+}
+
+void config_initialise(int argc, char* argv[])
+{
+	// Environment variables first, so that the command line overrides them
+	for(unsigned int v = 0; v < sizeof(config_variables) / sizeof(config_variables[0]); v++)
+	{
+		const char* value = getenv(config_variables[v][0]);
+		if(value != NULL)
+		{
+			config_set(config_variables[v][1], value);
+		}
+	}
+
+	for(int a = 1; a < argc; a++)
+	{
+		if(a + 1 == argc || !config_set(argv[a], argv[a + 1]))
+		{
+			printf("Unknown option or missing value: %s.\n", argv[a]);
+			config_fail();
+		}
+		a++;
+	}
+
+	// The MPI versions split the grid later on, see decomposition_initialise()
+	config_rows = config_rows_global;
+	config_columns = config_columns_global;
+
+	#ifdef CONFIG_FIXED_EXTENTS
+		if(config_rows_global != ROWS_GLOBAL || config_columns_global != COLUMNS_GLOBAL)
+		{
+			printf("The grid size is fixed at compilation to %dx%d, it cannot be changed at runtime.\n", ROWS_GLOBAL, COLUMNS_GLOBAL);
+			config_fail();
+		}
+	#endif
+
+	// The red-black and multigrid solvers have no mixed-precision variant
+	if(config_precision == CONFIG_PRECISION_MIXED && config_solver != CONFIG_SOLVER_JACOBI)
+	{
+		printf("The mixed precision is only available with the Jacobi solver.\n");
+		config_fail();
+	}
+
+	// Only the MPI versions swap halos, and only the Jacobi solver in double precision keeps them deeper
+	#ifndef VERSION_RUN_IS_MPI
+		config_halo_depth = 1;
+	#endif
+	if(config_halo_depth > 1 && (config_solver != CONFIG_SOLVER_JACOBI || config_precision == CONFIG_PRECISION_MIXED))
+	{
+		printf("Halos deeper than one cell are only available with the Jacobi solver in double precision.\n");
+		config_fail();
+	}
+
+	// Only the OpenMP versions have threads to share the sweeps out among, and only the Jacobi solver in double precision
+	// with one-cell halos shares them out as tasks
+	#ifndef _OPENMP
+		config_threading = CONFIG_THREADING_BANDS;
+	#endif
+	if(config_threading == CONFIG_THREADING_TASKS && (config_solver != CONFIG_SOLVER_JACOBI || config_precision == CONFIG_PRECISION_MIXED || config_halo_depth > 1))
+	{
+		printf("Tasks are only available with the Jacobi solver in double precision and one-cell halos.\n");
+		config_fail();
+	}
+
+	// The progress printing shows the last 6 cells of the diagonal
+	if(config_rows_global < 6 || config_columns_global < 6)
+	{
+		printf("The grid must have at least 6 rows and 6 columns.\n");
+		config_fail();
+	}
+}
@@ -0,0 +1,176 @@
+/**
+ * @file config.h
+ * @brief This file contains the configuration of the run, given at runtime.
+ * @details The size of the grid, the convergence tolerance, the maximum number of iterations and the printing frequency are read from the command line or, failing that, from the environment:
+ * | Option | Environment variable | Default |
+ * | ------ | -------------------- | ------- |
+ * | --rows N | LAPLACE_ROWS | CONFIG_DEFAULT_ROWS |
+ * | --columns N | LAPLACE_COLUMNS | CONFIG_DEFAULT_COLUMNS |
+ * | --tolerance X | LAPLACE_TOLERANCE | 0.01 |
+ * | --max-iterations N | LAPLACE_MAX_ITERATIONS | 4000 |
+ * | --print-frequency N | LAPLACE_PRINT_FREQUENCY | 100 |
+ * | --process-columns N | LAPLACE_PROCESS_COLUMNS | 1 |
+ * | --checkpoint-frequency N | LAPLACE_CHECKPOINT_FREQUENCY | none |
+ * | --checkpoint-file PATH | LAPLACE_CHECKPOINT_FILE | laplace.checkpoint |
+ * | --restart PATH | LAPLACE_RESTART | none |
+ * | --halo-backend NAME | LAPLACE_HALO_BACKEND | shared |
+ * | --halo-depth N | LAPLACE_HALO_DEPTH | 1 |
+ * | --profile PATH | LAPLACE_PROFILE | none |
+ * | --dt-log PATH | LAPLACE_DT_LOG | none |
+ * | --snapshot-frequency N | LAPLACE_SNAPSHOT_FREQUENCY | none |
+ * | --snapshot-file PATH | LAPLACE_SNAPSHOT_FILE | laplace.snapshot |
+ * | --solver NAME | LAPLACE_SOLVER | jacobi |
+ * | --omega X | LAPLACE_OMEGA | automatic |
+ * | --smoother NAME | LAPLACE_SMOOTHER | gauss-seidel |
+ * | --reference NAME | LAPLACE_REFERENCE | jacobi |
+ * | --precision NAME | LAPLACE_PRECISION | double |
+ * | --threading NAME | LAPLACE_THREADING | bands |
+ * | --convergence-window N | LAPLACE_CONVERGENCE_WINDOW | 1 |
+ * The process columns, checkpoint, halo and convergence window options only apply to the MPI versions: the number of columns of the process grid, see decomposition.h, the number of iterations between two checkpoints, the file they are written to and the checkpoint to resume from, see checkpoint.h, how halos are swapped, see halo.h, how many rows and columns deep they are, see deep.h, and how many iterations of the Jacobi solver a single reduction checks the convergence of, see convergence.h. The profile option names the file the performance report is written to, see profile.h, the dt log option that the temperature change of every iteration is logged to, see progress.h, and the snapshot options the number of iterations between two snapshots of the temperatures and the files they are written to, see snapshot.h. The solver option picks the solver of the CPU versions, the conjugate gradient one being described in conjugate.h, the omega option the relaxation factor of the red-black successive over-relaxation solver, see relaxation.h, the next two the smoother of the multigrid solver and whether its result is compared with that of the Jacobi solver, see multigrid.h, the precision option whether the Jacobi solver sweeps in mixed precision, see mixed.h, and the threading option how the OpenMP versions share the Jacobi sweeps out among threads, see tasking.h.
+ *
+ * The grid extents ROWS and COLUMNS, and in the MPI versions ROWS_GLOBAL and COLUMNS_GLOBAL, expand to the variables below. The OpenACC versions keep their grids on the stack and let the compiler rely on constant extents, so they still fix them at compilation by defining 'ROWS' and 'COLUMNS', see makefile; the grid size given at runtime must then match them.
+ **/
+
+#ifndef CONFIG_H_INCLUDED
+#define CONFIG_H_INCLUDED
+
+#ifdef ROWS
+	/// The grid extents are fixed at compilation.
+	#define CONFIG_FIXED_EXTENTS
+	#ifndef ROWS_GLOBAL
+		#define ROWS_GLOBAL ROWS
+	#endif
+	#ifndef COLUMNS_GLOBAL
+		#define COLUMNS_GLOBAL COLUMNS
+	#endif
+#else
+	/// Number of rows (excluding boundaries) of my grid; in the MPI versions, of the tile held by my MPI process.
+	#define ROWS config_rows
+	/// Number of columns (excluding boundaries) of my grid; in the MPI versions, of the tile held by my MPI process.
+	#define COLUMNS config_columns
+	/// Number of rows (excluding boundaries) of the whole grid.
+	#define ROWS_GLOBAL config_rows_global
+	/// Number of columns (excluding boundaries) of the whole grid.
+	#define COLUMNS_GLOBAL config_columns_global
+#endif
+
+#ifndef CONFIG_DEFAULT_ROWS
+	#ifdef CONFIG_FIXED_EXTENTS
+		#define CONFIG_DEFAULT_ROWS ROWS_GLOBAL
+	#else
+		/// Number of rows (excluding boundaries) of the grid, unless configured otherwise.
+		#define CONFIG_DEFAULT_ROWS 672
+	#endif
+#endif
+#ifndef CONFIG_DEFAULT_COLUMNS
+	#ifdef CONFIG_FIXED_EXTENTS
+		#define CONFIG_DEFAULT_COLUMNS COLUMNS_GLOBAL
+	#else
+		/// Number of columns (excluding boundaries) of the grid, unless configured otherwise.
+		#define CONFIG_DEFAULT_COLUMNS 672
+	#endif
+#endif
+
+/// Number of rows (excluding boundaries) of the whole grid.
+extern int config_rows_global;
+/// Number of columns (excluding boundaries) of the whole grid.
+extern int config_columns_global;
+/// Number of rows (excluding boundaries) of my grid, set by decomposition_initialise() in the MPI versions.
+extern int config_rows;
+/// Number of columns (excluding boundaries) of my grid, set by decomposition_initialise() in the MPI versions.
+extern int config_columns;
+/// Largest permitted change in temp.
+extern double config_max_temp_error;
+/// Max number of iterations.
+extern int config_max_number_of_iterations;
+/// Number of iterations between two summary printings.
+extern int config_print_frequency;
+/// Number of columns of the MPI process grid.
+extern int config_process_columns;
+/// Number of iterations between two checkpoints, 0 if none are written.
+extern int config_checkpoint_frequency;
+/// The file checkpoints are written to.
+extern const char* config_checkpoint_file;
+/// The checkpoint to resume from, NULL to start from the initial temperatures.
+extern const char* config_restart_file;
+/// Halos are swapped with messages only.
+#define CONFIG_HALO_MESSAGES 0
+/// Halos are read from the memory of neighbours on the same node, and swapped with messages across nodes.
+#define CONFIG_HALO_SHARED 1
+/// Halos are put in the memory of neighbours with one-sided communications.
+#define CONFIG_HALO_RMA 2
+/// Halos are swapped with messages only, each OpenMP thread sending and receiving its own segments of the first and last rows.
+#define CONFIG_HALO_THREADS 3
+
+/// How halos are swapped: CONFIG_HALO_MESSAGES ('messages'), CONFIG_HALO_SHARED ('shared'), CONFIG_HALO_RMA ('rma') or CONFIG_HALO_THREADS ('threads').
+extern int config_halo_backend;
+/// Width of the halos, and number of iterations between two halo swaps, of the Jacobi solver in double precision; 1 unless the MPI versions are given more, see deep.h.
+extern int config_halo_depth;
+/// The file the performance report is written to, NULL if none is written, see profile.h.
+extern const char* config_profile_file;
+/// The file the temperature change of every iteration is logged to, NULL if none is written, see progress.h.
+extern const char* config_dt_log_file;
+/// Number of iterations between two snapshots of the temperatures, 0 if none are written.
+extern int config_snapshot_frequency;
+/// The name the files snapshots are written to start with, see snapshot.h.
+extern const char* config_snapshot_file;
+/// Each iteration averages the neighbours of every cell from the temperatures of the last iteration.
+#define CONFIG_SOLVER_JACOBI 0
+/// Each iteration over-relaxes the red cells then the black ones in place, see relaxation.h.
+#define CONFIG_SOLVER_SOR 1
+/// Each iteration is a multigrid V-cycle, see multigrid.h.
+#define CONFIG_SOLVER_MULTIGRID 2
+/// Each iteration is a pipelined conjugate gradient iteration, see conjugate.h.
+#define CONFIG_SOLVER_CG 3
+/// The solver: CONFIG_SOLVER_JACOBI ('jacobi'), CONFIG_SOLVER_SOR ('sor'), CONFIG_SOLVER_MULTIGRID ('multigrid') or CONFIG_SOLVER_CG ('cg').
+extern int config_solver;
+/// The relaxation factor of the red-black solver, strictly between 0 and 2, or 0 to pick the optimal one.
+extern double config_omega;
+/// The multigrid solver smoothes with weighted Jacobi.
+#define CONFIG_SMOOTHER_JACOBI 0
+/// The multigrid solver smoothes with red-black Gauss-Seidel.
+#define CONFIG_SMOOTHER_GAUSS_SEIDEL 1
+/// The smoother of the multigrid solver: CONFIG_SMOOTHER_GAUSS_SEIDEL ('gauss-seidel') or CONFIG_SMOOTHER_JACOBI ('jacobi').
+extern int config_smoother;
+/// The result of the multigrid solver is not compared with another.
+#define CONFIG_REFERENCE_NONE 0
+/// The result of the multigrid solver is compared with that of the Jacobi solver.
+#define CONFIG_REFERENCE_JACOBI 1
+/// What the result of the multigrid solver is compared with: CONFIG_REFERENCE_JACOBI ('jacobi') or CONFIG_REFERENCE_NONE ('none').
+extern int config_reference;
+/// The Jacobi solver computes in double precision throughout.
+#define CONFIG_PRECISION_DOUBLE 0
+/// The Jacobi solver sweeps corrections in single precision, refined in double precision, see mixed.h.
+#define CONFIG_PRECISION_MIXED 1
+/// The precision of the Jacobi solver: CONFIG_PRECISION_DOUBLE ('double') or CONFIG_PRECISION_MIXED ('mixed'), the latter only with the Jacobi solver.
+extern int config_precision;
+/// Each OpenMP thread sweeps the same band of rows at every iteration, see tiling.h.
+#define CONFIG_THREADING_BANDS 0
+/// The OpenMP threads share out blocks of rows dynamically, as tasks, see tasking.h.
+#define CONFIG_THREADING_TASKS 1
+/// How the OpenMP versions share out the Jacobi sweeps in double precision with one-cell halos: CONFIG_THREADING_BANDS ('bands') or CONFIG_THREADING_TASKS ('tasks').
+extern int config_threading;
+/// Maximum number of iterations of the Jacobi solver whose convergence is checked by a single reduction, see convergence.h.
+extern int config_convergence_window;
+/// Whether the solver updates a single grid in place, which all do but the Jacobi solver in double precision with one-cell halos; with deeper halos, it keeps its own grids and updates the one given in place.
+#define CONFIG_IN_PLACE (config_solver != CONFIG_SOLVER_JACOBI || config_precision == CONFIG_PRECISION_MIXED || config_halo_depth > 1)
+
+/**
+ * @brief Finds the value an option is given, before the configuration is read.
+ * @details It is meant for the few options needed before MPI is initialised, and neither checks the value found nor fails on unknown options; config_initialise() does.
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments on the command line.
+ * @param[in] option The option, such as "--halo-backend".
+ * @return The value given on the command line, or else in the environment, NULL if none.
+ **/
+const char* config_peek(int argc, char* argv[], const char* option);
+/**
+ * @brief Reads the configuration from the command line and the environment.
+ * @details Options given on the command line take precedence over environment variables. The program is terminated if an option is unknown or its value invalid.
+ * @param[in] argc The number of arguments on the command line.
+ * @param[in] argv The arguments on the command line.
+ * @pre In the MPI versions, MPI is initialised.
+ **/
+void config_initialise(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,362 @@
+/**
+ * @file conjugate.c
+ **/
+
+#include "conjugate.h"
+#include "kernel.h"
+#include "profile.h"
+#include <math.h> // fabs, fmax
+#include <stdio.h> // printf, fprintf
+#include <stdlib.h> // calloc, malloc, free, exit, EXIT_FAILURE
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+	#include "halo.h"
+#endif
+
+/// Number of vectors kept besides the temperatures.
+#define CONJUGATE_VECTORS 6
+/// Number of values reduced at each iteration: the two dot products, then the largest residual.
+#define CONJUGATE_SUMS 3
+
+/// The residual, that is the change a Jacobi iteration would make to each cell. Boundaries stay at 0, and so do those of the other vectors. Its halos are swapped at the first iteration.
+static double* conjugate_r = NULL;
+/// The product of the matrix with the residual, with the sign flipped. Its halos are swapped at every iteration.
+static double* conjugate_w = NULL;
+/// The product of the matrix with conjugate_s.
+static double* conjugate_z = NULL;
+/// The product of the matrix with the search direction, with the sign flipped.
+static double* conjugate_s = NULL;
+/// The search direction.
+static double* conjugate_p = NULL;
+/// The product of the matrix with conjugate_w, with the sign flipped back.
+static double* conjugate_q = NULL;
+/// The terms of each row in the values reduced, in the order of CONJUGATE_SUMS.
+static double (*conjugate_rows)[CONJUGATE_SUMS] = NULL;
+/// The values reduced by the master thread, across all MPI processes, in two sets used by turns.
+static double conjugate_reduced[2][CONJUGATE_SUMS];
+/// The number of calls to conjugate_advance() made so far by my OpenMP thread, which tells the set of values to use.
+static unsigned int conjugate_round = 0;
+/// The step length and the squared norm of the residual of the iteration before, the same in all OpenMP threads.
+static double conjugate_alpha = 0.0;
+static double conjugate_gamma = 0.0;
+#pragma omp threadprivate(conjugate_round, conjugate_alpha, conjugate_gamma)
+#ifdef VERSION_RUN_IS_MPI
+	/// The requests of the reductions in progress, one for the dot products and one for the largest residual.
+	static MPI_Request conjugate_reductions[2];
+	/// The values of my MPI process being reduced.
+	static double conjugate_local[CONJUGATE_SUMS];
+#endif
+
+/**
+ * @brief Starts swapping the halos of a vector with the neighbouring MPI processes, see halo_start().
+ * @param[inout] vector The vector, one of those allocated by halo_initialise(), which must not be written until conjugate_swap_finish() returns.
+ * @pre It is called by the master thread.
+ **/
+static void conjugate_swap_start(double vector[ROWS+2][COLUMNS+2])
+{
+	#ifdef VERSION_RUN_IS_MPI
+		halo_start(vector, NULL);
+	#else
+		(void)vector;
+	#endif
+}
+
+/**
+ * @brief Completes the halo swap started by conjugate_swap_start().
+ * @pre It is called by the master thread.
+ **/
+static void conjugate_swap_finish(void)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		halo_finish();
+	#endif
+}
+
+/**
+ * @brief Applies the stencil to a vector, on part of a row.
+ * @param[out] product The vector receiving the change a Jacobi iteration would make to \p vector.
+ * @param[in] vector The vector, whose halos are up to date where they are read.
+ * @param[in] i The row.
+ * @param[in] first The first column.
+ * @param[in] final The last column.
+ * @return The largest change, in absolute value.
+ **/
+static inline double conjugate_apply(double product[ROWS+2][COLUMNS+2], double vector[ROWS+2][COLUMNS+2], int i, int first, int final)
+{
+	return KERNEL_SPAN(kernel_residual_double, product[i], vector[i-1], vector[i], vector[i+1], first, final);
+}
+
+/**
+ * @brief Computes the terms of a row in the values reduced.
+ * @details Terms are added in column order, so that they do not depend on how the rows are shared out.
+ * @param[in] r The row of the residual.
+ * @param[in] w The same row of its product with the matrix, with the sign flipped.
+ * @param[out] terms The terms of the row, in the order of CONJUGATE_SUMS.
+ **/
+static inline void conjugate_terms(const double* restrict r, const double* restrict w, double terms[CONJUGATE_SUMS])
+{
+	double gamma = 0.0;
+	double delta = 0.0;
+	double largest = 0.0;
+	for(int j = 1; j <= COLUMNS; j++)
+	{
+		gamma += r[j] * r[j];
+		delta -= w[j] * r[j];
+		// Same as fmax on the values met here, without a call per cell
+		double size = fabs(r[j]);
+		largest = (size > largest) ? size : largest;
+	}
+	terms[0] = gamma;
+	terms[1] = delta;
+	terms[2] = largest;
+}
+
+/**
+ * @brief Updates all vectors on a row, then computes the terms of the row in the values reduced of the next iteration.
+ * @details The updates are kept apart from the sums, which would serialise them, and the rows do not overlap, so the compiler is free to vectorise them; the sums follow while the row is still in cache. Every cell is computed as in a single loop.
+ * @param[inout] z, s, p, x, r, w The row of each vector, x being that of the temperatures.
+ * @param[in] q The row of the product of the matrix with w, from before the update.
+ * @param[in] alpha The step length.
+ * @param[in] beta The weight of the last search direction.
+ * @param[out] terms The terms of the row, in the order of CONJUGATE_SUMS.
+ **/
+static inline void conjugate_update(double* restrict z, double* restrict s, double* restrict p, double* restrict x, double* restrict r, double* restrict w, const double* restrict q, double alpha, double beta, double terms[CONJUGATE_SUMS])
+{
+	for(int j = 1; j <= COLUMNS; j++)
+	{
+		z[j] = q[j] + beta * z[j];
+		s[j] = w[j] + beta * s[j];
+		p[j] = r[j] + beta * p[j];
+		x[j] = x[j] + alpha * p[j];
+		r[j] = r[j] + alpha * s[j];
+		w[j] = w[j] + alpha * z[j];
+	}
+	conjugate_terms(r, w, terms);
+}
+
+/**
+ * @brief Adds the terms of the rows to the values to reduce, in row order.
+ * @param[out] sums The values of my MPI process, in the order of CONJUGATE_SUMS.
+ * @pre The terms of all rows are up to date in all OpenMP threads.
+ **/
+static void conjugate_sum(double sums[CONJUGATE_SUMS])
+{
+	double profile_start = profile_now();
+	sums[0] = 0.0;
+	sums[1] = 0.0;
+	sums[2] = 0.0;
+	for(int i = 1; i <= ROWS; i++)
+	{
+		sums[0] += conjugate_rows[i][0];
+		sums[1] += conjugate_rows[i][1];
+		sums[2] = fmax(conjugate_rows[i][2], sums[2]);
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+}
+
+/**
+ * @brief Computes the residual of the temperatures, and its product with the matrix, along with the terms of each row in the values reduced.
+ * @param[inout] grid The temperatures, whose halos are swapped first.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void conjugate_start(double grid[ROWS+2][COLUMNS+2])
+{
+	double (*r)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_r;
+	double (*w)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_w;
+
+	#pragma omp master
+	{
+		conjugate_swap_start(grid);
+		conjugate_swap_finish();
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	double profile_start = profile_now();
+	long cells = 0;
+	#pragma omp for schedule(static)
+	for(int i = 1; i <= ROWS; i++)
+	{
+		conjugate_apply(r, grid, i, 1, COLUMNS);
+		cells += COLUMNS;
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+
+	#pragma omp master
+	{
+		conjugate_swap_start(r);
+		conjugate_swap_finish();
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	// The dot products of each row are added while the row is still in cache
+	profile_start = profile_now();
+	cells = 0;
+	#pragma omp for schedule(static)
+	for(int i = 1; i <= ROWS; i++)
+	{
+		conjugate_apply(w, r, i, 1, COLUMNS);
+		conjugate_terms(r[i], w[i], conjugate_rows[i]);
+		cells += COLUMNS;
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+}
+
+void conjugate_initialise(double* vectors[CONJUGATE_HALO_VECTORS])
+{
+	int my_rank = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	#endif
+	if(my_rank == 0)
+	{
+		fprintf(stderr, "Pipelined conjugate gradient iterations, without preconditioning.\n");
+	}
+
+	// Boundaries, and halos along the edges of the grid, stay at 0. The vectors whose halos are swapped are given in
+	// the MPI versions, the others are allocated in one block starting with z.
+	size_t vector_size = ((size_t)ROWS + 2) * ((size_t)COLUMNS + 2);
+	int own = (vectors == NULL) ? CONJUGATE_VECTORS : CONJUGATE_VECTORS - CONJUGATE_HALO_VECTORS;
+	double* block = calloc(own * vector_size, sizeof(double));
+	conjugate_rows = malloc(sizeof(double) * CONJUGATE_SUMS * (ROWS + 1));
+	if(block == NULL || conjugate_rows == NULL)
+	{
+		printf("Failed to allocate the conjugate gradient vectors.\n");
+		exit(EXIT_FAILURE);
+	}
+	conjugate_z = block;
+	conjugate_s = block + vector_size;
+	conjugate_p = block + 2 * vector_size;
+	conjugate_q = block + 3 * vector_size;
+	conjugate_r = (vectors == NULL) ? block + 4 * vector_size : vectors[0];
+	conjugate_w = (vectors == NULL) ? block + 5 * vector_size : vectors[1];
+	conjugate_round = 0;
+}
+
+double conjugate_advance(double grid[ROWS+2][COLUMNS+2])
+{
+	double (*r)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_r;
+	double (*w)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_w;
+	double (*z)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_z;
+	double (*s)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_s;
+	double (*p)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_p;
+	double (*q)[COLUMNS+2] = (double (*)[COLUMNS+2])conjugate_q;
+
+	if(conjugate_round == 0)
+	{
+		conjugate_start(grid);
+	}
+	int set = conjugate_round % 2;
+	double* reduced = conjugate_reduced[set];
+	conjugate_round++;
+
+	// The values of the last sweep are reduced, and the halos of w swapped, while the cells that do not need those
+	// halos are computed. Sets of values alternate from one iteration to the next, so that the master thread can
+	// start a reduction while the others still read the values of the iteration before.
+	#pragma omp master
+	{
+		#ifdef VERSION_RUN_IS_MPI
+			conjugate_sum(conjugate_local);
+			double profile_start = profile_now();
+			MPI_Iallreduce(conjugate_local, reduced, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &conjugate_reductions[0]);
+			MPI_Iallreduce(&conjugate_local[2], &reduced[2], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD, &conjugate_reductions[1]);
+			profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+			conjugate_swap_start(w);
+		#else
+			conjugate_sum(reduced);
+		#endif
+	} // End of OpenMP master region
+
+	double profile_start = profile_now();
+	long cells = 0;
+	#pragma omp for schedule(static) nowait
+	for(int i = 2; i <= ROWS - 1; i++)
+	{
+		conjugate_apply(q, w, i, 2, COLUMNS - 1);
+		cells += COLUMNS - 2;
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+
+	#pragma omp master
+	{
+		conjugate_swap_finish();
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	profile_start = profile_now();
+	cells = 0;
+	#pragma omp for schedule(static)
+	for(int i = 1; i <= ROWS; i++)
+	{
+		if(i == 1 || i == ROWS)
+		{
+			conjugate_apply(q, w, i, 1, COLUMNS);
+			cells += COLUMNS;
+		}
+		else
+		{
+			conjugate_apply(q, w, i, 1, 1);
+			conjugate_apply(q, w, i, COLUMNS, COLUMNS);
+			cells += 2;
+		}
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+
+	#ifdef VERSION_RUN_IS_MPI
+		#pragma omp master
+		{
+			profile_start = profile_now();
+			MPI_Waitall(2, conjugate_reductions, MPI_STATUSES_IGNORE);
+			profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+		} // End of OpenMP master region
+	#endif
+	#pragma omp barrier
+
+	// Every thread finds the same step length and the same weight of the last search direction. Once the residual is
+	// 0, there is nothing left to do.
+	double gamma = reduced[0];
+	double delta = reduced[1];
+	double alpha = 0.0;
+	double beta = 0.0;
+	if(gamma > 0.0)
+	{
+		if(conjugate_round > 1)
+		{
+			beta = gamma / conjugate_gamma;
+			alpha = gamma / (delta - beta * gamma / conjugate_alpha);
+		}
+		else
+		{
+			alpha = gamma / delta;
+		}
+	}
+	conjugate_alpha = alpha;
+	conjugate_gamma = gamma;
+
+	// All vectors are updated in one sweep, which adds the dot products of the next iteration on the way. The products
+	// with the matrix of the search direction and of the residual are kept with their sign flipped, so that the
+	// stencil applies as it is.
+	profile_start = profile_now();
+	cells = 0;
+	#pragma omp for schedule(static)
+	for(int i = 1; i <= ROWS; i++)
+	{
+		conjugate_update(z[i], s[i], p[i], grid[i], r[i], w[i], q[i], alpha, beta, conjugate_rows[i]);
+		cells += COLUMNS;
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+
+	return reduced[2];
+}
+
+void conjugate_finalise(void)
+{
+	free(conjugate_z);
+	free(conjugate_rows);
+	conjugate_r = NULL;
+	conjugate_w = NULL;
+	conjugate_z = NULL;
+	conjugate_s = NULL;
+	conjugate_p = NULL;
+	conjugate_q = NULL;
+	conjugate_rows = NULL;
+}
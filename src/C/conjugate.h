@@ -0,0 +1,43 @@
+/**
+ * @file conjugate.h
+ * @brief This file contains the pipelined conjugate gradient solver of the CPU versions.
+ * @details The temperatures the Jacobi solver converges to solve a linear system: each cell equals the average of its four neighbours, boundaries included. Scaled so that its diagonal is 1, the matrix of that system is symmetric positive definite, and its product with a vector is the change a Jacobi iteration would make to that vector, with the sign flipped and the boundaries held at 0: the residual kernel of kernel.h applies it, row by row, without the matrix ever being stored. That diagonal is the same for every cell, so scaling by it is not a preconditioner, and the solver runs plain, unpreconditioned conjugate gradient. It needs a number of iterations that grows like the extent of the grid, where the Jacobi solver needs one that grows like its square.
+ *
+ * Each iteration of plain conjugate gradient waits for two reductions across all MPI processes, one after the other. The pipelined variant of Ghysels and Vanroose keeps two more vectors, the products of the matrix with the search direction and with the residual, updated by recurrences, so that both dot products of an iteration are found together, in the same sweep that updates the vectors, and their reduction completes while the product of the matrix with the next vector is computed, its halos being swapped meanwhile too. The largest residual rides along with the dot products.
+ *
+ * The solver thus trades memory traffic, its update sweep streaming seven vectors where the tiled Jacobi engine of tiling.h works on rows kept in cache, for reductions that overlap the stencil.
+ *
+ * The temperature change of an iteration is the largest change a Jacobi iteration would make to the temperatures the iteration starts from, that is the largest residual, and is compared with the same tolerance; at the first iteration, it is exactly the temperature change of the Jacobi solver. The residual is that of the recurrences, which drifts from the true one by rounding errors, orders of magnitude below the tolerances used. Results differ from those of the Jacobi solver. Each row adds its own terms to the dot products, and the rows are added in order, so the OpenMP threads of an MPI process do not change the results, but the number of MPI processes does, by rounding. A run resumed from a checkpoint starts the recurrences again from the temperatures saved.
+ *
+ * In the MPI versions, the master thread starts the halo swap and the reductions, and completes them while all threads compute the cells that do not depend on the halos. Only the master thread calls MPI. The two vectors whose halos are swapped, the residual and its product with the matrix, are allocated by halo_initialise() along with the temperatures, so that they are swapped the same way, whatever config_halo_backend is, see halo.h.
+ **/
+
+#ifndef CONJUGATE_H_INCLUDED
+#define CONJUGATE_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// Number of vectors whose halos are swapped, which the MPI versions allocate along with the temperatures.
+#define CONJUGATE_HALO_VECTORS 2
+
+/**
+ * @brief Allocates the vectors of the solver.
+ * @param[in] vectors In the MPI versions, CONJUGATE_HALO_VECTORS vectors allocated by halo_initialise(), zeroed, boundaries and halos included; NULL in the others, where the solver allocates them too.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void conjugate_initialise(double* vectors[CONJUGATE_HALO_VECTORS]);
+/**
+ * @brief Runs one iteration, in place.
+ * @details The first call computes the residual of the temperatures given, and starts the recurrences from there; the grid must then be passed to every later call untouched.
+ * @param[inout] grid The grid to update, with its boundaries set. Its halos are swapped before being read at the first call.
+ * @return The largest change a Jacobi iteration would make to the temperatures the iteration started from; in the MPI versions, across all MPI processes. All OpenMP threads get the same.
+ * @pre kernel_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, if any, and in the MPI versions by all MPI processes.
+ **/
+double conjugate_advance(double grid[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Frees the vectors allocated by conjugate_initialise().
+ **/
+void conjugate_finalise(void);
+
+#endif
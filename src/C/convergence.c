@@ -0,0 +1,118 @@
+/**
+ * @file convergence.c
+ **/
+
+#include "convergence.h"
+#include "util.h"
+#include "profile.h"
+#include "progress.h"
+#include <stdio.h> // printf
+#include <stdlib.h> // malloc, free, EXIT_FAILURE
+#include <mpi.h> // MPI_*
+
+/// Temperature changes of my MPI process recorded in the window in progress.
+static double* convergence_dt_recorded = NULL;
+/// Number of temperature changes recorded in the window in progress.
+static unsigned int convergence_recorded = 0;
+/// Temperature changes of my MPI process in the window being reduced, which must not change until the reduction completes.
+static double* convergence_dt_sent = NULL;
+/// Temperature changes across all MPI processes in the window being reduced.
+static double* convergence_dt_global = NULL;
+/// Number of iterations in the window being reduced.
+static unsigned int convergence_length = 0;
+/// The request of the reduction in progress.
+static MPI_Request convergence_request = MPI_REQUEST_NULL;
+
+void convergence_initialise(void)
+{
+	convergence_dt_recorded = malloc(sizeof(double) * config_convergence_window);
+	convergence_dt_sent = malloc(sizeof(double) * config_convergence_window);
+	convergence_dt_global = malloc(sizeof(double) * config_convergence_window);
+	if(convergence_dt_recorded == NULL || convergence_dt_sent == NULL || convergence_dt_global == NULL)
+	{
+		printf("Failed to allocate the temperature changes of the convergence checks.\n");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	convergence_recorded = 0;
+	convergence_length = 0;
+}
+
+unsigned int convergence_window_end(unsigned int iteration)
+{
+	unsigned int end = iteration + config_convergence_window;
+	unsigned int next_print = (iteration / PRINT_FREQUENCY + 1) * PRINT_FREQUENCY;
+
+	if(end > next_print)
+	{
+		end = next_print;
+	}
+	if(config_checkpoint_frequency > 0)
+	{
+		unsigned int next_checkpoint = (iteration / config_checkpoint_frequency + 1) * config_checkpoint_frequency;
+		if(end > next_checkpoint)
+		{
+			end = next_checkpoint;
+		}
+	}
+	if(config_snapshot_frequency > 0)
+	{
+		unsigned int next_snapshot = (iteration / config_snapshot_frequency + 1) * config_snapshot_frequency;
+		if(end > next_snapshot)
+		{
+			end = next_snapshot;
+		}
+	}
+	if(end > MAX_NUMBER_OF_ITERATIONS + 1)
+	{
+		end = MAX_NUMBER_OF_ITERATIONS + 1;
+	}
+
+	return end;
+}
+
+void convergence_record(double dt)
+{
+	convergence_dt_recorded[convergence_recorded] = dt;
+	convergence_recorded++;
+}
+
+void convergence_start(void)
+{
+	double profile_start = profile_now();
+	convergence_length = convergence_recorded;
+	for(unsigned int i = 0; i < convergence_length; i++)
+	{
+		convergence_dt_sent[i] = convergence_dt_recorded[i];
+	}
+	convergence_recorded = 0;
+
+	MPI_Iallreduce(convergence_dt_sent, convergence_dt_global, convergence_length, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD, &convergence_request);
+	profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+}
+
+unsigned int convergence_finish(double* dt_global)
+{
+	double profile_start = profile_now();
+	MPI_Wait(&convergence_request, MPI_STATUS_IGNORE);
+	profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+
+	unsigned int needed = 0;
+	do
+	{
+		*dt_global = convergence_dt_global[needed];
+		progress_log(*dt_global);
+		needed++;
+	} while(*dt_global > MAX_TEMP_ERROR && needed < convergence_length);
+
+	return needed;
+}
+
+void convergence_finalise(void)
+{
+	free(convergence_dt_recorded);
+	free(convergence_dt_sent);
+	free(convergence_dt_global);
+	convergence_dt_recorded = NULL;
+	convergence_dt_sent = NULL;
+	convergence_dt_global = NULL;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file convergence.h
+ * @brief This file contains the convergence check used by the MPI versions.
+ * @details The maximal temperature change of each iteration must be known across all MPI processes to decide whether the simulation has converged. Instead of a reduction followed by a broadcast at every iteration, the changes of a window of iterations are combined by a single non-blocking allreduce, which completes while the next iteration is computed. That next iteration is speculative: if the window turns out to have converged it is discarded, and if convergence was reached before the end of the window the caller replays the window up to that iteration. Either way, the stopping iteration and its temperature change are exactly those of a check at every iteration.
+ *
+ * A window ends after config_convergence_window iterations, see config.h, at the next iteration at which progress is printed, at the next checkpoint, at the next snapshot, or at the last iteration allowed, whichever comes first.
+ **/
+
+#ifndef CONVERGENCE_H_INCLUDED
+#define CONVERGENCE_H_INCLUDED
+
+/**
+ * @brief Allocates the temperature changes of the windows.
+ * @pre config_initialise() has been called.
+ **/
+void convergence_initialise(void);
+/**
+ * @brief Gives the last iteration of the window starting after a given iteration.
+ * @param[in] iteration The iteration the window starts from.
+ * @return The last iteration of the window.
+ **/
+unsigned int convergence_window_end(unsigned int iteration);
+/**
+ * @brief Records the maximal temperature change of my MPI process for the next iteration of the window.
+ * @param[in] dt The maximal temperature change of my MPI process.
+ **/
+void convergence_record(double dt);
+/**
+ * @brief Starts combining the temperature changes recorded across all MPI processes.
+ * @details The window is closed; the next temperature change recorded opens a new one.
+ **/
+void convergence_start(void);
+/**
+ * @brief Completes the reduction started by convergence_start() and finds the first iteration of the window that converged.
+ * @details The temperature changes of the window up to that iteration are logged with progress_log().
+ * @param[out] dt_global The maximal temperature change across all MPI processes of the iteration returned.
+ * @return The number of iterations of the window up to the first one that converged, or the number of iterations of the window if none converged.
+ **/
+unsigned int convergence_finish(double* dt_global);
+/**
+ * @brief Frees the temperature changes of the windows.
+ * @pre No reduction is in progress.
+ **/
+void convergence_finalise(void);
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file decomposition.c
+ **/
+
+#include "decomposition.h"
+#include "util.h"
+#include <stdio.h> // printf
+#include <stdlib.h> // EXIT_FAILURE
+
+MPI_Comm decomposition_communicator = MPI_COMM_NULL;
+int decomposition_dimensions[2];
+int decomposition_coordinates[2];
+int decomposition_offsets[2];
+int decomposition_neighbours[4];
+
+void decomposition_initialise(void)
+{
+	int comm_size;
+	MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+	decomposition_dimensions[1] = config_process_columns;
+	decomposition_dimensions[0] = comm_size / config_process_columns;
+	if(decomposition_dimensions[0] * decomposition_dimensions[1] != comm_size)
+	{
+		printf("%d MPI processes cannot be arranged in %d columns.\n", comm_size, config_process_columns);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	if(config_rows_global / decomposition_dimensions[0] < 6 || config_columns_global / decomposition_dimensions[1] < 6)
+	{
+		printf("A grid of %dx%d split in %dx%d tiles leaves some smaller than 6x6.\n", config_rows_global, config_columns_global, decomposition_dimensions[0], decomposition_dimensions[1]);
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+
+	// The plate is not periodic, and ranks keep their row-major order
+	int periods[2] = {0, 0};
+	MPI_Cart_create(MPI_COMM_WORLD, 2, decomposition_dimensions, periods, 0, &decomposition_communicator);
+
+	int my_rank;
+	MPI_Comm_rank(decomposition_communicator, &my_rank);
+	MPI_Cart_coords(decomposition_communicator, my_rank, 2, decomposition_coordinates);
+	MPI_Cart_shift(decomposition_communicator, 0, 1, &decomposition_neighbours[DECOMPOSITION_TOP], &decomposition_neighbours[DECOMPOSITION_BOTTOM]);
+	MPI_Cart_shift(decomposition_communicator, 1, 1, &decomposition_neighbours[DECOMPOSITION_LEFT], &decomposition_neighbours[DECOMPOSITION_RIGHT]);
+
+	// Share out the rows and columns, the first tiles taking one of those left over each
+	int extents[2];
+	int extents_global[2] = {config_rows_global, config_columns_global};
+	for(int d = 0; d < 2; d++)
+	{
+		int share = extents_global[d] / decomposition_dimensions[d];
+		int remainder = extents_global[d] % decomposition_dimensions[d];
+		int coordinate = decomposition_coordinates[d];
+		extents[d] = decomposition_extent(d, coordinate);
+		decomposition_offsets[d] = coordinate * share + (coordinate < remainder ? coordinate : remainder);
+	}
+	config_rows = extents[0];
+	config_columns = extents[1];
+
+	#ifdef CONFIG_FIXED_EXTENTS
+		if(extents[0] != ROWS || extents[1] != COLUMNS)
+		{
+			printf("Tiles are fixed at compilation to %dx%d cells, %d MPI processes in %d columns give %dx%d instead.\n", ROWS, COLUMNS, comm_size, config_process_columns, extents[0], extents[1]);
+			MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+		}
+	#endif
+}
+
+int decomposition_extent(int dimension, int coordinate)
+{
+	int extent_global = (dimension == 0) ? config_rows_global : config_columns_global;
+	int share = extent_global / decomposition_dimensions[dimension];
+	int remainder = extent_global % decomposition_dimensions[dimension];
+	return share + (coordinate < remainder ? 1 : 0);
+}
+
+int decomposition_rank(int row, int column)
+{
+	return row * decomposition_dimensions[1] + column;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file decomposition.h
+ * @brief This file contains the decomposition of the grid across the MPI processes.
+ * @details The grid is split in a two-dimensional Cartesian grid of tiles, one per MPI process. The process grid has config_process_columns columns, 1 by default so that the grid is split in horizontal strips, and as many rows as needed to give each MPI process a tile. Rows and columns that do not divide evenly go one each to the first tiles, so tiles differ by at most one row and one column. Ranks are not reordered: they follow the tiles in row-major order, so the last MPI process holds the bottom-right tile.
+ **/
+
+#ifndef DECOMPOSITION_H_INCLUDED
+#define DECOMPOSITION_H_INCLUDED
+
+#include <mpi.h> // MPI_Comm
+
+/// Index of the top neighbour in decomposition_neighbours.
+#define DECOMPOSITION_TOP 0
+/// Index of the bottom neighbour in decomposition_neighbours.
+#define DECOMPOSITION_BOTTOM 1
+/// Index of the left neighbour in decomposition_neighbours.
+#define DECOMPOSITION_LEFT 2
+/// Index of the right neighbour in decomposition_neighbours.
+#define DECOMPOSITION_RIGHT 3
+
+/// The Cartesian communicator of the process grid.
+extern MPI_Comm decomposition_communicator;
+/// The number of rows and columns of the process grid.
+extern int decomposition_dimensions[2];
+/// The row and column of my MPI process in the process grid.
+extern int decomposition_coordinates[2];
+/// The global row and column of the first cell of my tile, minus one: cell [i][j] of my tile is cell [offset + i][offset + j] of the grid.
+extern int decomposition_offsets[2];
+/// The ranks of my top, bottom, left and right neighbours, MPI_PROC_NULL on the edges of the grid.
+extern int decomposition_neighbours[4];
+
+/**
+ * @brief Creates the process grid.
+ * @details The extents of my tile are stored in config_rows and config_columns. The program is aborted if the number of MPI processes does not fit the process grid, if tiles would be smaller than 6 x 6 cells, or if the grid extents are fixed at compilation and my tile does not match them.
+ * @pre config_initialise() has been called.
+ **/
+void decomposition_initialise(void);
+/**
+ * @brief Gives the number of rows or columns of the tiles in a row or column of the process grid.
+ * @param[in] dimension 0 for the number of rows of the tiles in a row of the process grid, 1 for the number of columns of the tiles in a column.
+ * @param[in] coordinate The row or column of the process grid.
+ * @return The number of rows or columns, excluding boundaries.
+ **/
+int decomposition_extent(int dimension, int coordinate);
+/**
+ * @brief Gives the rank of the MPI process holding a tile.
+ * @param[in] row The row of the tile in the process grid.
+ * @param[in] column The column of the tile in the process grid.
+ * @return The rank of the MPI process holding that tile.
+ **/
+int decomposition_rank(int row, int column);
+
+#endif
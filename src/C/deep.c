@@ -0,0 +1,355 @@
+/**
+ * @file deep.c
+ **/
+
+#include "deep.h"
+#include "util.h"
+#include "kernel.h"
+#include "profile.h"
+#include "decomposition.h"
+#include <math.h> // fmax
+#include <stdio.h> // printf, fprintf
+#include <stdlib.h> // malloc, free, EXIT_FAILURE
+#include <string.h> // memcpy
+#include <mpi.h> // MPI_*
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+/// Distance between the temperature change slots of two OpenMP threads, in doubles: one slot per iteration of a trip, rounded up to whole cache lines.
+#define DEEP_SLOT_STRIDE (((DEEP_MAX_DEPTH) + 7) / 8 * 8)
+/// Number of grids: the one the halos were last swapped on, and two for the iterations by turns.
+#define DEEP_GRIDS 3
+/// Tag of the messages sent to the bottom neighbour, distinct from those of halo.c, mixed.c and progress.c.
+#define DEEP_TAG_DOWNWARDS 9
+/// Tag of the messages sent to the top neighbour.
+#define DEEP_TAG_UPWARDS 10
+/// Tag of the messages sent to the right neighbour.
+#define DEEP_TAG_RIGHTWARDS 11
+/// Tag of the messages sent to the left neighbour.
+#define DEEP_TAG_LEFTWARDS 12
+
+/// The grids, each of ROWS + 2 * config_halo_depth rows of COLUMNS + 2 * config_halo_depth cells.
+static double* deep_grids[DEEP_GRIDS] = {NULL, NULL, NULL};
+/// The maximal temperature change found by each OpenMP thread at each iteration of a trip.
+static double* deep_slots = NULL;
+/// The temperature change across all MPI processes of each iteration of a trip, found by the master thread.
+static double deep_dt_global[DEEP_MAX_DEPTH];
+/// The number of cells of a row of the grids, halos included.
+static size_t deep_row_length = 0;
+/// The halo columns of a grid, over the rows of the tile and its boundaries.
+static MPI_Datatype deep_columns = MPI_DATATYPE_NULL;
+/// The grid holding the temperatures of the last iteration run, as seen by my OpenMP thread.
+static int deep_current = 0;
+#pragma omp threadprivate(deep_current)
+
+/**
+ * @brief Gives a row of a grid, indexed like those of the grid given to deep_initialise().
+ * @param[in] grid The index of the grid.
+ * @param[in] i The row, from 1 - config_halo_depth to ROWS + config_halo_depth.
+ * @return The address of column 0 of that row, so that column j, from 1 - config_halo_depth to COLUMNS + config_halo_depth, is at index j.
+ **/
+static inline double* deep_row(int grid, int i)
+{
+	return deep_grids[grid] + (size_t)(i + config_halo_depth - 1) * deep_row_length + config_halo_depth - 1;
+}
+
+/**
+ * @brief Gives the grid an iteration of a trip writes to.
+ * @param[in] start The grid the trip starts from.
+ * @param[in] sweep The iteration, counted from 1 at the start of the trip; 0 for the grid the trip starts from.
+ * @return The index of the grid.
+ **/
+static inline int deep_grid(int start, unsigned int sweep)
+{
+	return (sweep == 0) ? start : (start + 1 + (int)((sweep - 1) % 2)) % DEEP_GRIDS;
+}
+
+/**
+ * @brief Swaps halos config_halo_depth cells deep.
+ * @details Columns go first, over the boundary rows as well, so that a tile whose neighbour lies on the edge of the grid gets the boundary temperatures beyond its corners. Rows go next, including the halo columns just received, which brings the corners of the diagonal neighbours.
+ * @param[in] grid The index of the grid.
+ * @pre It is called by a single OpenMP thread.
+ **/
+static void deep_swap(int grid)
+{
+	const int* neighbours = decomposition_neighbours;
+	MPI_Comm communicator = decomposition_communicator;
+	int depth = config_halo_depth;
+	int rows_count = depth * (int)deep_row_length;
+	MPI_Request requests[4];
+
+	MPI_Irecv(deep_row(grid, 0) + 1 - depth, 1, deep_columns, neighbours[DECOMPOSITION_LEFT], DEEP_TAG_RIGHTWARDS, communicator, &requests[0]);
+	MPI_Irecv(deep_row(grid, 0) + COLUMNS + 1, 1, deep_columns, neighbours[DECOMPOSITION_RIGHT], DEEP_TAG_LEFTWARDS, communicator, &requests[1]);
+	MPI_Isend(deep_row(grid, 0) + COLUMNS + 1 - depth, 1, deep_columns, neighbours[DECOMPOSITION_RIGHT], DEEP_TAG_RIGHTWARDS, communicator, &requests[2]);
+	MPI_Isend(deep_row(grid, 0) + 1, 1, deep_columns, neighbours[DECOMPOSITION_LEFT], DEEP_TAG_LEFTWARDS, communicator, &requests[3]);
+	MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+
+	// Whole rows of the grid, starting from the first halo column
+	MPI_Irecv(deep_row(grid, 1 - depth) + 1 - depth, rows_count, MPI_DOUBLE, neighbours[DECOMPOSITION_TOP], DEEP_TAG_DOWNWARDS, communicator, &requests[0]);
+	MPI_Irecv(deep_row(grid, ROWS + 1) + 1 - depth, rows_count, MPI_DOUBLE, neighbours[DECOMPOSITION_BOTTOM], DEEP_TAG_UPWARDS, communicator, &requests[1]);
+	MPI_Isend(deep_row(grid, ROWS + 1 - depth) + 1 - depth, rows_count, MPI_DOUBLE, neighbours[DECOMPOSITION_BOTTOM], DEEP_TAG_DOWNWARDS, communicator, &requests[2]);
+	MPI_Isend(deep_row(grid, 1) + 1 - depth, rows_count, MPI_DOUBLE, neighbours[DECOMPOSITION_TOP], DEEP_TAG_UPWARDS, communicator, &requests[3]);
+	MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+}
+
+/**
+ * @brief Runs one iteration of a trip, on the tile extended on each side that has a neighbour.
+ * @param[in] start The grid the trip starts from.
+ * @param[in] sweep The iteration, counted from 1 at the start of the trip.
+ * @param[in] extension The number of cells the tile is extended by.
+ * @return The maximal temperature change across the cells of the tile computed by my OpenMP thread; those of the extension are left out.
+ **/
+static double deep_sweep(int start, unsigned int sweep, int extension)
+{
+	const int* neighbours = decomposition_neighbours;
+	int first_row = 1 - ((neighbours[DECOMPOSITION_TOP] != MPI_PROC_NULL) ? extension : 0);
+	int last_row = ROWS + ((neighbours[DECOMPOSITION_BOTTOM] != MPI_PROC_NULL) ? extension : 0);
+	int left = (neighbours[DECOMPOSITION_LEFT] != MPI_PROC_NULL) ? extension : 0;
+	int right = (neighbours[DECOMPOSITION_RIGHT] != MPI_PROC_NULL) ? extension : 0;
+	int source = deep_grid(start, sweep - 1);
+	int target = deep_grid(start, sweep);
+
+	double dt = 0.0;
+	double profile_start = profile_now();
+	long rows_computed = 0;
+	#pragma omp for schedule(static) nowait
+	for(int i = first_row; i <= last_row; i++)
+	{
+		double* row = deep_row(target, i);
+		const double* above = deep_row(source, i - 1);
+		const double* middle = deep_row(source, i);
+		const double* below = deep_row(source, i + 1);
+		if(i < 1 || i > ROWS)
+		{
+			KERNEL_SPAN(kernel_row, row, above, middle, below, 1 - left, COLUMNS + right);
+		}
+		else
+		{
+			if(left > 0)
+			{
+				KERNEL_SPAN(kernel_row, row, above, middle, below, 1 - left, 0);
+			}
+			dt = fmax(KERNEL_SPAN(kernel_row, row, above, middle, below, 1, COLUMNS), dt);
+			if(right > 0)
+			{
+				KERNEL_SPAN(kernel_row, row, above, middle, below, COLUMNS + 1, COLUMNS + right);
+			}
+		}
+		rows_computed++;
+	}
+	profile_add(PROFILE_STENCIL, profile_start, rows_computed * (left + COLUMNS + right));
+
+	return dt;
+}
+
+void deep_initialise(double grid[ROWS+2][COLUMNS+2])
+{
+	int my_rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+	// The halos of the smallest tiles, the last ones of each dimension, come from a single neighbour
+	int depth = config_halo_depth;
+	int smallest_rows = decomposition_extent(0, decomposition_dimensions[0] - 1);
+	int smallest_columns = decomposition_extent(1, decomposition_dimensions[1] - 1);
+	if(depth > DEEP_MAX_DEPTH || depth > smallest_rows || depth > smallest_columns)
+	{
+		if(my_rank == 0)
+		{
+			printf("Halos of %d cells are deeper than %d, or than the smallest tile, of %d x %d cells.\n", depth, DEEP_MAX_DEPTH, smallest_rows, smallest_columns);
+		}
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	if(my_rank == 0)
+	{
+		fprintf(stderr, "Jacobi iterations with halos %d cells deep, swapped every %d iterations at most.\n", depth, depth);
+	}
+
+	int thread_count = 1;
+	#ifdef _OPENMP
+		thread_count = omp_get_max_threads();
+	#endif
+	deep_row_length = (size_t)COLUMNS + 2 * depth;
+	size_t grid_size = ((size_t)ROWS + 2 * depth) * deep_row_length;
+	deep_grids[0] = malloc(sizeof(double) * DEEP_GRIDS * grid_size);
+	deep_slots = malloc(sizeof(double) * thread_count * DEEP_SLOT_STRIDE);
+	if(deep_grids[0] == NULL || deep_slots == NULL)
+	{
+		printf("Failed to allocate the grids with deep halos.\n");
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+
+	// First touch: each row is zeroed by the thread that computes it later, then the temperatures and boundaries are
+	// copied in
+	deep_grids[1] = deep_grids[0] + grid_size;
+	deep_grids[2] = deep_grids[1] + grid_size;
+	#pragma omp parallel for schedule(static)
+	for(int i = 1 - depth; i <= ROWS + depth; i++)
+	{
+		double* row = deep_row(0, i) + 1 - depth;
+		for(size_t j = 0; j < deep_row_length; j++)
+		{
+			row[j] = 0.0;
+		}
+		if(i >= 0 && i <= ROWS + 1)
+		{
+			memcpy(deep_row(0, i), grid[i], sizeof(double) * (COLUMNS + 2));
+		}
+	}
+
+	MPI_Type_vector(ROWS + 2, depth, (int)deep_row_length, MPI_DOUBLE, &deep_columns);
+	MPI_Type_commit(&deep_columns);
+
+	// The iterations read the boundaries of the neighbours next to the overlap, which no iteration computes, in all
+	// grids. They never change, so they are swapped once here and copied along with the rest.
+	deep_swap(0);
+	for(int g = 1; g < DEEP_GRIDS; g++)
+	{
+		#pragma omp parallel for schedule(static)
+		for(int i = 1 - depth; i <= ROWS + depth; i++)
+		{
+			memcpy(deep_row(g, i) + 1 - depth, deep_row(0, i) + 1 - depth, sizeof(double) * deep_row_length);
+		}
+	}
+
+	// All threads start from the first grid, including the copies of deep_current of those not created yet
+	#pragma omp parallel
+	{
+		deep_current = 0;
+	}
+}
+
+unsigned int deep_depth(unsigned int iteration)
+{
+	unsigned int end = iteration + config_halo_depth;
+
+	// Do not go past the next progress printing, checkpoint or snapshot, which need the temperatures of that very
+	// iteration
+	unsigned int next_print = (iteration / PRINT_FREQUENCY + 1) * PRINT_FREQUENCY;
+	if(end > next_print)
+	{
+		end = next_print;
+	}
+	if(config_checkpoint_frequency > 0)
+	{
+		unsigned int next_checkpoint = (iteration / config_checkpoint_frequency + 1) * config_checkpoint_frequency;
+		if(end > next_checkpoint)
+		{
+			end = next_checkpoint;
+		}
+	}
+	if(config_snapshot_frequency > 0)
+	{
+		unsigned int next_snapshot = (iteration / config_snapshot_frequency + 1) * config_snapshot_frequency;
+		if(end > next_snapshot)
+		{
+			end = next_snapshot;
+		}
+	}
+
+	// Nor past the last iteration allowed
+	if(end > MAX_NUMBER_OF_ITERATIONS + 1)
+	{
+		end = MAX_NUMBER_OF_ITERATIONS + 1;
+	}
+
+	return end - iteration;
+}
+
+unsigned int deep_advance(double grid[ROWS+2][COLUMNS+2], unsigned int depth, int needed, double dt_trip[DEEP_MAX_DEPTH])
+{
+	int thread_count = 1;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_count = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+	#endif
+	double* slots = deep_slots + thread_id * DEEP_SLOT_STRIDE;
+	int start = deep_current;
+	double profile_start;
+
+	#pragma omp master
+	{
+		profile_start = profile_now();
+		deep_swap(start);
+		profile_add(PROFILE_HALO, profile_start, 0);
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	// Each iteration computes one cell less on each side than the one before, down to the tile alone at the last one
+	for(unsigned int sweep = 1; sweep <= depth; sweep++)
+	{
+		slots[sweep - 1] = deep_sweep(start, sweep, depth - sweep);
+		// The next iteration needs the cells just computed by the other threads, and the same barrier publishes the
+		// temperature change of each thread
+		#pragma omp barrier
+	}
+
+	// A single reduction across MPI processes for all the iterations of the trip
+	#pragma omp master
+	{
+		profile_start = profile_now();
+		double dt[DEEP_MAX_DEPTH];
+		for(unsigned int sweep = 0; sweep < depth; sweep++)
+		{
+			dt[sweep] = 0.0;
+			for(int t = 0; t < thread_count; t++)
+			{
+				dt[sweep] = fmax(deep_slots[t * DEEP_SLOT_STRIDE + sweep], dt[sweep]);
+			}
+		}
+		profile_add(PROFILE_REDUCTION, profile_start, 0);
+
+		profile_start = profile_now();
+		MPI_Allreduce(dt, deep_dt_global, depth, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	unsigned int advanced = depth;
+	for(unsigned int sweep = 0; sweep < depth; sweep++)
+	{
+		dt_trip[sweep] = deep_dt_global[sweep];
+		if(advanced == depth && dt_trip[sweep] <= MAX_TEMP_ERROR)
+		{
+			advanced = sweep + 1;
+		}
+	}
+
+	// Should an iteration before the last converge, the grid of that iteration was overwritten since, so the trip is
+	// run again from its start up to it. The halos swapped are deep enough for fewer iterations.
+	if(advanced < depth)
+	{
+		for(unsigned int sweep = 1; sweep <= advanced; sweep++)
+		{
+			deep_sweep(start, sweep, advanced - sweep);
+			#pragma omp barrier
+		}
+	}
+	deep_current = deep_grid(start, advanced);
+
+	if(needed || dt_trip[advanced - 1] <= MAX_TEMP_ERROR)
+	{
+		profile_start = profile_now();
+		#pragma omp for schedule(static)
+		for(int i = 1; i <= ROWS; i++)
+		{
+			memcpy(&grid[i][1], deep_row(deep_current, i) + 1, sizeof(double) * COLUMNS);
+		}
+		profile_add(PROFILE_STENCIL, profile_start, 0);
+	}
+
+	return advanced;
+}
+
+void deep_finalise(void)
+{
+	MPI_Type_free(&deep_columns);
+	free(deep_grids[0]);
+	free(deep_slots);
+	for(int g = 0; g < DEEP_GRIDS; g++)
+	{
+		deep_grids[g] = NULL;
+	}
+	deep_slots = NULL;
+}
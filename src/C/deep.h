@@ -0,0 +1,50 @@
+/**
+ * @file deep.h
+ * @brief This file contains the Jacobi solver with deep halos of the MPI versions.
+ * @details With halos one cell deep, neighbours swap their boundaries after every iteration, and at many MPI processes the latency of those messages, rather than the stencil, bounds the time of an iteration. With halos config_halo_depth cells deep, k for short, each MPI process receives the k rows and columns of its neighbours nearest to its tile at once, then runs up to k iterations without any message: at the s-th of them, it computes its tile extended by k - s cells on each side it has a neighbour, those of the overlap being computed by the neighbours too. After k iterations, only the tile itself is up to date, and halos are swapped again. Messages are k times fewer, and their latency is paid once every k iterations, at the cost of recomputing an overlap that shrinks from k - 1 cells on each side to none.
+ *
+ * Halos are swapped with messages, whatever config_halo_backend is: columns first, then rows along with the halo columns just received, so that the corners of the overlap come from the diagonal neighbours without messages of their own. Every cell is computed by the same kernel and from the same temperatures as it would be with one-cell halos, so the temperatures are identical. The temperature change of each iteration is that of the tile alone, and those of the k iterations are combined across all MPI processes by a single reduction; should one of them converge, the iterations are run again from the start up to it, so that the iteration reached, the temperature change and the temperatures are exactly those of the Jacobi solver with one-cell halos.
+ *
+ * The solver keeps the temperatures in three grids of its own, with their deep halos: the one the latest halo swap was made on, and two used by turns for the iterations. They are copied into the grid given only when its temperatures are needed.
+ **/
+
+#ifndef DEEP_H_INCLUDED
+#define DEEP_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// Maximum value of config_halo_depth.
+#define DEEP_MAX_DEPTH 64
+
+/**
+ * @brief Allocates the grids with deep halos, and copies temperatures into them.
+ * @details The program is aborted if config_halo_depth exceeds DEEP_MAX_DEPTH, or the extents of a tile.
+ * @param[in] grid The temperatures to start from, with their boundaries set.
+ * @pre decomposition_initialise() has been called, and it is called by all MPI processes.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void deep_initialise(double grid[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Gives the number of iterations to run before the next halo swap.
+ * @param[in] iteration The last iteration run.
+ * @return config_halo_depth, or fewer so as not to go past the next iteration whose temperatures are needed: the next progress printing, checkpoint or snapshot, and the last iteration allowed.
+ **/
+unsigned int deep_depth(unsigned int iteration);
+/**
+ * @brief Swaps the halos, then runs iterations up to the first one that converges.
+ * @param[inout] grid The grid the temperatures are copied into, halos excluded, if \p needed is set or convergence is reached.
+ * @param[in] depth The number of iterations to run, at most config_halo_depth.
+ * @param[in] needed Whether the temperatures of the last iteration run are needed on return.
+ * @param[out] dt_trip The temperature change across all MPI processes of each iteration run. All OpenMP threads get the same.
+ * @return The number of iterations run: \p depth, or fewer if one of them converged.
+ * @pre kernel_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, if any, with the same arguments, and by all MPI processes.
+ **/
+unsigned int deep_advance(double grid[ROWS+2][COLUMNS+2], unsigned int depth, int needed, double dt_trip[DEEP_MAX_DEPTH]);
+/**
+ * @brief Frees the grids with deep halos.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void deep_finalise(void);
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file front.c
+ **/
+
+#include "front.h"
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+	#include "decomposition.h"
+#endif
+
+/// The front after an iteration, minus that iteration.
+static int front_lag = 0;
+
+/**
+ * @brief Gives the global row of a row of my tile.
+ * @param[in] i The row of my tile.
+ * @return The row of the whole grid.
+ **/
+static inline int front_global_row(int i)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		return decomposition_offsets[0] + i;
+	#else
+		return i;
+	#endif
+}
+
+/**
+ * @brief Gives the global column of a column of my tile.
+ * @param[in] j The column of my tile.
+ * @return The column of the whole grid.
+ **/
+static inline int front_global_column(int j)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		return decomposition_offsets[1] + j;
+	#else
+		return j;
+	#endif
+}
+
+void front_initialise(double grid[ROWS+2][COLUMNS+2], unsigned int iteration)
+{
+	// The front is the largest distance of a warm cell to the nearest of the right and bottom boundaries
+	int reached = 0;
+	#pragma omp parallel for schedule(static) reduction(max:reached)
+	for(int i = 1; i <= ROWS; i++)
+	{
+		int row_distance = ROWS_GLOBAL + 1 - front_global_row(i);
+		for(int j = 1; j <= COLUMNS; j++)
+		{
+			if(grid[i][j] != 0.0)
+			{
+				int column_distance = COLUMNS_GLOBAL + 1 - front_global_column(j);
+				int distance = (row_distance < column_distance) ? row_distance : column_distance;
+				if(distance > reached)
+				{
+					reached = distance;
+				}
+			}
+		}
+	}
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Allreduce(MPI_IN_PLACE, &reached, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	#endif
+	front_lag = reached - (int)iteration;
+}
+
+int front_first_column(unsigned int iteration, int i)
+{
+	int reach = (int)iteration + front_lag;
+
+	// Rows the front has reached may change whole, the others from the first column it has reached
+	if(front_global_row(i) > ROWS_GLOBAL - reach)
+	{
+		return 1;
+	}
+	int first = COLUMNS_GLOBAL + 1 - reach - front_global_column(0);
+	if(first < 1)
+	{
+		return 1;
+	}
+	return (first > COLUMNS + 1) ? COLUMNS + 1 : first;
+}
+
+#ifdef VERSION_RUN_IS_MPI
+/**
+ * @brief Tells whether a cell is still 0 after an iteration.
+ * @param[in] iteration The iteration.
+ * @param[in] row The global row of the cell.
+ * @param[in] column The global column of the cell.
+ * @return 1 if it is farther from both the right and bottom boundaries than the front, 0 otherwise.
+ **/
+static int front_cold(unsigned int iteration, int row, int column)
+{
+	int reach = (int)iteration + front_lag;
+	return row <= ROWS_GLOBAL - reach && column <= COLUMNS_GLOBAL - reach;
+}
+
+void front_quiet(unsigned int iteration, int quiet[4])
+{
+	// Of the two boundaries swapped with a neighbour, the one farther right or down is the first to warm up, and it
+	// is cold as long as its bottom-right cell is
+	int last_row = front_global_row(ROWS);
+	int last_column = front_global_column(COLUMNS);
+	quiet[DECOMPOSITION_TOP] = front_cold(iteration, front_global_row(1), last_column);
+	quiet[DECOMPOSITION_BOTTOM] = front_cold(iteration, last_row + 1, last_column);
+	quiet[DECOMPOSITION_LEFT] = front_cold(iteration, last_row, front_global_column(1));
+	quiet[DECOMPOSITION_RIGHT] = front_cold(iteration, last_row, last_column + 1);
+}
+#endif
@@ -0,0 +1,38 @@
+/**
+ * @file front.h
+ * @brief This file contains the tracking of the front the heat has reached, used by the Jacobi solver to skip cells still cold.
+ * @details The temperatures start at 0 inside the plate, and on the top and left boundaries, so heat only enters through the right and bottom boundaries. A Jacobi iteration moves it by at most one cell, so after n iterations only the cells within n cells of the right boundary, or of the bottom one, may differ from 0; the others are exactly 0, and so is the change an iteration makes to them. On large grids, a top-left rectangle of the plate is still cold when the simulation converges, and sweeping it is wasted.
+ *
+ * The front is the number of cells from the right and bottom boundaries beyond which every temperature is 0. It is measured once on the temperatures the simulation starts from, which may come from a checkpoint, and grows by one cell per iteration from there. The sweeps of the Jacobi solver in double precision with one-cell halos, that is those of the tiled and tasked engines, see tiling.h and tasking.h, and those of kernel_tile() in the MPI versions, start each row at the first column the front may have reached, and the MPI versions leave out of the halo swap the neighbours whose boundaries and mine are both still cold. The other solvers, the mixed-precision sweeps of mixed.h and the deep halo sweeps of deep.h included, sweep every cell. Cells left out stay at 0 in every grid, so the temperatures, the temperature changes and the iteration at which convergence is reached are exactly those of a full sweep.
+ **/
+
+#ifndef FRONT_H_INCLUDED
+#define FRONT_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/**
+ * @brief Measures how far the heat has gone in the temperatures the simulation starts from.
+ * @param[in] grid The temperatures; only those of my tile are read, boundaries excluded.
+ * @param[in] iteration The iteration those temperatures are that of.
+ * @pre It is called outside of any OpenMP parallel region and, in the MPI versions, by all MPI processes, once decomposition_initialise() has been called.
+ **/
+void front_initialise(double grid[ROWS+2][COLUMNS+2], unsigned int iteration);
+/**
+ * @brief Gives the first column of a row that an iteration may change.
+ * @param[in] iteration The iteration computed, or any later one: the further, the more cells are included.
+ * @param[in] i The row, between 1 and ROWS.
+ * @return 1 if the whole row may change, COLUMNS + 1 if none of it may.
+ **/
+int front_first_column(unsigned int iteration, int i);
+#ifdef VERSION_RUN_IS_MPI
+/**
+ * @brief Tells which neighbours exchange only cold boundaries at an iteration.
+ * @details Both MPI processes of a pair come to the same answer, so that they agree on leaving the pair out of the halo swap.
+ * @param[in] iteration The iteration whose boundaries are swapped, or any later one.
+ * @param[out] quiet For my top, bottom, left and right neighbours, 1 if my boundary next to it and its boundary next to me are both still 0 after that iteration, 0 otherwise.
+ **/
+void front_quiet(unsigned int iteration, int quiet[4]);
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file grid.c
+ **/
+
+#define _GNU_SOURCE // posix_memalign, madvise
+#include "grid.h"
+#include <stdio.h> // printf
+#include <stdlib.h> // posix_memalign, EXIT_FAILURE
+#ifdef GRID_HUGE_PAGES
+	#include <sys/mman.h> // madvise
+#endif
+
+void* grid_allocate(unsigned int rows, unsigned int columns)
+{
+	size_t row_length = (size_t)columns + 2;
+	size_t size = sizeof(double) * ((size_t)rows + 2) * row_length;
+	size_t alignment = GRID_ALIGNMENT;
+	double* grid = NULL;
+
+	#ifdef GRID_HUGE_PAGES
+		// Round the size up to a multiple of the huge page size so that no page is shared with another allocation
+		alignment = GRID_HUGE_PAGE_SIZE;
+		size = (size + GRID_HUGE_PAGE_SIZE - 1) / GRID_HUGE_PAGE_SIZE * GRID_HUGE_PAGE_SIZE;
+	#endif
+
+	if(posix_memalign((void**)&grid, alignment, size) != 0)
+	{
+		printf("Failed to allocate a grid of %zu bytes.\n", size);
+		exit(EXIT_FAILURE);
+	}
+
+	#if defined(GRID_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+		// The advice must be given before the pages are touched, it is only a hint so a failure is not fatal
+		madvise(grid, size, MADV_HUGEPAGE);
+	#endif
+
+	// First touch: each row is zeroed by the thread that computes it later
+	#pragma omp parallel for schedule(static)
+	for(unsigned int i = 1; i <= rows; i++)
+	{
+		for(size_t j = 0; j < row_length; j++)
+		{
+			grid[i * row_length + j] = 0.0;
+		}
+	}
+
+	// Boundary rows
+	for(size_t j = 0; j < row_length; j++)
+	{
+		grid[j] = 0.0;
+		grid[(rows + 1) * row_length + j] = 0.0;
+	}
+
+	return grid;
+}
+
+void grid_free(void* grid)
+{
+	free(grid);
+}
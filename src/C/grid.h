@@ -0,0 +1,29 @@
+/**
+ * @file grid.h
+ * @brief This file contains the functions used to allocate the temperature grids on the heap.
+ * @details Grids are aligned on cache lines and, if the macro 'GRID_HUGE_PAGES' is defined at compilation, backed by transparent huge pages where the system supports them. Their pages are first touched by the OpenMP threads that compute on them later, so that each page is placed on the NUMA node of the thread owning it.
+ **/
+
+#ifndef GRID_H_INCLUDED
+#define GRID_H_INCLUDED
+
+/// Alignment of the grids, in bytes.
+#define GRID_ALIGNMENT 64
+/// Alignment of the grids when backed by huge pages, in bytes.
+#define GRID_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * @brief Allocates a temperature grid.
+ * @details The grid allocated contains (rows + 2) x (columns + 2) doubles, boundaries included, stored row by row. Rows 1 to \p rows are zeroed by the OpenMP threads using the same static partitioning as the calculation loops, so that they are first touched by the thread that will compute them. Boundary rows 0 and \p rows + 1 are zeroed by the calling thread.
+ * @param[in] rows The number of rows, excluding boundaries.
+ * @param[in] columns The number of columns, excluding boundaries.
+ * @return A pointer to the grid allocated, to be cast into a pointer to rows of (columns + 2) doubles. If the allocation fails, the program is terminated.
+ **/
+void* grid_allocate(unsigned int rows, unsigned int columns);
+/**
+ * @brief Frees a grid allocated with grid_allocate().
+ * @param[in] grid The grid to free.
+ **/
+void grid_free(void* grid);
+
+#endif
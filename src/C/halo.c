@@ -0,0 +1,569 @@
+/**
+ * @file halo.c
+ **/
+
+// sched_yield is POSIX, not C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "halo.h"
+#include "decomposition.h"
+#include "profile.h"
+#include <mpi.h> // MPI_*
+#include <sched.h> // sched_yield
+#include <stdio.h> // printf
+#include <stdlib.h> // malloc, free, EXIT_FAILURE
+#include <string.h> // memcpy
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+/// Tag of the messages sent to the bottom neighbour.
+#define HALO_TAG_DOWNWARDS 0
+/// Tag of the messages sent to the top neighbour.
+#define HALO_TAG_UPWARDS 1
+/// Tag of the messages sent to the right neighbour.
+#define HALO_TAG_RIGHTWARDS 2
+/// Tag of the messages sent to the left neighbour.
+#define HALO_TAG_LEFTWARDS 3
+/// Tag of the messages of the first segment, see halo_segment_start(); segment s uses the four tags from HALO_TAG_SEGMENTS + 4 * s, in the order above, and the first and last columns those of the first segment.
+#define HALO_TAG_SEGMENTS 16
+/// Number of requests per grid: one send and one receive per neighbour.
+#define HALO_REQUESTS_PER_GRID 8
+/// Alignment of the grids in the window, in bytes, which is also the room left for the control block before them.
+#define HALO_ALIGNMENT 64
+
+/// The control block at the start of the part of the window of each MPI process, written by that process only.
+typedef struct
+{
+	/// The number of halo swaps started.
+	volatile long started;
+	/// The number of halo swaps for which the boundaries of the neighbours on the node were copied.
+	volatile long copied;
+	/// The number of rows of the tile.
+	int rows;
+	/// The number of columns of the tile.
+	int columns;
+} halo_control;
+
+/// The number of grids allocated by halo_initialise().
+static unsigned int halo_grid_count = 0;
+/// The grids allocated by halo_initialise().
+static double* halo_grids[HALO_MAX_GRIDS];
+/// The persistent requests of each grid.
+static MPI_Request halo_requests[HALO_MAX_GRIDS][HALO_REQUESTS_PER_GRID];
+/// The number of segments the first and last rows are cut in, see halo_segment_count().
+static int halo_segments = 1;
+/// The persistent requests of each segment of each grid, if config_halo_backend is CONFIG_HALO_THREADS, NULL otherwise.
+static MPI_Request* halo_segment_requests = NULL;
+/// A column of a grid, halos excluded.
+static MPI_Datatype halo_column = MPI_DATATYPE_NULL;
+/// The grid whose halo swap is in progress.
+static int halo_active = -1;
+/// The neighbours left out of the halo swap in progress.
+static int halo_quiet[4] = {0, 0, 0, 0};
+/// The window holding the control blocks and grids of the MPI processes of my node.
+static MPI_Win halo_window = MPI_WIN_NULL;
+/// The control block of my MPI process.
+static halo_control* halo_mine = NULL;
+/// The control blocks of my top, bottom, left and right neighbours if they are on my node, NULL otherwise.
+static halo_control* halo_shared[4];
+/// The grids of those neighbours.
+static double* halo_shared_grids[4][HALO_MAX_GRIDS];
+/// The number of halo swaps started by my MPI process.
+static long halo_swaps = 0;
+/// The window through which neighbours put their boundaries in my halos, if config_halo_backend is CONFIG_HALO_RMA.
+static MPI_Win halo_rma_window = MPI_WIN_NULL;
+/// The group of my neighbours, which access and expose windows in each halo swap.
+static MPI_Group halo_rma_group = MPI_GROUP_NULL;
+/// The ranks of my top, bottom, left and right neighbours, MPI_PROC_NULL for those missing.
+static int halo_rma_neighbours[4];
+/// Where my boundaries go in the window of each neighbour, for each grid, in cells.
+static MPI_Aint halo_rma_targets[4][HALO_MAX_GRIDS];
+/// A column of a grid of each neighbour, halos excluded; rows of neighbours on the left and right differ from mine in length.
+static MPI_Datatype halo_rma_columns[4];
+
+/**
+ * @brief Gives the room taken by a grid in the window.
+ * @param[in] rows The number of rows of the grid, excluding boundaries.
+ * @param[in] columns The number of columns of the grid, excluding boundaries.
+ * @return The size of the grid rounded up to a multiple of HALO_ALIGNMENT, in bytes.
+ **/
+static size_t halo_grid_size(int rows, int columns)
+{
+	size_t size = sizeof(double) * ((size_t)rows + 2) * ((size_t)columns + 2);
+	return (size + HALO_ALIGNMENT - 1) / HALO_ALIGNMENT * HALO_ALIGNMENT;
+}
+
+/**
+ * @brief Finds a grid among those allocated by halo_initialise().
+ * @param[in] grid The grid.
+ * @return Its index.
+ **/
+static int halo_grid_index(double grid[ROWS+2][COLUMNS+2])
+{
+	int g = 0;
+	while(halo_grids[g] != &grid[0][0])
+	{
+		g++;
+	}
+	return g;
+}
+
+/**
+ * @brief Waits until a counter of a neighbour on my node reaches a value.
+ * @param[in] counter The counter, in the control block of the neighbour.
+ * @param[in] value The value to reach.
+ **/
+static void halo_wait(volatile long* counter, long value)
+{
+	while(*counter < value)
+	{
+		MPI_Win_sync(halo_window);
+		sched_yield();
+	}
+	// What the neighbour wrote before updating the counter is visible from here on
+	MPI_Win_sync(halo_window);
+}
+
+void halo_initialise(unsigned int grid_count, double* grids[])
+{
+	// Tiles on the edges of the grid lack some neighbours, messages to MPI_PROC_NULL complete immediately
+	int neighbours[4];
+	for(int n = 0; n < 4; n++)
+	{
+		neighbours[n] = decomposition_neighbours[n];
+	}
+	MPI_Comm communicator = decomposition_communicator;
+
+	// The MPI processes of my node share a window holding, for each of them, a control block followed by its grids.
+	// Parts need not be contiguous, so that each can be placed on the NUMA node of its MPI process.
+	MPI_Comm node;
+	MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+	MPI_Info info;
+	MPI_Info_create(&info);
+	MPI_Info_set(info, "alloc_shared_noncontig", "true");
+	size_t grid_size = halo_grid_size(ROWS, COLUMNS);
+	char* base;
+	MPI_Win_allocate_shared(HALO_ALIGNMENT + grid_count * grid_size, 1, info, node, &base, &halo_window);
+	MPI_Info_free(&info);
+	MPI_Win_lock_all(MPI_MODE_NOCHECK, halo_window);
+
+	halo_mine = (halo_control*)base;
+	halo_mine->started = 0;
+	halo_mine->copied = 0;
+	halo_mine->rows = ROWS;
+	halo_mine->columns = COLUMNS;
+	halo_swaps = 0;
+
+	halo_grid_count = grid_count;
+	for(unsigned int g = 0; g < halo_grid_count; g++)
+	{
+		halo_grids[g] = (double*)(base + HALO_ALIGNMENT + g * grid_size);
+		grids[g] = halo_grids[g];
+		double (*grid)[COLUMNS+2] = (double (*)[COLUMNS+2])halo_grids[g];
+
+		// First touch: each row is zeroed by the thread that computes it later
+		#pragma omp parallel for schedule(static)
+		for(int i = 1; i <= ROWS; i++)
+		{
+			for(int j = 0; j < COLUMNS + 2; j++)
+			{
+				grid[i][j] = 0.0;
+			}
+		}
+		for(int j = 0; j < COLUMNS + 2; j++)
+		{
+			grid[0][j] = 0.0;
+			grid[ROWS+1][j] = 0.0;
+		}
+	}
+
+	// Control blocks must be written before neighbours read them
+	MPI_Win_sync(halo_window);
+	MPI_Barrier(node);
+	MPI_Win_sync(halo_window);
+
+	// Neighbours on my node are read directly, the others are sent messages
+	MPI_Group communicator_group;
+	MPI_Group node_group;
+	MPI_Comm_group(communicator, &communicator_group);
+	MPI_Comm_group(node, &node_group);
+	for(int n = 0; n < 4; n++)
+	{
+		halo_shared[n] = NULL;
+		int node_rank = MPI_UNDEFINED;
+		if(neighbours[n] != MPI_PROC_NULL && config_halo_backend == CONFIG_HALO_SHARED)
+		{
+			MPI_Group_translate_ranks(communicator_group, 1, &neighbours[n], node_group, &node_rank);
+		}
+		if(node_rank != MPI_UNDEFINED)
+		{
+			MPI_Aint size;
+			int displacement_unit;
+			char* neighbour_base;
+			MPI_Win_shared_query(halo_window, node_rank, &size, &displacement_unit, &neighbour_base);
+			halo_shared[n] = (halo_control*)neighbour_base;
+			size_t neighbour_grid_size = halo_grid_size(halo_shared[n]->rows, halo_shared[n]->columns);
+			for(unsigned int g = 0; g < halo_grid_count; g++)
+			{
+				halo_shared_grids[n][g] = (double*)(neighbour_base + HALO_ALIGNMENT + g * neighbour_grid_size);
+			}
+			neighbours[n] = MPI_PROC_NULL;
+		}
+	}
+	MPI_Group_free(&node_group);
+	MPI_Comm_free(&node);
+
+	// With one-sided communications, neighbours put my halos straight in my grids. My window covers the same bytes as my
+	// part of the shared window, so that grids are found at the same displacements in both. A single MPI process has no
+	// neighbour to put anything to.
+	int communicator_size;
+	MPI_Comm_size(communicator, &communicator_size);
+	if(config_halo_backend == CONFIG_HALO_RMA && communicator_size > 1)
+	{
+		MPI_Win_create(base, HALO_ALIGNMENT + grid_count * grid_size, sizeof(double), MPI_INFO_NULL, communicator, &halo_rma_window);
+		int group_ranks[4];
+		int group_size = 0;
+		for(int n = 0; n < 4; n++)
+		{
+			halo_rma_neighbours[n] = neighbours[n];
+			halo_rma_columns[n] = MPI_DATATYPE_NULL;
+			if(neighbours[n] == MPI_PROC_NULL)
+			{
+				continue;
+			}
+			group_ranks[group_size++] = neighbours[n];
+
+			// The extents of the tile of the neighbour
+			int coordinates[2] = {decomposition_coordinates[0], decomposition_coordinates[1]};
+			switch(n)
+			{
+				case DECOMPOSITION_TOP:
+					coordinates[0]--;
+					break;
+				case DECOMPOSITION_BOTTOM:
+					coordinates[0]++;
+					break;
+				case DECOMPOSITION_LEFT:
+					coordinates[1]--;
+					break;
+				case DECOMPOSITION_RIGHT:
+					coordinates[1]++;
+					break;
+			}
+			int rows = decomposition_extent(0, coordinates[0]);
+			int columns = decomposition_extent(1, coordinates[1]);
+			MPI_Aint row_length = columns + 2;
+			MPI_Aint grid_cells = halo_grid_size(rows, columns) / sizeof(double);
+			for(unsigned int g = 0; g < halo_grid_count; g++)
+			{
+				MPI_Aint first = HALO_ALIGNMENT / sizeof(double) + g * grid_cells;
+				switch(n)
+				{
+					case DECOMPOSITION_TOP:
+						halo_rma_targets[n][g] = first + (rows + 1) * row_length + 1;
+						break;
+					case DECOMPOSITION_BOTTOM:
+						halo_rma_targets[n][g] = first + 1;
+						break;
+					case DECOMPOSITION_LEFT:
+						halo_rma_targets[n][g] = first + row_length + columns + 1;
+						break;
+					case DECOMPOSITION_RIGHT:
+						halo_rma_targets[n][g] = first + row_length;
+						break;
+				}
+			}
+			if(n == DECOMPOSITION_LEFT || n == DECOMPOSITION_RIGHT)
+			{
+				MPI_Type_vector(ROWS, 1, row_length, MPI_DOUBLE, &halo_rma_columns[n]);
+				MPI_Type_commit(&halo_rma_columns[n]);
+			}
+			neighbours[n] = MPI_PROC_NULL;
+		}
+		MPI_Group_incl(communicator_group, group_size, group_ranks, &halo_rma_group);
+	}
+	MPI_Group_free(&communicator_group);
+
+	// One cell per row, rows being COLUMNS + 2 cells apart
+	MPI_Type_vector(ROWS, 1, COLUMNS + 2, MPI_DOUBLE, &halo_column);
+	MPI_Type_commit(&halo_column);
+
+	int top_neighbour = neighbours[DECOMPOSITION_TOP];
+	int bottom_neighbour = neighbours[DECOMPOSITION_BOTTOM];
+	int left_neighbour = neighbours[DECOMPOSITION_LEFT];
+	int right_neighbour = neighbours[DECOMPOSITION_RIGHT];
+	for(unsigned int g = 0; g < halo_grid_count; g++)
+	{
+		double (*grid)[COLUMNS+2] = (double (*)[COLUMNS+2])halo_grids[g];
+		MPI_Recv_init(&grid[0][1], COLUMNS, MPI_DOUBLE, top_neighbour, HALO_TAG_DOWNWARDS, communicator, &halo_requests[g][0]);
+		MPI_Recv_init(&grid[ROWS+1][1], COLUMNS, MPI_DOUBLE, bottom_neighbour, HALO_TAG_UPWARDS, communicator, &halo_requests[g][1]);
+		MPI_Recv_init(&grid[1][0], 1, halo_column, left_neighbour, HALO_TAG_RIGHTWARDS, communicator, &halo_requests[g][2]);
+		MPI_Recv_init(&grid[1][COLUMNS+1], 1, halo_column, right_neighbour, HALO_TAG_LEFTWARDS, communicator, &halo_requests[g][3]);
+		MPI_Send_init(&grid[ROWS][1], COLUMNS, MPI_DOUBLE, bottom_neighbour, HALO_TAG_DOWNWARDS, communicator, &halo_requests[g][4]);
+		MPI_Send_init(&grid[1][1], COLUMNS, MPI_DOUBLE, top_neighbour, HALO_TAG_UPWARDS, communicator, &halo_requests[g][5]);
+		MPI_Send_init(&grid[1][COLUMNS], 1, halo_column, right_neighbour, HALO_TAG_RIGHTWARDS, communicator, &halo_requests[g][6]);
+		MPI_Send_init(&grid[1][1], 1, halo_column, left_neighbour, HALO_TAG_LEFTWARDS, communicator, &halo_requests[g][7]);
+	}
+
+	// Each segment of the first and last rows has requests of its own, told apart by their tags. The first and last
+	// columns go with the segments holding their cells of those rows, the other segments have no neighbour on the left
+	// and right; my first segment swaps with the last one of my left neighbour, so columns are tagged alike in all.
+	halo_segments = 1;
+	#ifdef _OPENMP
+		halo_segments = omp_get_max_threads();
+	#endif
+	if(config_halo_backend == CONFIG_HALO_THREADS)
+	{
+		// Neighbours must cut their rows alike
+		int counts[2] = {-halo_segments, halo_segments};
+		MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_INT, MPI_MAX, communicator);
+		int rank;
+		MPI_Comm_rank(communicator, &rank);
+		if(-counts[0] != counts[1])
+		{
+			if(rank == 0)
+			{
+				printf("The threads halo backend needs as many OpenMP threads in all MPI processes.\n");
+			}
+			MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+		}
+
+		halo_segment_requests = malloc(sizeof(MPI_Request) * halo_grid_count * halo_segments * HALO_REQUESTS_PER_GRID);
+		if(halo_segment_requests == NULL)
+		{
+			printf("Failed to allocate the requests of the halo segments.\n");
+			MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+		}
+		for(unsigned int g = 0; g < halo_grid_count; g++)
+		{
+			double (*grid)[COLUMNS+2] = (double (*)[COLUMNS+2])halo_grids[g];
+			for(int segment = 0; segment < halo_segments; segment++)
+			{
+				MPI_Request* requests = halo_segment_requests + (g * halo_segments + segment) * HALO_REQUESTS_PER_GRID;
+				int first;
+				int last;
+				halo_segment_columns(segment, &first, &last);
+				int count = last - first + 1;
+				int tag = HALO_TAG_SEGMENTS + 4 * segment;
+				int column_tag = HALO_TAG_SEGMENTS;
+				int left = (first == 1 && count > 0) ? left_neighbour : MPI_PROC_NULL;
+				int right = (last == COLUMNS && count > 0) ? right_neighbour : MPI_PROC_NULL;
+				MPI_Recv_init(&grid[0][first], count, MPI_DOUBLE, top_neighbour, tag + HALO_TAG_DOWNWARDS, communicator, &requests[0]);
+				MPI_Recv_init(&grid[ROWS+1][first], count, MPI_DOUBLE, bottom_neighbour, tag + HALO_TAG_UPWARDS, communicator, &requests[1]);
+				MPI_Recv_init(&grid[1][0], 1, halo_column, left, column_tag + HALO_TAG_RIGHTWARDS, communicator, &requests[2]);
+				MPI_Recv_init(&grid[1][COLUMNS+1], 1, halo_column, right, column_tag + HALO_TAG_LEFTWARDS, communicator, &requests[3]);
+				MPI_Send_init(&grid[ROWS][first], count, MPI_DOUBLE, bottom_neighbour, tag + HALO_TAG_DOWNWARDS, communicator, &requests[4]);
+				MPI_Send_init(&grid[1][first], count, MPI_DOUBLE, top_neighbour, tag + HALO_TAG_UPWARDS, communicator, &requests[5]);
+				MPI_Send_init(&grid[1][COLUMNS], 1, halo_column, right, column_tag + HALO_TAG_RIGHTWARDS, communicator, &requests[6]);
+				MPI_Send_init(&grid[1][1], 1, halo_column, left, column_tag + HALO_TAG_LEFTWARDS, communicator, &requests[7]);
+			}
+		}
+	}
+}
+
+void halo_start(double grid[ROWS+2][COLUMNS+2], const int quiet[4])
+{
+	double profile_start = profile_now();
+	halo_active = halo_grid_index(grid);
+	for(int n = 0; n < 4; n++)
+	{
+		halo_quiet[n] = (quiet != NULL) ? quiet[n] : 0;
+	}
+
+	// The receive from neighbour n is request n, the send to it request 4 + (n ^ 1), n ^ 1 being the opposite side.
+	// Requests of the neighbours left out are not started, and MPI_Waitall() ignores them.
+	MPI_Request* requests = halo_requests[halo_active];
+	if(quiet == NULL)
+	{
+		MPI_Startall(HALO_REQUESTS_PER_GRID, requests);
+	}
+	else
+	{
+		for(int n = 0; n < 4; n++)
+		{
+			if(!quiet[n])
+			{
+				MPI_Start(&requests[n]);
+				MPI_Start(&requests[4 + (n ^ 1)]);
+			}
+		}
+	}
+
+	// Expose my halos to my neighbours, and put my boundaries in theirs
+	if(halo_rma_window != MPI_WIN_NULL)
+	{
+		MPI_Win_post(halo_rma_group, 0, halo_rma_window);
+		MPI_Win_start(halo_rma_group, 0, halo_rma_window);
+		for(int n = 0; n < 4; n++)
+		{
+			int neighbour = halo_rma_neighbours[n];
+			if(neighbour == MPI_PROC_NULL || halo_quiet[n])
+			{
+				continue;
+			}
+			MPI_Aint target = halo_rma_targets[n][halo_active];
+			switch(n)
+			{
+				case DECOMPOSITION_TOP:
+					MPI_Put(&grid[1][1], COLUMNS, MPI_DOUBLE, neighbour, target, COLUMNS, MPI_DOUBLE, halo_rma_window);
+					break;
+				case DECOMPOSITION_BOTTOM:
+					MPI_Put(&grid[ROWS][1], COLUMNS, MPI_DOUBLE, neighbour, target, COLUMNS, MPI_DOUBLE, halo_rma_window);
+					break;
+				case DECOMPOSITION_LEFT:
+					MPI_Put(&grid[1][1], 1, halo_column, neighbour, target, 1, halo_rma_columns[n], halo_rma_window);
+					break;
+				case DECOMPOSITION_RIGHT:
+					MPI_Put(&grid[1][COLUMNS], 1, halo_column, neighbour, target, 1, halo_rma_columns[n], halo_rma_window);
+					break;
+			}
+		}
+	}
+
+	// Tell neighbours on my node that my boundaries are ready
+	halo_swaps++;
+	MPI_Win_sync(halo_window);
+	halo_mine->started = halo_swaps;
+	profile_add(PROFILE_HALO, profile_start, 0);
+}
+
+void halo_finish(void)
+{
+	double profile_start = profile_now();
+	double (*grid)[COLUMNS+2] = (double (*)[COLUMNS+2])halo_grids[halo_active];
+
+	// Copy the boundaries of neighbours on my node once they are ready. Those above and below hold as many columns as
+	// I do, those on the left and right as many rows.
+	for(int n = 0; n < 4; n++)
+	{
+		halo_control* neighbour = halo_shared[n];
+		if(neighbour == NULL || halo_quiet[n])
+		{
+			continue;
+		}
+		halo_wait(&neighbour->started, halo_swaps);
+		size_t row_length = (size_t)neighbour->columns + 2;
+		double* cells = halo_shared_grids[n][halo_active];
+		switch(n)
+		{
+			case DECOMPOSITION_TOP:
+				memcpy(&grid[0][1], &cells[neighbour->rows * row_length + 1], sizeof(double) * COLUMNS);
+				break;
+			case DECOMPOSITION_BOTTOM:
+				memcpy(&grid[ROWS+1][1], &cells[row_length + 1], sizeof(double) * COLUMNS);
+				break;
+			case DECOMPOSITION_LEFT:
+				for(int i = 1; i <= ROWS; i++)
+				{
+					grid[i][0] = cells[i * row_length + neighbour->columns];
+				}
+				break;
+			case DECOMPOSITION_RIGHT:
+				for(int i = 1; i <= ROWS; i++)
+				{
+					grid[i][COLUMNS+1] = cells[i * row_length + 1];
+				}
+				break;
+		}
+	}
+	MPI_Win_sync(halo_window);
+	halo_mine->copied = halo_swaps;
+
+	MPI_Waitall(HALO_REQUESTS_PER_GRID, halo_requests[halo_active], MPI_STATUSES_IGNORE);
+
+	// My boundaries are in the halos of my neighbours, and theirs in mine
+	if(halo_rma_window != MPI_WIN_NULL)
+	{
+		MPI_Win_complete(halo_rma_window);
+		MPI_Win_wait(halo_rma_window);
+	}
+
+	// My boundaries may only be overwritten once neighbours on my node have copied them
+	for(int n = 0; n < 4; n++)
+	{
+		if(halo_shared[n] != NULL)
+		{
+			halo_wait(&halo_shared[n]->copied, halo_swaps);
+		}
+	}
+	halo_active = -1;
+	profile_add(PROFILE_HALO, profile_start, 0);
+}
+
+int halo_segment_count(void)
+{
+	return halo_segments;
+}
+
+void halo_segment_columns(int segment, int* first, int* last)
+{
+	// Like a schedule(static) loop over columns 1 to COLUMNS
+	int columns_per_segment = COLUMNS / halo_segments;
+	int columns_remaining = COLUMNS % halo_segments;
+	*first = 1 + segment * columns_per_segment + (segment < columns_remaining ? segment : columns_remaining);
+	*last = *first + columns_per_segment - 1 + (segment < columns_remaining ? 1 : 0);
+}
+
+void halo_segment_start(double grid[ROWS+2][COLUMNS+2], const int quiet[4], int segment)
+{
+	double profile_start = profile_now();
+	MPI_Request* requests = halo_segment_requests + (halo_grid_index(grid) * halo_segments + segment) * HALO_REQUESTS_PER_GRID;
+
+	// Requests are laid out as those of the whole rows, see halo_start()
+	for(int n = 0; n < 4; n++)
+	{
+		if(quiet == NULL || !quiet[n])
+		{
+			MPI_Start(&requests[n]);
+			MPI_Start(&requests[4 + (n ^ 1)]);
+		}
+	}
+	profile_add(PROFILE_HALO, profile_start, 0);
+}
+
+void halo_segment_finish(double grid[ROWS+2][COLUMNS+2], int segment)
+{
+	double profile_start = profile_now();
+	MPI_Request* requests = halo_segment_requests + (halo_grid_index(grid) * halo_segments + segment) * HALO_REQUESTS_PER_GRID;
+	MPI_Waitall(HALO_REQUESTS_PER_GRID, requests, MPI_STATUSES_IGNORE);
+	profile_add(PROFILE_HALO, profile_start, 0);
+}
+
+void halo_finalise(void)
+{
+	for(unsigned int g = 0; g < halo_grid_count; g++)
+	{
+		for(int r = 0; r < HALO_REQUESTS_PER_GRID; r++)
+		{
+			MPI_Request_free(&halo_requests[g][r]);
+		}
+	}
+	if(halo_segment_requests != NULL)
+	{
+		for(unsigned int r = 0; r < halo_grid_count * halo_segments * HALO_REQUESTS_PER_GRID; r++)
+		{
+			MPI_Request_free(&halo_segment_requests[r]);
+		}
+		free(halo_segment_requests);
+		halo_segment_requests = NULL;
+	}
+	MPI_Type_free(&halo_column);
+	if(halo_rma_window != MPI_WIN_NULL)
+	{
+		MPI_Win_free(&halo_rma_window);
+		MPI_Group_free(&halo_rma_group);
+		for(int n = 0; n < 4; n++)
+		{
+			if(halo_rma_columns[n] != MPI_DATATYPE_NULL)
+			{
+				MPI_Type_free(&halo_rma_columns[n]);
+			}
+		}
+	}
+
+	// The grids go with the window
+	MPI_Win_unlock_all(halo_window);
+	MPI_Win_free(&halo_window);
+	halo_grid_count = 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * @file halo.h
+ * @brief This file contains the halo swap used by the MPI versions.
+ * @details The grid is split in tiles, one per MPI process, see decomposition.h. After each iteration, every MPI process sends its first and last rows to its top and bottom neighbours, and its first and last columns to its left and right neighbours, and receives theirs in its halos. The swap is non-blocking: halo_start() posts it once the first and last rows are computed, and halo_finish() completes it, so that the other rows are computed while messages are in flight.
+ *
+ * The grids are allocated by halo_initialise() in a window shared by the MPI processes of each node, so that, unless config_halo_backend is CONFIG_HALO_MESSAGES, neighbours on the same node copy each other's boundaries straight from their grids instead of exchanging messages. Each MPI process counts the swaps it has started and completed in its part of the window; a neighbour's boundary is copied once it has started the same swap, and a swap completes once all neighbours on the node have copied mine, so that boundaries are not overwritten while being read. Neighbours on other nodes exchange messages, through persistent requests created once per grid. Columns are not contiguous in memory, they are described by a strided datatype instead of being packed.
+ *
+ * If config_halo_backend is CONFIG_HALO_THREADS, all neighbours exchange messages, and the hybrid version splits them among its OpenMP threads, as permitted by MPI_THREAD_MULTIPLE: the first and last rows are cut in as many segments as there are threads, each sent and received by the thread that computes it as soon as it is computed, with a tag of its own, so that messages leave before the whole tile is computed and through as many queues of the network interface as there are threads. The threads computing the segments that hold the first and last columns of those rows also send and receive these columns, so that no corner is computed by one thread and sent by another. All MPI processes must run as many OpenMP threads, so that neighbours cut their rows alike. halo_start() and halo_finish() still swap whole rows, for the solvers run by the master thread only.
+ *
+ * If config_halo_backend is CONFIG_HALO_RMA, each MPI process exposes its grids in a window instead, and puts its boundaries straight in the halos of its neighbours with MPI_Put(), in post-start-complete-wait epochs restricted to its neighbours: halo_start() opens the epochs, halo_finish() closes them. No receive is matched and no tag is involved.
+ **/
+
+#ifndef HALO_H_INCLUDED
+#define HALO_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// Maximum number of grids whose halos can be swapped: three temperature grids, or a single one along with the vectors of the conjugate gradient solver, see conjugate.h.
+#define HALO_MAX_GRIDS 3
+
+/**
+ * @brief Allocates the grids and prepares their halo swaps.
+ * @details The grids are zeroed, each row by the OpenMP thread that computes it later, like grid_allocate() does.
+ * @param[in] grid_count The number of grids, at most HALO_MAX_GRIDS.
+ * @param[out] grids The grids allocated, each pointing to its first cell.
+ * @pre decomposition_initialise() has been called.
+ * @pre It is called by all MPI processes.
+ **/
+void halo_initialise(unsigned int grid_count, double* grids[]);
+/**
+ * @brief Starts the halo swap of a grid.
+ * @details The first and last rows and columns of \p grid are sent to the neighbours, and theirs are received in the halos of \p grid. Neighbours may be left out of the swap when their boundary and mine are known to be unchanged, which both must agree on; see front_quiet().
+ * @param[inout] grid The grid whose halos to swap, it must be one of those allocated by halo_initialise().
+ * @param[in] quiet For my top, bottom, left and right neighbours, whether to leave it out, the halo of \p grid next to it already holding its boundary; NULL to swap with all.
+ * @pre Rows 1 and ROWS and columns 1 and COLUMNS of \p grid are computed.
+ * @post Until halo_finish() returns, rows 1 and ROWS and columns 1 and COLUMNS of \p grid must not be modified and its halos must not be read.
+ **/
+void halo_start(double grid[ROWS+2][COLUMNS+2], const int quiet[4]);
+/**
+ * @brief Completes the halo swap started by halo_start().
+ **/
+void halo_finish(void);
+/**
+ * @brief Gives the number of segments the first and last rows are cut in if config_halo_backend is CONFIG_HALO_THREADS.
+ * @return The maximum number of OpenMP threads, 1 in versions without OpenMP.
+ * @pre halo_initialise() has been called.
+ **/
+int halo_segment_count(void);
+/**
+ * @brief Gives the columns of a segment of the first and last rows.
+ * @details Segments are as even as possible, and ordered from left to right; the last ones are empty if there are more segments than columns.
+ * @param[in] segment The segment, between 0 and halo_segment_count() - 1.
+ * @param[out] first The first column of the segment.
+ * @param[out] last The last column of the segment, first - 1 if the segment is empty.
+ **/
+void halo_segment_columns(int segment, int* first, int* last);
+/**
+ * @brief Starts the halo swap of a segment of the first and last rows of a grid, and of the first or last column along with the segment holding column 1 or COLUMNS.
+ * @param[inout] grid The grid whose halos to swap, it must be one of those allocated by halo_initialise().
+ * @param[in] quiet For my top, bottom, left and right neighbours, whether to leave it out, see halo_start(); NULL to swap with all.
+ * @param[in] segment The segment, between 0 and halo_segment_count() - 1.
+ * @pre config_halo_backend is CONFIG_HALO_THREADS.
+ * @pre The columns of the segment in rows 1 and ROWS of \p grid are computed; so is column 1 if the segment holds it, and column COLUMNS if it holds it.
+ * @post Until halo_segment_finish() returns, those cells must not be modified and the halos next to them must not be read.
+ **/
+void halo_segment_start(double grid[ROWS+2][COLUMNS+2], const int quiet[4], int segment);
+/**
+ * @brief Completes the halo swap of a segment started by halo_segment_start().
+ * @details It is called by the OpenMP thread that started it; each thread may have a swap of its own in progress.
+ * @param[inout] grid The grid whose halos are swapped.
+ * @param[in] segment The segment.
+ **/
+void halo_segment_finish(double grid[ROWS+2][COLUMNS+2], int segment);
+/**
+ * @brief Frees the grids and the persistent requests created by halo_initialise().
+ * @pre It is called by all MPI processes.
+ **/
+void halo_finalise(void);
+
+#endif
@@ -8,39 +8,508 @@
 
 #include <stdio.h> // printf
 #include <stdlib.h> // EXIT_FAILURE
-#include <math.h> // fabs
-#include <mpi.h> // MPI_*
 #include <string.h> // strcmp
-#include "util.h"  
+#include <math.h> // fmax
+#include <mpi.h> // MPI_*
+#include "util.h"
+#include "kernel.h"
+#include "decomposition.h"
+#include "halo.h"
+#include "convergence.h"
+#include "checkpoint.h"
+#include "relaxation.h"
+#include "multigrid.h"
+#include "conjugate.h"
+#include "mixed.h"
+#include "deep.h"
+#include "front.h"
+#include "tasking.h"
+#include "progress.h"
+#include "snapshot.h"
+#include "profile.h"
+#include <omp.h>
+
+/// Distance between the temperature change slots of two OpenMP threads, in doubles, so that each fills its own cache line.
+#define DT_SLOT_STRIDE 8
+
+/// The maximal temperature change found by each OpenMP thread, in two sets used by turns, see reduce().
+static double* dt_slots;
+/// The outcome of the convergence checks completed by the master thread, in two sets used by turns, see reduce().
+static double dt_global_shared[2];
+/// Same for the number of iterations the window checked needs to converge.
+static unsigned int needed_shared[2];
+/// The number of blocks the interior rows are split into when they are shared out as tasks, see advance().
+static int block_count;
+/// The maximal temperature change of each block of interior rows.
+static double* dt_blocks;
+
+/**
+ * @brief Computes a block of interior rows, first and last columns excluded.
+ * @param[out] current The grid in which to compute the iteration.
+ * @param[in] last The grid containing the temperatures of the last iteration.
+ * @param[in] front_iteration The furthest iteration any grid holds, which tells the cells left out.
+ * @param[in] block The block, of TASKING_BLOCK_ROWS rows from row 2.
+ * @return The maximal temperature change of the block.
+ **/
+static double advance_block(double current[ROWS+2][COLUMNS+2], double last[ROWS+2][COLUMNS+2], unsigned int front_iteration, int block)
+{
+	double profile_start = profile_now();
+	long cells = 0;
+	int i_first = 2 + block * TASKING_BLOCK_ROWS;
+	int i_final = (i_first + TASKING_BLOCK_ROWS - 1 < ROWS - 1) ? i_first + TASKING_BLOCK_ROWS - 1 : ROWS - 1;
+	double dt = kernel_tile(current, last, i_first, i_final, 2, COLUMNS - 1, front_iteration, &cells);
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+	return dt;
+}
+
+/**
+ * @brief Computes the cells sent to the neighbours: columns of the first and last rows, and the first or last column.
+ * @param[out] current The grid in which to compute the iteration.
+ * @param[in] last The grid containing the temperatures of the last iteration.
+ * @param[in] front_iteration The furthest iteration any grid holds, which tells the cells left out.
+ * @param[in] j_first The first column of rows 1 and ROWS to compute.
+ * @param[in] j_final The last column of rows 1 and ROWS to compute.
+ * @param[in] left Whether to compute column 1 of the other rows.
+ * @param[in] right Whether to compute column COLUMNS of the other rows.
+ * @return The maximal temperature change of the cells computed.
+ **/
+static double advance_boundary(double current[ROWS+2][COLUMNS+2], double last[ROWS+2][COLUMNS+2], unsigned int front_iteration, int j_first, int j_final, int left, int right)
+{
+	double profile_start = profile_now();
+	long cells = 0;
+	double dt = kernel_tile(current, last, 1, 1, j_first, j_final, front_iteration, &cells);
+	dt = fmax(kernel_tile(current, last, ROWS, ROWS, j_first, j_final, front_iteration, &cells), dt);
+	if(left)
+	{
+		dt = fmax(kernel_tile(current, last, 2, ROWS - 1, 1, 1, front_iteration, &cells), dt);
+	}
+	if(right)
+	{
+		dt = fmax(kernel_tile(current, last, 2, ROWS - 1, COLUMNS, COLUMNS, front_iteration, &cells), dt);
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+	return dt;
+}
+
+/**
+ * @brief Runs one iteration, without waiting for the other OpenMP threads.
+ * @details The master thread computes the first and last rows and columns first, so that they are sent to the neighbours while the other cells are computed. If config_halo_backend is CONFIG_HALO_THREADS, every thread computes its own segments of the first and last rows instead, the first and last columns going with the segments holding their cells of those rows, and swaps them on its own as soon as they are computed, see halo.h. The interior rows are shared out statically, so that every thread computes the same rows at every iteration; or, if config_threading is CONFIG_THREADING_TASKS, the master thread queues them as tasks of TASKING_BLOCK_ROWS rows before anything else, which the other threads run while the cells the neighbours need are computed and the halos swapped, so that none waits for a thread slowed down by the halo swap, or by anything else. The halos are received in \p current since it becomes the grid of the last iteration afterwards. Cells the heat cannot have reached are left out, see front.h.
+ * @param[out] current The grid in which to compute the iteration.
+ * @param[in] last The grid containing the temperatures of the last iteration.
+ * @param[in] front_iteration The furthest iteration any grid holds, at least the one computed, which tells the cells left out.
+ * @return The maximal temperature change found by my OpenMP thread, to be combined with the others by reduce(). With tasks, that of all tasks is returned by the master thread.
+ * @pre It is called by all OpenMP threads of the team, which then call reduce().
+ **/
+static double advance(double current[ROWS+2][COLUMNS+2], double last[ROWS+2][COLUMNS+2], unsigned int front_iteration)
+{
+	double dt = 0.0;
+	int quiet[4];
+	front_quiet(front_iteration, quiet);
+
+	// The interior rows do not need the halos being swapped, so they are queued first. The other threads run them as
+	// soon as they reach the barrier of reduce(), and the master thread joins them once the halo swap is started.
+	#pragma omp master
+	{
+		if(config_threading == CONFIG_THREADING_TASKS)
+		{
+			for(int b = 0; b < block_count; b++)
+			{
+				#pragma omp task firstprivate(b)
+				{
+					dt_blocks[b] = advance_block(current, last, front_iteration, b);
+				} // End of OpenMP task
+			}
+		}
+	} // End of OpenMP master region
+
+	// Average my four neighbours and find my maximal temperature change in the same pass, for the cells sent first
+	int thread_count = omp_get_num_threads();
+	int segment_count = halo_segment_count();
+	if(config_halo_backend == CONFIG_HALO_THREADS)
+	{
+		for(int segment = omp_get_thread_num(); segment < segment_count; segment += thread_count)
+		{
+			int j_first;
+			int j_final;
+			halo_segment_columns(segment, &j_first, &j_final);
+			int filled = j_first <= j_final;
+			dt = fmax(advance_boundary(current, last, front_iteration, j_first, j_final, filled && j_first == 1, filled && j_final == COLUMNS), dt);
+			halo_segment_start(current, quiet, segment);
+		}
+	}
+	else
+	{
+		#pragma omp master
+		{
+			dt = advance_boundary(current, last, front_iteration, 1, COLUMNS, 1, 1);
+			halo_start(current, quiet);
+		} // End of OpenMP master region
+	}
+
+	// The first and last columns are computed already
+	if(config_threading == CONFIG_THREADING_BANDS)
+	{
+		double profile_start = profile_now();
+		long cells = 0;
+		#pragma omp for schedule(static) nowait
+		for(int i = 2; i <= ROWS - 1; i++)
+		{
+			dt = fmax(kernel_tile(current, last, i, i, 2, COLUMNS - 1, front_iteration, &cells), dt);
+		}
+		profile_add(PROFILE_STENCIL, profile_start, cells);
+	}
+
+	#pragma omp master
+	{
+		// Run the tasks left while the halos travel, then combine the temperature changes of all blocks before the next
+		// iteration queues more
+		if(config_threading == CONFIG_THREADING_TASKS)
+		{
+			#pragma omp taskwait
+			for(int b = 0; b < block_count; b++)
+			{
+				dt = fmax(dt_blocks[b], dt);
+			}
+		}
+
+		if(config_halo_backend != CONFIG_HALO_THREADS)
+		{
+			halo_finish();
+		}
+	} // End of OpenMP master region
+
+	if(config_halo_backend == CONFIG_HALO_THREADS)
+	{
+		for(int segment = omp_get_thread_num(); segment < segment_count; segment += thread_count)
+		{
+			halo_segment_finish(current, segment);
+		}
+	}
+
+	return dt;
+}
+
+/**
+ * @brief Combines the maximal temperature changes found by the OpenMP threads, and waits for all of them.
+ * @details Each thread writes its own slot then waits at a single barrier, after which every thread reads all slots. If a convergence check is in progress, the master thread completes it before the barrier and its outcome is shared the same way. Slots alternate between two sets from one call to the next, so that a thread can fill a slot of the next call while the others still read those of this one.
+ * @param[in] dt The maximal temperature change found by my OpenMP thread.
+ * @param[inout] round The number of calls made so far by my OpenMP thread, incremented.
+ * @param[in] checking Whether a convergence check is to be completed.
+ * @param[out] needed If \p checking, the number of iterations the window checked needs to converge.
+ * @param[out] dt_global If \p checking, the temperature change across all MPI processes, see convergence_finish().
+ * @return The maximal temperature change of my MPI process.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static double reduce(double dt, unsigned int* round, int checking, unsigned int* needed, double* dt_global)
+{
+	int thread_count = omp_get_num_threads();
+	int set = *round % 2;
+	double* slots = dt_slots + set * thread_count * DT_SLOT_STRIDE;
+	(*round)++;
+
+	slots[omp_get_thread_num() * DT_SLOT_STRIDE] = dt;
+	if(checking)
+	{
+		#pragma omp master
+		{
+			needed_shared[set] = convergence_finish(&dt_global_shared[set]);
+		} // End of OpenMP master region
+	}
+
+	double profile_start = profile_now();
+	#pragma omp barrier
+
+	for(int t = 0; t < thread_count; t++)
+	{
+		dt = fmax(slots[t * DT_SLOT_STRIDE], dt);
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+	if(checking)
+	{
+		*needed = needed_shared[set];
+		*dt_global = dt_global_shared[set];
+	}
+	return dt;
+}
+
+/**
+ * @brief Picks the grid in which to compute the next iteration.
+ * @param[in] grid_count The number of grids.
+ * @param[in] last The index of the grid containing the temperatures of the last iteration.
+ * @param[in] kept The index of a grid that must not be overwritten, ignored if there are only two grids.
+ * @return The index of the first grid that is neither \p last nor \p kept.
+ **/
+static int spare_grid(int grid_count, int last, int kept)
+{
+	int spare = 0;
+	while(spare == last || (grid_count > 2 && spare == kept))
+	{
+		spare++;
+	}
+	return spare;
+}
+
+/**
+ * @brief Runs the simulation, from within the parallel region.
+ * @details Every OpenMP thread runs the same control flow on its own copy of the loop state, which stays identical across threads since the temperature changes and the outcome of convergence checks are shared with all of them. Only the master thread calls MPI, as permitted by MPI_THREAD_FUNNELED, but for the halo swaps of the threads halo backend, which need MPI_THREAD_MULTIPLE; threads wait for each other once per iteration, in reduce().
+ * @param[in] grid_count The number of grids.
+ * @param[in] grids The grids, the one at index \p last holding the initial temperatures.
+ * @param[inout] iteration_reached The first iteration to run; the iteration at which the simulation stopped on return.
+ * @param[inout] last_grid The index of the grid holding the temperatures of the last iteration.
+ * @param[out] dt_global_reached The temperature change across all MPI processes when the simulation stopped.
+ * @param[in] tracking Whether my MPI process prints the progress.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void solve(int grid_count, double (*grids[3])[COLUMNS+2], int* iteration_reached, int* last_grid, double* dt_global_reached, int tracking)
+{
+    // Current iteration
+    int iteration = *iteration_reached;
+    // Temperature change for our MPI process
+    double dt = 0.0;
+    // Temperature change across all MPI processes
+    double dt_global = *dt_global_reached;
+    // Number of calls to reduce() so far
+    unsigned int round = 0;
+    // Index of the grid holding the temperatures of the last iteration
+    int last = *last_grid;
+    // Iteration the convergence check window in progress started from, its last iteration and the grid it started from
+    unsigned int window_first = *iteration_reached;
+    unsigned int window_last = convergence_window_end(window_first);
+    int window_first_grid = last;
+    // Same for the window whose convergence check is in progress, plus the grid of its last iteration
+    int checking = 0;
+    unsigned int checked_first = 0;
+    unsigned int checked_last = 0;
+    int checked_first_grid = 0;
+    int checked_last_grid = 0;
+
+    for(;;)
+    {
+        // Run the next iteration, if allowed, while the convergence check of the last window completes. It must not
+        // overwrite the grid that window started from, in case it has to be replayed.
+        int next = spare_grid(grid_count, last, checking ? checked_first_grid : window_first_grid);
+        int allowed = iteration <= MAX_NUMBER_OF_ITERATIONS;
+        if(allowed)
+        {
+            dt = advance(grids[next], grids[last], iteration + 1);
+        }
+
+        // The convergence check of the last window completes at the barrier that ends the iteration
+        unsigned int needed = 0;
+        dt = reduce(dt, &round, checking, &needed, &dt_global);
+
+        if(checking)
+        {
+            checking = 0;
+            if(dt_global <= MAX_TEMP_ERROR || !allowed)
+            {
+                // The iteration just run is discarded. If convergence was reached before the end of the window, the
+                // window is replayed from the grid it started from up to that iteration. The grids it overwrites may hold
+                // the iteration just run, whose heat went further.
+                unsigned int furthest = iteration + 1;
+                iteration = checked_first + needed;
+                last = checked_last_grid;
+                if(checked_first + needed < checked_last)
+                {
+                    last = checked_first_grid;
+                    for(unsigned int i = 0; i < needed; i++)
+                    {
+                        next = spare_grid(grid_count, last, last);
+                        reduce(advance(grids[next], grids[last], furthest), &round, 0, NULL, NULL);
+                        last = next;
+                    }
+                }
+            }
+
+            // Periodically record test values, before the next iteration may overwrite them
+            if((iteration % PRINT_FREQUENCY) == 0 && iteration == (int)checked_last)
+            {
+                #pragma omp master
+                {
+                    if(tracking)
+                    {
+                        checkpoint_track_progress(iteration, grids[checked_last_grid]);
+                    }
+                } // End of OpenMP master region
+                #pragma omp barrier
+            }
+
+            if(dt_global <= MAX_TEMP_ERROR || !allowed)
+            {
+                break;
+            }
+
+            // Periodically save the temperatures, before the next iteration may overwrite them
+            if(checkpoint_due(iteration))
+            {
+                #pragma omp master
+                {
+                    checkpoint_write(iteration, grids[checked_last_grid], dt_global);
+                } // End of OpenMP master region
+                #pragma omp barrier
+            }
+
+            // Periodically save a snapshot of the temperatures, before the next iteration may overwrite them
+            if(snapshot_due(iteration))
+            {
+                #pragma omp master
+                {
+                    snapshot_write(iteration, grids[checked_last_grid], dt_global);
+                } // End of OpenMP master region
+                #pragma omp barrier
+            }
+        }
+
+        iteration++;
+        last = next;
+
+        // At the end of a window, start combining its temperature changes with those of other MPI processes
+        #pragma omp master
+        {
+            convergence_record(dt);
+            if(iteration == (int)window_last)
+            {
+                convergence_start();
+            }
+        } // End of OpenMP master region
+        if(iteration == (int)window_last)
+        {
+            checking = 1;
+            checked_first = window_first;
+            checked_last = window_last;
+            checked_first_grid = window_first_grid;
+            checked_last_grid = last;
+            window_first = iteration;
+            window_last = convergence_window_end(window_first);
+            window_first_grid = last;
+        }
+    }
+
+    #pragma omp master
+    {
+        *iteration_reached = iteration;
+        *last_grid = last;
+        *dt_global_reached = dt_global;
+    } // End of OpenMP master region
+}
+
+/**
+ * @brief Runs the simulation with a solver that updates the grid in place, from within the parallel region.
+ * @details The temperature changes are combined across all MPI processes at every iteration, by relaxation_advance() for the red-black solver, see relaxation.h, by multigrid_cycle() for the multigrid one, see multigrid.h, by conjugate_advance() for the conjugate gradient one, see conjugate.h, by mixed_advance() for the mixed-precision one, see mixed.h, or by deep_advance() for the Jacobi one with deep halos, see deep.h, which runs several iterations at once. Every OpenMP thread runs the same control flow, both giving them all the same temperature changes.
+ * @param[inout] grid The grid, holding the initial temperatures.
+ * @param[inout] iteration_reached The first iteration to run; the iteration at which the simulation stopped on return.
+ * @param[inout] dt_global_reached The temperature change across all MPI processes of the iteration before the first one; that when the simulation stopped on return.
+ * @param[in] tracking Whether my MPI process prints the progress.
+ * @pre relaxation_initialise(), multigrid_initialise(), conjugate_initialise(), mixed_initialise() or deep_initialise() has been called, depending on the solver.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void relax(double grid[ROWS+2][COLUMNS+2], int* iteration_reached, double* dt_global_reached, int tracking)
+{
+    int iteration = *iteration_reached;
+    double dt_global = *dt_global_reached;
+
+    // Temperature change of each iteration run at once, several with deep halos
+    double dt_trip[DEEP_MAX_DEPTH];
+
+    while(dt_global > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
+    {
+        unsigned int advanced = 1;
+        if(config_solver == CONFIG_SOLVER_SOR)
+        {
+            dt_trip[0] = relaxation_advance(grid);
+        }
+        else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+        {
+            dt_trip[0] = multigrid_cycle(grid);
+        }
+        else if(config_solver == CONFIG_SOLVER_CG)
+        {
+            dt_trip[0] = conjugate_advance(grid);
+        }
+        else if(config_precision == CONFIG_PRECISION_MIXED)
+        {
+            // The temperatures are needed when progress is printed, when a checkpoint is written, when a snapshot is
+            // taken and at the last iteration allowed
+            int needed = ((iteration + 1) % PRINT_FREQUENCY) == 0 || checkpoint_due(iteration + 1) || snapshot_due(iteration + 1) || iteration + 1 > MAX_NUMBER_OF_ITERATIONS;
+            dt_trip[0] = mixed_advance(grid, needed);
+        }
+        else
+        {
+            // Deep halos stop short of the iterations whose temperatures are needed, so only the last one may be
+            unsigned int depth = deep_depth(iteration);
+            int needed = ((iteration + depth) % PRINT_FREQUENCY) == 0 || checkpoint_due(iteration + depth) || snapshot_due(iteration + depth) || iteration + depth > MAX_NUMBER_OF_ITERATIONS;
+            advanced = deep_advance(grid, depth, needed, dt_trip);
+        }
+        for(unsigned int k = 0; k < advanced; k++)
+        {
+            progress_log(dt_trip[k]);
+        }
+        dt_global = dt_trip[advanced - 1];
+        iteration += advanced;
+
+        // Periodically record test values, before the next iteration overwrites them
+        if((iteration % PRINT_FREQUENCY) == 0)
+        {
+            #pragma omp master
+            {
+                if(tracking)
+                {
+                    checkpoint_track_progress(iteration, grid);
+                }
+            } // End of OpenMP master region
+            #pragma omp barrier
+        }
+
+        // Periodically save the temperatures, before the next iteration overwrites them
+        if(dt_global > MAX_TEMP_ERROR && checkpoint_due(iteration))
+        {
+            #pragma omp master
+            {
+                checkpoint_write(iteration, grid, dt_global);
+            } // End of OpenMP master region
+            #pragma omp barrier
+        }
+
+        // Periodically save a snapshot of the temperatures, unless the last one, saved once the parallel region is over
+        if(dt_global > MAX_TEMP_ERROR && snapshot_due(iteration))
+        {
+            #pragma omp master
+            {
+                snapshot_write(iteration, grid, dt_global);
+            } // End of OpenMP master region
+            #pragma omp barrier
+        }
+    }
+
+    #pragma omp master
+    {
+        *iteration_reached = iteration;
+        *dt_global_reached = dt_global;
+    } // End of OpenMP master region
+}
 
 /**
  * @brief Runs the experiment.
- * @pre The macro 'ROWS' contains the number of rows (excluding boundaries) per MPI process. It is a define passed as a compilation flag, see makefile.
- * @pre The macro 'COLUMNS' contains the number of columns (excluding boundaries). It is a define passed as a compilation flag, see makefile.
+ * @details The grid size and the other settings of the run are read from the command line or the environment, see config.h.
  **/
 int main(int argc, char *argv[])
 {
-	// Temperature grid.
-	double temperature[ROWS+2][COLUMNS+2];
-	// Temperature grid from last iteration
-	double temperature_last[ROWS+2][COLUMNS+2]; 
 	// Current iteration.
     int iteration = 0;
-    // Temperature change for our MPI process
-    double dt;
     // Temperature change across all MPI processes
     double dt_global = 100;
     // The number of MPI processes in total
     int comm_size;
     // The rank of my MPI process
     int my_rank;
-    // Status returned by MPI calls
-    MPI_Status status;
 
-    // The usual MPI startup routines
+    // The usual MPI startup routines. Only the master thread calls MPI, but the threads halo backend needs every thread
+    // to, so the halo backend is looked up before MPI is initialised and the configuration read.
+    const char* halo_backend = config_peek(argc, argv, "--halo-backend");
+    int required = (halo_backend != NULL && strcmp(halo_backend, "threads") == 0) ? MPI_THREAD_MULTIPLE : MPI_THREAD_FUNNELED;
 	int provided;
-	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
-	if(provided < MPI_THREAD_FUNNELED)
+	MPI_Init_thread(&argc, &argv, required, &provided);
+	if(provided < required)
     {
         printf("The threading support level is lesser than that demanded.\n");
         MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
@@ -48,16 +517,27 @@ int main(int argc, char *argv[])
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
 
-    if(strcmp(VERSION_RUN, "hybrid_small") == 0 && comm_size != 2)
-    {
-        printf("The small version is meant to be run with 2 MPI processes, not %d.\n", comm_size);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
-    else if(strcmp(VERSION_RUN, "hybrid_big") == 0 && comm_size != 8)
-    {
-        printf("The big version is meant to be run with 8 MPI processes, not %d.\n", comm_size);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
+    // Read the grid size and the other settings of the run
+    config_initialise(argc, argv);
+
+    // Split the grid in tiles, one per MPI process
+    decomposition_initialise();
+
+    // The grids. A third one is needed when convergence is checked every few iterations, so that a window that
+    // converged before its end can be replayed from the grid it started from, and a single one by the red-black,
+    // multigrid, conjugate gradient, mixed-precision and deep halo solvers which update it in place, the latter through
+    // grids of its own.
+    // They are allocated along with their halo swaps, in memory shared with the MPI processes of my node, followed by
+    // the vectors whose halos the conjugate gradient solver swaps.
+    double (*grids[HALO_MAX_GRIDS])[COLUMNS+2] = {NULL, NULL, NULL};
+    int grid_count = CONFIG_IN_PLACE ? 1 : (config_convergence_window > 1) ? 3 : 2;
+    int vector_count = (config_solver == CONFIG_SOLVER_CG) ? CONJUGATE_HALO_VECTORS : 0;
+    halo_initialise(grid_count + vector_count, (double**)grids);
+
+    // Temperature grid.
+    double (*temperature)[COLUMNS+2] = grids[0];
+    // Temperature grid from last iteration
+    double (*temperature_last)[COLUMNS+2] = (grid_count > 1) ? grids[1] : grids[0];
 
     if(my_rank == 0)
     {
@@ -67,91 +547,117 @@ int main(int argc, char *argv[])
     // Initialise temperatures and temperature_last including boundary conditions
     initialise_temperatures(temperature, temperature_last);
 
-    ///////////////////////////////////
-    // -- Code from here is timed -- //
-    ///////////////////////////////////
-    if(my_rank == 0)
+    // Pick the stencil kernel best suited to this processor
+    kernel_initialise();
+
+    // Only the boundaries of the third grid matter, so it is initialised on its own
+    if(grid_count == 3)
     {
-        start_timer(&timer_simulation);
+        initialise_temperatures(grids[2], grids[2]);
     }
 
-    while(dt_global > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
-    {
-        iteration++;
+    // Index of the grid holding the temperatures of the last iteration
+    int last = (grid_count > 1) ? 1 : 0;
 
-        // Main calculation: average my four neighbours
-		#pragma omp parallel for
-        for(unsigned int i = 1; i <= ROWS; i++)
-        {
-            for(unsigned int j = 1; j <= COLUMNS; j++)
-            {
-                temperature[i][j] = 0.25 * (temperature_last[i+1][j  ] +
-                                            temperature_last[i-1][j  ] +
-                                            temperature_last[i  ][j+1] +
-                                            temperature_last[i  ][j-1]);
-            }
-        }
+    // Buffer the progress, printed once the timer is stopped, including that of the checkpoint resumed from
+    progress_initialise();
 
-        //////////////////////
-        // HALO SWAP PHASE //
-        ////////////////////
+    // Prepare the snapshots of the temperatures, if asked for
+    snapshot_initialise();
 
-        // If we are not the last MPI process, we have a bottom neighbour
-        if(my_rank != comm_size-1)
-        {
-			// We send our bottom row to our bottom neighbour
-            MPI_Send(&temperature[ROWS][1], COLUMNS, MPI_DOUBLE, my_rank+1, 0, MPI_COMM_WORLD);
-        }
+    // Resume from a checkpoint if asked to, swapping the halos of the temperatures read
+    checkpoint_initialise();
+    if(config_restart_file != NULL)
+    {
+        iteration = checkpoint_read(grids[last], &dt_global);
+        halo_start(grids[last], NULL);
+        halo_finish();
+    }
 
-        // If we are not the first MPI process, we have a top neighbour
-        if(my_rank != 0)
-        {
-            // We receive the bottom row from that neighbour into our top halo
-            MPI_Recv(&temperature_last[0][1], COLUMNS, MPI_DOUBLE, my_rank-1, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-        }
+    // The Jacobi solver skips the cells the heat has not reached yet
+    if(!CONFIG_IN_PLACE)
+    {
+        front_initialise(grids[last], iteration);
+    }
 
-        // If we are not the first MPI process, we have a top neighbour
-        if(my_rank != 0)
-        {
-            // Send out top row to our top neighbour
-            MPI_Send(&temperature[1][1], COLUMNS, MPI_DOUBLE, my_rank-1, 0, MPI_COMM_WORLD);
-        }
+    // Keep the temperature changes of the iterations whose convergence is checked together
+    convergence_initialise();
 
-        // If we are not the last MPI process, we have a bottom neighbour
-        if(my_rank != comm_size-1)
-        {   
-            // We receive the top row from that neighbour into our bottom halo
-            MPI_Recv(&temperature_last[ROWS+1][1], COLUMNS, MPI_DOUBLE, my_rank+1, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-        }
+    // Time the phases of the hot loop from here on
+    profile_initialise();
 
-        //////////////////////////////////////
-        // FIND MAXIMAL TEMPERATURE CHANGE //
-        ////////////////////////////////////
-        dt = 0.0;
+    ///////////////////////////////////
+    // -- Code from here is timed -- //
+    ///////////////////////////////////
+    if(my_rank == 0)
+    {
+        start_timer(&timer_simulation);
+    }
 
-		#pragma omp parallel for reduction(max:dt)
-        for(unsigned int i = 1; i <= ROWS; i++)
+    // A single parallel region runs the whole simulation; see solve(), or relax() for the red-black, multigrid,
+    // conjugate gradient, mixed-precision and deep halo solvers
+    dt_slots = malloc(sizeof(double) * 2 * omp_get_max_threads() * DT_SLOT_STRIDE);
+    if(dt_slots == NULL)
+    {
+        printf("Failed to allocate the temperature change slots.\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    block_count = (ROWS > 2) ? (ROWS - 2 + TASKING_BLOCK_ROWS - 1) / TASKING_BLOCK_ROWS : 0;
+    dt_blocks = malloc(sizeof(double) * (block_count + 1));
+    if(dt_blocks == NULL)
+    {
+        printf("Failed to allocate the temperature changes of the blocks.\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    if(config_solver == CONFIG_SOLVER_SOR)
+    {
+        relaxation_initialise();
+    }
+    else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+    {
+        multigrid_initialise();
+    }
+    else if(config_solver == CONFIG_SOLVER_CG)
+    {
+        conjugate_initialise((double**)&grids[grid_count]);
+    }
+    else if(config_precision == CONFIG_PRECISION_MIXED)
+    {
+        mixed_initialise();
+    }
+    else if(config_halo_depth > 1)
+    {
+        deep_initialise(grids[last]);
+    }
+    #pragma omp parallel
+    {
+        if(CONFIG_IN_PLACE)
         {
-            for(unsigned int j = 1; j <= COLUMNS; j++)
-            {
-    	        dt = fmax(fabs(temperature[i][j]-temperature_last[i][j]), dt);
-    	        temperature_last[i][j] = temperature[i][j];
-            }
+            relax(grids[last], &iteration, &dt_global, my_rank == comm_size - 1);
         }
-
-        // We know our temperature delta, we now need to sum it with that of other MPI processes
-        MPI_Reduce(&dt, &dt_global, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        MPI_Bcast(&dt_global, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-
-        // Periodically print test values
-        if((iteration % PRINT_FREQUENCY) == 0)
+        else
         {
-            if(my_rank == comm_size - 1)
-            {
-                track_progress(iteration, temperature);
-    	    }
+            solve(grid_count, grids, &iteration, &last, &dt_global, my_rank == comm_size - 1);
         }
+    } // End of OpenMP parallel region
+    if(config_solver == CONFIG_SOLVER_SOR)
+    {
+        relaxation_finalise();
     }
+    else if(config_solver == CONFIG_SOLVER_CG)
+    {
+        conjugate_finalise();
+    }
+    else if(config_precision == CONFIG_PRECISION_MIXED)
+    {
+        mixed_finalise();
+    }
+    else if(config_halo_depth > 1)
+    {
+        deep_finalise();
+    }
+    free(dt_slots);
+    free(dt_blocks);
 
     // Slightly more accurate timing and cleaner output 
     MPI_Barrier(MPI_COMM_WORLD);
@@ -162,15 +668,40 @@ int main(int argc, char *argv[])
     if(my_rank == 0)
     {
         stop_timer(&timer_simulation);
+        timer_simulation -= checkpoint_elapsed();
+    }
+
+    // Print the progress recorded, on the MPI process of rank 0 so that it comes out before the summary
+    progress_finalise(iteration);
+    if(my_rank == 0)
+    {
         print_summary(iteration, dt_global, timer_simulation);
     }
 
+    // Save a snapshot of the temperatures reached, if asked for, and wait for all snapshots to be written
+    snapshot_finalise(iteration, grids[last], dt_global);
+
+    // Write the time spent in each phase across all MPI processes, if asked to
+    profile_report(iteration, timer_simulation);
+
+    // Tell how far the multigrid solution is from that of the Jacobi solver, if asked to
+    if(config_solver == CONFIG_SOLVER_MULTIGRID)
+    {
+        multigrid_compare(grids[last]);
+        multigrid_finalise();
+    }
+
 	// Print the halo swap verification cell value 
 	MPI_Barrier(MPI_COMM_WORLD);
-	if(my_rank == comm_size - 2)
+	if(my_rank == decomposition_rank(decomposition_dimensions[0] - 2, decomposition_dimensions[1] - 1))
 	{
-		printf("Value of halo swap verification cell [%d][%d] is %.18f\n", ROWS_GLOBAL - ROWS - 1, COLUMNS - 1, temperature[ROWS][COLUMNS]);
+		printf("Value of halo swap verification cell [%d][%d] is %.18f\n", decomposition_offsets[0] + ROWS - 1, decomposition_offsets[1] + COLUMNS - 1, grids[last][ROWS][COLUMNS]);
 	}
 
+    convergence_finalise();
+    checkpoint_finalise();
+    // Frees the grids too
+    halo_finalise();
+
     MPI_Finalize();
 }
@@ -12,6 +12,8 @@
 #include <mpi.h> // MPI_*
 #include <string.h> // strcmp
 #include "util.h"  
+#include "decomposition.h"
+#include "progress.h"
 
 /**
  * @brief Runs the experiment.
@@ -63,9 +65,15 @@ int main(int argc, char *argv[])
         printf("Running on %d MPI processes\n\n", comm_size);
     }
 
+    // Split the grid in tiles, one per MPI process
+    decomposition_initialise();
+
     // Initialise temperatures and temperature_last including boundary conditions
     initialise_temperatures(temperature, temperature_last);
 
+    // Buffer the progress, printed once the timer is stopped
+    progress_initialise();
+
     ///////////////////////////////////
     // -- Code from here is timed -- //
     ///////////////////////////////////
@@ -146,12 +154,12 @@ int main(int argc, char *argv[])
 		MPI_Reduce(&dt, &dt_global, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
 		MPI_Bcast(&dt_global, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
-		// Periodically print test values
+		// Periodically record test values
 		if((iteration % PRINT_FREQUENCY) == 0)
 		{
 			if(my_rank == comm_size - 1)
 			{
-				track_progress(iteration, temperature);
+				progress_record(iteration, temperature);
 			}
 		}
 	}
@@ -165,6 +173,12 @@ int main(int argc, char *argv[])
     if(my_rank == 0)
     {
         stop_timer(&timer_simulation);
+    }
+
+    // Print the progress recorded, on the MPI process of rank 0 so that it comes out before the summary
+    progress_finalise(iteration);
+    if(my_rank == 0)
+    {
         print_summary(iteration, dt_global, timer_simulation);
     }
 
@@ -0,0 +1,457 @@
+/**
+ * @file kernel.c
+ **/
+
+#include "kernel.h"
+#include "front.h"
+#include <math.h> // fabs, fabsf, fmax
+#include <stdio.h> // printf
+#include <stdlib.h> // getenv, exit, EXIT_FAILURE
+#include <string.h> // strcmp
+
+// The vectorised kernels are compiled for their own instruction set whatever the compilation flags, the processor
+// being checked at runtime. Compilers without target attributes only get the ones enabled by their flags.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__PGI)
+	#include <immintrin.h>
+	// The AVX-512 target brings fused multiply-adds along, which would round some cells differently; other compilers are
+	// told not to contract by their flags, see kernel.h
+	#pragma GCC optimize("fp-contract=off")
+	#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+	#define KERNEL_AVX2
+	#define KERNEL_AVX512
+	#define KERNEL_SUPPORTS(isa) __builtin_cpu_supports(isa)
+#elif defined(__x86_64__)
+	#include <immintrin.h>
+	#define KERNEL_TARGET(isa)
+	#ifdef __AVX2__
+		#define KERNEL_AVX2
+	#endif
+	#ifdef __AVX512F__
+		#define KERNEL_AVX512
+	#endif
+	#define KERNEL_SUPPORTS(isa) 1
+#endif
+
+/**
+ * @brief Names an operation of an instruction set on a floating-point type.
+ * @details The kernels are written once, with the operations below, and instantiated for every instruction set. Each
+ * instruction set provides, for doubles and for floats:
+ * - VECTOR: the type holding LANES consecutive cells;
+ * - LOAD, STORE: the unaligned load and store of LANES cells;
+ * - SET: a vector whose lanes are all equal to a value;
+ * - ADD, SUB, MUL, ABS, MAX: the arithmetic, lane by lane;
+ * - REDUCE: the maximum across the lanes of a vector.
+ * Doubles also provide STORE_float and STORE_double, which store them converted to that type, and ALTERNATE, a vector
+ * holding a value on one lane out of two, starting with the first, and 0 on the others, which the relaxation kernels
+ * step STEP cells at a time with. The scalar instruction set has a single lane, and finishes the cells of the others
+ * after their last full vector.
+ * @param isa The instruction set: SCALAR, AVX2 or AVX512.
+ * @param real The floating-point type: float or double.
+ * @param operation The operation.
+ **/
+#define KERNEL_OP(isa, real, operation) KERNEL_##isa##_##real##_##operation
+
+#define KERNEL_SCALAR_TARGET
+#define KERNEL_SCALAR_double_VECTOR double
+#define KERNEL_SCALAR_double_LANES 1
+#define KERNEL_SCALAR_double_LOAD(cells) (*(cells))
+#define KERNEL_SCALAR_double_STORE(cells, value) (*(cells) = (value))
+#define KERNEL_SCALAR_double_SET(value) ((double)(value))
+#define KERNEL_SCALAR_double_ADD(a, b) ((a) + (b))
+#define KERNEL_SCALAR_double_SUB(a, b) ((a) - (b))
+#define KERNEL_SCALAR_double_MUL(a, b) ((a) * (b))
+#define KERNEL_SCALAR_double_ABS(a) fabs(a)
+#define KERNEL_SCALAR_double_MAX(a, b) fmax(a, b)
+#define KERNEL_SCALAR_double_REDUCE(a) (a)
+#define KERNEL_SCALAR_double_STORE_float(cells, value) (*(cells) = (float)(value))
+#define KERNEL_SCALAR_double_STORE_double(cells, value) (*(cells) = (value))
+#define KERNEL_SCALAR_double_ALTERNATE(value) (value)
+#define KERNEL_SCALAR_double_STEP 2
+#define KERNEL_SCALAR_float_VECTOR float
+#define KERNEL_SCALAR_float_LANES 1
+#define KERNEL_SCALAR_float_LOAD(cells) (*(cells))
+#define KERNEL_SCALAR_float_STORE(cells, value) (*(cells) = (value))
+#define KERNEL_SCALAR_float_SET(value) ((float)(value))
+#define KERNEL_SCALAR_float_ADD(a, b) ((a) + (b))
+#define KERNEL_SCALAR_float_SUB(a, b) ((a) - (b))
+#define KERNEL_SCALAR_float_MUL(a, b) ((a) * (b))
+#define KERNEL_SCALAR_float_ABS(a) fabsf(a)
+#define KERNEL_SCALAR_float_MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define KERNEL_SCALAR_float_REDUCE(a) (a)
+
+#ifdef KERNEL_AVX2
+/**
+ * @brief Gives the largest lane of an AVX2 vector of doubles.
+ * @param[in] vector The vector.
+ * @return The largest lane.
+ **/
+KERNEL_TARGET("avx2")
+static inline double kernel_reduce_avx2_double(__m256d vector)
+{
+	double lanes[4];
+	_mm256_storeu_pd(lanes, vector);
+	return fmax(fmax(lanes[0], lanes[1]), fmax(lanes[2], lanes[3]));
+}
+
+/**
+ * @brief Gives the largest lane of an AVX2 vector of floats.
+ * @param[in] vector The vector.
+ * @return The largest lane.
+ **/
+KERNEL_TARGET("avx2")
+static inline float kernel_reduce_avx2_float(__m256 vector)
+{
+	float lanes[8];
+	_mm256_storeu_ps(lanes, vector);
+	float largest = lanes[0];
+	for(int l = 1; l < 8; l++)
+	{
+		largest = (lanes[l] > largest) ? lanes[l] : largest;
+	}
+	return largest;
+}
+
+#define KERNEL_AVX2_TARGET KERNEL_TARGET("avx2")
+#define KERNEL_AVX2_double_VECTOR __m256d
+#define KERNEL_AVX2_double_LANES 4
+#define KERNEL_AVX2_double_LOAD(cells) _mm256_loadu_pd(cells)
+#define KERNEL_AVX2_double_STORE(cells, value) _mm256_storeu_pd(cells, value)
+#define KERNEL_AVX2_double_SET(value) _mm256_set1_pd(value)
+#define KERNEL_AVX2_double_ADD(a, b) _mm256_add_pd(a, b)
+#define KERNEL_AVX2_double_SUB(a, b) _mm256_sub_pd(a, b)
+#define KERNEL_AVX2_double_MUL(a, b) _mm256_mul_pd(a, b)
+// The absolute value clears the sign bit
+#define KERNEL_AVX2_double_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define KERNEL_AVX2_double_MAX(a, b) _mm256_max_pd(a, b)
+#define KERNEL_AVX2_double_REDUCE(a) kernel_reduce_avx2_double(a)
+#define KERNEL_AVX2_double_STORE_float(cells, value) _mm_storeu_ps(cells, _mm256_cvtpd_ps(value))
+#define KERNEL_AVX2_double_STORE_double(cells, value) _mm256_storeu_pd(cells, value)
+#define KERNEL_AVX2_double_ALTERNATE(value) _mm256_setr_pd(value, 0.0, value, 0.0)
+#define KERNEL_AVX2_double_STEP 4
+#define KERNEL_AVX2_float_VECTOR __m256
+#define KERNEL_AVX2_float_LANES 8
+#define KERNEL_AVX2_float_LOAD(cells) _mm256_loadu_ps(cells)
+#define KERNEL_AVX2_float_STORE(cells, value) _mm256_storeu_ps(cells, value)
+#define KERNEL_AVX2_float_SET(value) _mm256_set1_ps(value)
+#define KERNEL_AVX2_float_ADD(a, b) _mm256_add_ps(a, b)
+#define KERNEL_AVX2_float_SUB(a, b) _mm256_sub_ps(a, b)
+#define KERNEL_AVX2_float_MUL(a, b) _mm256_mul_ps(a, b)
+#define KERNEL_AVX2_float_ABS(a) _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a)
+#define KERNEL_AVX2_float_MAX(a, b) _mm256_max_ps(a, b)
+#define KERNEL_AVX2_float_REDUCE(a) kernel_reduce_avx2_float(a)
+#endif
+
+#ifdef KERNEL_AVX512
+#define KERNEL_AVX512_TARGET KERNEL_TARGET("avx512f")
+#define KERNEL_AVX512_double_VECTOR __m512d
+#define KERNEL_AVX512_double_LANES 8
+#define KERNEL_AVX512_double_LOAD(cells) _mm512_loadu_pd(cells)
+#define KERNEL_AVX512_double_STORE(cells, value) _mm512_storeu_pd(cells, value)
+#define KERNEL_AVX512_double_SET(value) _mm512_set1_pd(value)
+#define KERNEL_AVX512_double_ADD(a, b) _mm512_add_pd(a, b)
+#define KERNEL_AVX512_double_SUB(a, b) _mm512_sub_pd(a, b)
+#define KERNEL_AVX512_double_MUL(a, b) _mm512_mul_pd(a, b)
+#define KERNEL_AVX512_double_ABS(a) _mm512_abs_pd(a)
+#define KERNEL_AVX512_double_MAX(a, b) _mm512_max_pd(a, b)
+#define KERNEL_AVX512_double_REDUCE(a) _mm512_reduce_max_pd(a)
+#define KERNEL_AVX512_double_STORE_float(cells, value) _mm256_storeu_ps(cells, _mm512_cvtpd_ps(value))
+#define KERNEL_AVX512_double_STORE_double(cells, value) _mm512_storeu_pd(cells, value)
+#define KERNEL_AVX512_double_ALTERNATE(value) _mm512_setr_pd(value, 0.0, value, 0.0, value, 0.0, value, 0.0)
+#define KERNEL_AVX512_double_STEP 8
+#define KERNEL_AVX512_float_VECTOR __m512
+#define KERNEL_AVX512_float_LANES 16
+#define KERNEL_AVX512_float_LOAD(cells) _mm512_loadu_ps(cells)
+#define KERNEL_AVX512_float_STORE(cells, value) _mm512_storeu_ps(cells, value)
+#define KERNEL_AVX512_float_SET(value) _mm512_set1_ps(value)
+#define KERNEL_AVX512_float_ADD(a, b) _mm512_add_ps(a, b)
+#define KERNEL_AVX512_float_SUB(a, b) _mm512_sub_ps(a, b)
+#define KERNEL_AVX512_float_MUL(a, b) _mm512_mul_ps(a, b)
+#define KERNEL_AVX512_float_ABS(a) _mm512_abs_ps(a)
+#define KERNEL_AVX512_float_MAX(a, b) _mm512_max_ps(a, b)
+#define KERNEL_AVX512_float_REDUCE(a) _mm512_reduce_max_ps(a)
+#endif
+
+/**
+ * @brief The weighted sum of four neighbours of the cells of a vector.
+ * @details The neighbours are added in the order given, then multiplied by the weight, which every kernel keeps so that
+ * all instruction sets round alike.
+ * @param isa The instruction set.
+ * @param real The floating-point type.
+ * @param weight The weight of each neighbour.
+ * @param first, second, third, fourth The four neighbours, as vectors.
+ **/
+#define KERNEL_AVERAGE(isa, real, weight, first, second, third, fourth) \
+	KERNEL_OP(isa, real, MUL)(KERNEL_OP(isa, real, SET)(weight), KERNEL_OP(isa, real, ADD)(KERNEL_OP(isa, real, ADD)(KERNEL_OP(isa, real, ADD)(first, second), third), fourth))
+
+/**
+ * @brief A stencil: the weighted sum of four neighbours of the vector of cells starting at column j, see KERNEL_AVERAGE.
+ * @details Each neighbour is given by the row it lies in, among those a kernel takes, and its column relative to the
+ * cell.
+ * @param isa The instruction set.
+ * @param real The floating-point type.
+ * @param j The column of the first cell of the vector.
+ * @param weight The weight of each neighbour.
+ * @param row_1, column_1 The row and relative column of the first neighbour added; likewise for the next three.
+ **/
+#define KERNEL_STENCIL(isa, real, j, weight, row_1, column_1, row_2, column_2, row_3, column_3, row_4, column_4) \
+	KERNEL_AVERAGE(isa, real, weight, KERNEL_OP(isa, real, LOAD)(&row_1[(j)+(column_1)]), KERNEL_OP(isa, real, LOAD)(&row_2[(j)+(column_2)]), KERNEL_OP(isa, real, LOAD)(&row_3[(j)+(column_3)]), KERNEL_OP(isa, real, LOAD)(&row_4[(j)+(column_4)]))
+
+/// The weight of each of the four neighbours in the stencil of the Laplace equation.
+#define KERNEL_LAPLACE_WEIGHT 0.25
+
+/**
+ * @brief The stencil of the Laplace equation, see KERNEL_STENCIL: the average of the four neighbours, added from the
+ * one below to the one on the left.
+ **/
+#define KERNEL_LAPLACE(isa, real, j) \
+	KERNEL_STENCIL(isa, real, j, KERNEL_LAPLACE_WEIGHT, below, 0, above, 0, middle, 1, middle, -1)
+
+/**
+ * @brief Runs the cells of a kernel from column j, one vector at a time, as long as full vectors fit in the columns.
+ * @details The largest change of the vectors is folded into dt. Both j and dt are those of the kernel, so that a second
+ * loop on the scalar instruction set finishes the columns left.
+ * @param cells The macro computing the vector of cells starting at column j, given the two parameters below, the type
+ * stored and the stencil.
+ * @param isa The instruction set.
+ * @param real The floating-point type computed in.
+ * @param stored The floating-point type of the row written.
+ * @param stencil The stencil, such as KERNEL_LAPLACE.
+ **/
+#define KERNEL_LOOP(cells, isa, real, stored, stencil) \
+	{ \
+		KERNEL_OP(isa, real, VECTOR) dt_vector = KERNEL_OP(isa, real, SET)(0); \
+		for(; j + KERNEL_OP(isa, real, LANES) - 1 <= columns; j += KERNEL_OP(isa, real, LANES)) \
+		{ \
+			cells(isa, real, stored, stencil) \
+		} \
+		real dt_lanes = KERNEL_OP(isa, real, REDUCE)(dt_vector); \
+		dt = (dt_lanes > dt) ? dt_lanes : dt; \
+	}
+
+/// The cells of a kernel, see kernel_row_t and KERNEL_LOOP.
+#define KERNEL_ROW_CELLS(isa, real, stored, stencil) \
+	KERNEL_OP(isa, real, VECTOR) value = stencil(isa, real, j); \
+	KERNEL_OP(isa, real, STORE)(&row[j], value); \
+	dt_vector = KERNEL_OP(isa, real, MAX)(KERNEL_OP(isa, real, ABS)(KERNEL_OP(isa, real, SUB)(value, KERNEL_OP(isa, real, LOAD)(&middle[j]))), dt_vector);
+
+/// The cells of a correction kernel, see kernel_correct_float_t and KERNEL_LOOP.
+#define KERNEL_CORRECT_CELLS(isa, real, stored, stencil) \
+	KERNEL_OP(isa, real, VECTOR) value = KERNEL_OP(isa, real, ADD)(KERNEL_OP(isa, real, LOAD)(&source[j]), stencil(isa, real, j)); \
+	KERNEL_OP(isa, real, STORE)(&row[j], value); \
+	dt_vector = KERNEL_OP(isa, real, MAX)(KERNEL_OP(isa, real, ABS)(KERNEL_OP(isa, real, SUB)(value, KERNEL_OP(isa, real, LOAD)(&middle[j]))), dt_vector);
+
+/// The cells of a residual kernel, see kernel_residual_float_t and KERNEL_LOOP.
+#define KERNEL_RESIDUAL_CELLS(isa, real, stored, stencil) \
+	KERNEL_OP(isa, real, VECTOR) change = KERNEL_OP(isa, real, SUB)(stencil(isa, real, j), KERNEL_OP(isa, real, LOAD)(&middle[j])); \
+	KERNEL_OP(isa, real, STORE_##stored)(&residual[j], change); \
+	dt_vector = KERNEL_OP(isa, real, MAX)(KERNEL_OP(isa, real, ABS)(change), dt_vector);
+
+/**
+ * @brief Runs the cells of a relaxation kernel from column j, STEP cells at a time, as long as full vectors fit before
+ * the last column, see KERNEL_LOOP.
+ * @details The cells of a vector are loaded before the previous vector is stored: its last cell is the left neighbour
+ * of the first cell of this vector, and loading it from a store in flight would stall. The factor is zero on the cells
+ * not to update, which are stored back as they were.
+ * @param isa The instruction set.
+ * @param weight The weight of each of the four neighbours.
+ **/
+#define KERNEL_RELAX_LOOP(isa, weight) \
+	{ \
+		const KERNEL_OP(isa, double, VECTOR) factor = KERNEL_OP(isa, double, ALTERNATE)(omega); \
+		KERNEL_OP(isa, double, VECTOR) dt_vector = KERNEL_OP(isa, double, SET)(0); \
+		KERNEL_OP(isa, double, VECTOR) left = KERNEL_OP(isa, double, LOAD)(&row[j-1]); \
+		KERNEL_OP(isa, double, VECTOR) middle = KERNEL_OP(isa, double, LOAD)(&row[j]); \
+		KERNEL_OP(isa, double, VECTOR) right = KERNEL_OP(isa, double, LOAD)(&row[j+1]); \
+		for(; j + KERNEL_OP(isa, double, LANES) - 1 <= last; j += KERNEL_OP(isa, double, STEP)) \
+		{ \
+			KERNEL_OP(isa, double, VECTOR) change = KERNEL_OP(isa, double, MUL)(factor, KERNEL_OP(isa, double, SUB)(KERNEL_AVERAGE(isa, double, weight, KERNEL_OP(isa, double, LOAD)(&above[j]), KERNEL_OP(isa, double, LOAD)(&below[j]), left, right), middle)); \
+			KERNEL_OP(isa, double, VECTOR) value = KERNEL_OP(isa, double, ADD)(middle, change); \
+			dt_vector = KERNEL_OP(isa, double, MAX)(KERNEL_OP(isa, double, ABS)(change), dt_vector); \
+			if(j + KERNEL_OP(isa, double, STEP) + KERNEL_OP(isa, double, LANES) - 1 <= last) \
+			{ \
+				left = KERNEL_OP(isa, double, LOAD)(&row[j+KERNEL_OP(isa, double, STEP)-1]); \
+				middle = KERNEL_OP(isa, double, LOAD)(&row[j+KERNEL_OP(isa, double, STEP)]); \
+				right = KERNEL_OP(isa, double, LOAD)(&row[j+KERNEL_OP(isa, double, STEP)+1]); \
+			} \
+			KERNEL_OP(isa, double, STORE)(&row[j], value); \
+		} \
+		double dt_lanes = KERNEL_OP(isa, double, REDUCE)(dt_vector); \
+		dt = (dt_lanes > dt) ? dt_lanes : dt; \
+	}
+
+/**
+ * @brief Defines a kernel, see kernel_row_t.
+ * @param name The name of the kernel.
+ * @param isa The instruction set.
+ * @param stencil The stencil, see KERNEL_LOOP.
+ **/
+#define KERNEL_ROW(name, isa, stencil) \
+KERNEL_##isa##_TARGET \
+static double name(double* restrict row, const double* restrict above, const double* restrict middle, const double* restrict below, unsigned int columns) \
+{ \
+	double dt = 0.0; \
+	unsigned int j = 1; \
+	KERNEL_LOOP(KERNEL_ROW_CELLS, isa, double, double, stencil) \
+	/* The columns after the last full vector, if any, go through the scalar instruction set */ \
+	if(KERNEL_OP(isa, double, LANES) > 1) \
+	{ \
+		KERNEL_LOOP(KERNEL_ROW_CELLS, SCALAR, double, double, stencil) \
+	} \
+	return dt; \
+}
+
+/**
+ * @brief Defines a relaxation kernel, see kernel_relax_t.
+ * @details Red-black ordering only holds for the four nearest neighbours, so only their weight is a parameter.
+ * @param name The name of the kernel.
+ * @param isa The instruction set.
+ * @param weight The weight of each of the four neighbours.
+ **/
+#define KERNEL_RELAX(name, isa, weight) \
+KERNEL_##isa##_TARGET \
+static double name(double* restrict row, const double* restrict above, const double* restrict below, unsigned int first, unsigned int last, double omega) \
+{ \
+	double dt = 0.0; \
+	unsigned int j = first; \
+	KERNEL_RELAX_LOOP(isa, weight) \
+	/* The columns after the last full vector, if any, go through the scalar instruction set */ \
+	if(KERNEL_OP(isa, double, LANES) > 1) \
+	{ \
+		KERNEL_RELAX_LOOP(SCALAR, weight) \
+	} \
+	return dt; \
+}
+
+/**
+ * @brief Defines a correction kernel, see kernel_correct_float_t.
+ * @details The maximal change is computed in the type of the rows.
+ * @param name The name of the kernel.
+ * @param isa The instruction set.
+ * @param real The floating-point type of the rows.
+ * @param stencil The stencil, see KERNEL_LOOP.
+ **/
+#define KERNEL_CORRECT(name, isa, real, stencil) \
+KERNEL_##isa##_TARGET \
+static double name(real* restrict row, const real* restrict above, const real* restrict middle, const real* restrict below, const real* restrict source, unsigned int columns) \
+{ \
+	real dt = 0; \
+	unsigned int j = 1; \
+	KERNEL_LOOP(KERNEL_CORRECT_CELLS, isa, real, real, stencil) \
+	/* The columns after the last full vector, if any, go through the scalar instruction set */ \
+	if(KERNEL_OP(isa, real, LANES) > 1) \
+	{ \
+		KERNEL_LOOP(KERNEL_CORRECT_CELLS, SCALAR, real, real, stencil) \
+	} \
+	return dt; \
+}
+
+/**
+ * @brief Defines a residual kernel, see kernel_residual_float_t.
+ * @param name The name of the kernel.
+ * @param isa The instruction set.
+ * @param real The floating-point type of the residual.
+ * @param stencil The stencil, see KERNEL_LOOP.
+ **/
+#define KERNEL_RESIDUAL(name, isa, real, stencil) \
+KERNEL_##isa##_TARGET \
+static double name(real* restrict residual, const double* restrict above, const double* restrict middle, const double* restrict below, unsigned int columns) \
+{ \
+	double dt = 0.0; \
+	unsigned int j = 1; \
+	KERNEL_LOOP(KERNEL_RESIDUAL_CELLS, isa, double, real, stencil) \
+	/* The columns after the last full vector, if any, go through the scalar instruction set */ \
+	if(KERNEL_OP(isa, double, LANES) > 1) \
+	{ \
+		KERNEL_LOOP(KERNEL_RESIDUAL_CELLS, SCALAR, double, real, stencil) \
+	} \
+	return dt; \
+}
+
+/**
+ * @brief Defines every kernel on an instruction set.
+ * @param isa The instruction set.
+ * @param suffix The suffix of the names of the kernels, which is also the name of the instruction set in kernel_name.
+ * @param stencil The stencil of all kernels but the relaxation one, see KERNEL_STENCIL.
+ * @param weight The weight of the four neighbours in the relaxation kernel.
+ **/
+#define KERNEL_INSTANTIATE(isa, suffix, stencil, weight) \
+KERNEL_ROW(kernel_row_##suffix, isa, stencil) \
+KERNEL_RELAX(kernel_relax_##suffix, isa, weight) \
+KERNEL_CORRECT(kernel_correct_##suffix##_float, isa, float, stencil) \
+KERNEL_CORRECT(kernel_correct_##suffix##_double, isa, double, stencil) \
+KERNEL_RESIDUAL(kernel_residual_##suffix##_float, isa, float, stencil) \
+KERNEL_RESIDUAL(kernel_residual_##suffix##_double, isa, double, stencil)
+
+KERNEL_INSTANTIATE(SCALAR, scalar, KERNEL_LAPLACE, KERNEL_LAPLACE_WEIGHT)
+#ifdef KERNEL_AVX2
+KERNEL_INSTANTIATE(AVX2, avx2, KERNEL_LAPLACE, KERNEL_LAPLACE_WEIGHT)
+#endif
+#ifdef KERNEL_AVX512
+KERNEL_INSTANTIATE(AVX512, avx512, KERNEL_LAPLACE, KERNEL_LAPLACE_WEIGHT)
+#endif
+
+/**
+ * @brief Picks every kernel on an instruction set.
+ * @param suffix The suffix of the names of its kernels, see KERNEL_INSTANTIATE.
+ **/
+#define KERNEL_PICK(suffix) \
+	kernel_row = kernel_row_##suffix; \
+	kernel_relax = kernel_relax_##suffix; \
+	kernel_correct_float = kernel_correct_##suffix##_float; \
+	kernel_correct_double = kernel_correct_##suffix##_double; \
+	kernel_residual_float = kernel_residual_##suffix##_float; \
+	kernel_residual_double = kernel_residual_##suffix##_double; \
+	kernel_name = #suffix;
+
+kernel_row_t kernel_row = kernel_row_scalar;
+kernel_relax_t kernel_relax = kernel_relax_scalar;
+kernel_correct_float_t kernel_correct_float = kernel_correct_scalar_float;
+kernel_correct_double_t kernel_correct_double = kernel_correct_scalar_double;
+kernel_residual_float_t kernel_residual_float = kernel_residual_scalar_float;
+kernel_residual_double_t kernel_residual_double = kernel_residual_scalar_double;
+const char* kernel_name = "scalar";
+
+void kernel_initialise(void)
+{
+	const char* requested = getenv("LAPLACE_KERNEL");
+
+	#ifdef KERNEL_AVX512
+		if((requested == NULL || strcmp(requested, "avx512") == 0) && KERNEL_SUPPORTS("avx512f"))
+		{
+			KERNEL_PICK(avx512)
+			return;
+		}
+	#endif
+	#ifdef KERNEL_AVX2
+		if((requested == NULL || strcmp(requested, "avx2") == 0) && KERNEL_SUPPORTS("avx2"))
+		{
+			KERNEL_PICK(avx2)
+			return;
+		}
+	#endif
+
+	if(requested != NULL && strcmp(requested, "scalar") != 0)
+	{
+		printf("The kernel '%s' requested in LAPLACE_KERNEL is not available on this processor.\n", requested);
+		exit(EXIT_FAILURE);
+	}
+	KERNEL_PICK(scalar)
+}
+
+double kernel_tile(double to[ROWS+2][COLUMNS+2], double from[ROWS+2][COLUMNS+2], int i_first, int i_final, int j_first, int j_final, unsigned int front_iteration, long* cells)
+{
+	double dt = 0.0;
+
+	for(int i = i_first; i <= i_final; i++)
+	{
+		int first = front_first_column(front_iteration, i);
+		first = (first < j_first) ? j_first : first;
+		if(first <= j_final)
+		{
+			dt = fmax(KERNEL_SPAN(kernel_row, to[i], from[i-1], from[i], from[i+1], first, j_final), dt);
+			*cells += j_final - first + 1;
+		}
+	}
+
+	return dt;
+}
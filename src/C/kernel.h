@@ -0,0 +1,142 @@
+/**
+ * @file kernel.h
+ * @brief This file contains the stencil kernels shared by the CPU versions.
+ * @details A kernel computes one row of an iteration, averaging the four neighbours of each cell, and returns the maximal temperature change across that row in the same pass. Besides the scalar kernel, vectorised AVX2 and AVX-512 kernels are provided on x86-64. The most advanced one supported by the processor is picked at startup by kernel_initialise(), unless the environment variable 'LAPLACE_KERNEL' names another one ('scalar', 'avx2' or 'avx512'). All kernels add the four neighbours in the same order as the scalar one and do not contract operations, so their results are bit-identical. Contractions into fused multiply-adds are turned off by kernel.c itself with GCC only; pgcc relies on the '-Mnofma' flag the makefile passes, and other compilers, Clang included, need their own equivalent, such as '-ffp-contract=off'.
+ *
+ * Relaxation kernels, used by the red-black solver, see relaxation.h, update every other cell of a row in place instead. Correction kernels, used by the mixed-precision Jacobi solver, see mixed.h, add a source row to the average of the four neighbours. Residual kernels write the change a Jacobi iteration would make to each cell rather than the new temperature; the mixed-precision solver starts every period with them, and the multigrid solver, see multigrid.h, computes the residual of its finest grid with them.
+ *
+ * Every kind of kernel is written once in kernel.c, as a macro over a table of vector operations that each instruction set provides, the scalar one included, and the stencil itself, the weighted sum of four neighbours, once for all kinds. Its weight and the rows and columns of its neighbours are parameters of the instantiation, see KERNEL_STENCIL and KERNEL_INSTANTIATE in kernel.c; all kernels are instantiated with the stencil of the Laplace equation, the average of the four nearest neighbours, the relaxation ones taking only its weight since red-black ordering needs that shape. The correction and residual kernels are instantiated in single and double precision too. The vector kernels finish the cells after their last full vector with the scalar operations. All are picked along with the others.
+ *
+ * The Jacobi sweeps of all CPU versions go through kernel_tile(), which computes a rectangle of a grid and leaves out the cells the heat cannot have reached, or, when the rows are not those of a grid, through KERNEL_SPAN() and front_first_column(); the deep halo sweeps, see deep.h, through KERNEL_SPAN() alone. The mixed-precision sweeps, see mixed.h, go through KERNEL_SPAN() and KERNEL_CORRECT_SPAN(). How the tiles are scheduled, across OpenMP threads, tasks or wavefronts, is left to the callers.
+ **/
+
+#ifndef KERNEL_H_INCLUDED
+#define KERNEL_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/**
+ * @brief Signature of the kernels.
+ * @param[out] row The row to compute, from column 1 to \p columns.
+ * @param[in] above The row above, from the previous iteration.
+ * @param[in] middle The same row, from the previous iteration.
+ * @param[in] below The row below, from the previous iteration.
+ * @param[in] columns The number of columns, excluding boundaries.
+ * @return The maximal temperature change across the row.
+ **/
+typedef double (*kernel_row_t)(double* restrict row, const double* restrict above, const double* restrict middle, const double* restrict below, unsigned int columns);
+
+/**
+ * @brief Signature of the relaxation kernels.
+ * @details Each cell updated is moved by \p omega times the difference between the average of its four neighbours and itself. The cells in between are read, and may be written back unchanged.
+ * @param[inout] row The row to update, at every other column from \p first to \p last.
+ * @param[in] above The row above.
+ * @param[in] below The row below.
+ * @param[in] first The first column to update.
+ * @param[in] last The last column that may be updated.
+ * @param[in] omega The relaxation factor.
+ * @return The maximal temperature change across the cells updated.
+ **/
+typedef double (*kernel_relax_t)(double* restrict row, const double* restrict above, const double* restrict below, unsigned int first, unsigned int last, double omega);
+
+/**
+ * @brief Signature of the correction kernels, in single precision.
+ * @details Each cell is set to the cell of \p source plus the average of its four neighbours. The maximal change is computed from the values rounded to the type of the rows, and returned in double precision.
+ * @param[out] row The row to compute, from column 1 to \p columns.
+ * @param[in] above The row above, from the previous iteration.
+ * @param[in] middle The same row, from the previous iteration.
+ * @param[in] below The row below, from the previous iteration.
+ * @param[in] source The row added to the average.
+ * @param[in] columns The number of columns, excluding boundaries.
+ * @return The maximal change across the row.
+ **/
+typedef double (*kernel_correct_float_t)(float* restrict row, const float* restrict above, const float* restrict middle, const float* restrict below, const float* restrict source, unsigned int columns);
+/**
+ * @brief Signature of the correction kernels, in double precision, see kernel_correct_float_t.
+ **/
+typedef double (*kernel_correct_double_t)(double* restrict row, const double* restrict above, const double* restrict middle, const double* restrict below, const double* restrict source, unsigned int columns);
+
+/**
+ * @brief Signature of the residual kernels, in single precision.
+ * @details Each cell is set to the average of the four neighbours of the cell of \p middle minus that cell, computed in double precision like the kernels do, then rounded to the type of \p residual.
+ * @param[out] residual The row to compute, from column 1 to \p columns.
+ * @param[in] above The row above.
+ * @param[in] middle The same row.
+ * @param[in] below The row below.
+ * @param[in] columns The number of columns, excluding boundaries.
+ * @return The maximal absolute value across the row, before rounding.
+ **/
+typedef double (*kernel_residual_float_t)(float* restrict residual, const double* restrict above, const double* restrict middle, const double* restrict below, unsigned int columns);
+/**
+ * @brief Signature of the residual kernels, in double precision, see kernel_residual_float_t.
+ **/
+typedef double (*kernel_residual_double_t)(double* restrict residual, const double* restrict above, const double* restrict middle, const double* restrict below, unsigned int columns);
+
+/// The kernel picked by kernel_initialise().
+extern kernel_row_t kernel_row;
+/// The relaxation kernel picked by kernel_initialise().
+extern kernel_relax_t kernel_relax;
+/// The single-precision correction kernel picked by kernel_initialise().
+extern kernel_correct_float_t kernel_correct_float;
+/// The double-precision correction kernel picked by kernel_initialise().
+extern kernel_correct_double_t kernel_correct_double;
+/// The single-precision residual kernel picked by kernel_initialise().
+extern kernel_residual_float_t kernel_residual_float;
+/// The double-precision residual kernel picked by kernel_initialise().
+extern kernel_residual_double_t kernel_residual_double;
+/// The name of the kernel picked by kernel_initialise().
+extern const char* kernel_name;
+
+/**
+ * @brief Picks the kernel to use.
+ * @details The kernel picked is the one named in the environment variable 'LAPLACE_KERNEL' if set and supported, the most advanced one supported by the processor otherwise.
+ * @post kernel_row, kernel_relax, kernel_correct_float, kernel_correct_double, kernel_residual_float, kernel_residual_double and kernel_name are set.
+ **/
+void kernel_initialise(void);
+
+/**
+ * @brief Applies a kernel to columns \p first to \p final of a row.
+ * @details Kernels compute cells 1 to n of the rows given, so the rows are offset to start at column \p first. Any kernel taking the row to write, then the rows above, at and below it, then the number of columns, fits.
+ * @param kernel The kernel, such as kernel_row or kernel_residual_double.
+ * @param row The row to write.
+ * @param above The row above.
+ * @param middle The same row, read.
+ * @param below The row below.
+ * @param first The first column to compute.
+ * @param final The last column to compute.
+ * @return What the kernel returns.
+ **/
+#define KERNEL_SPAN(kernel, row, above, middle, below, first, final) \
+	kernel((row) + (first) - 1, (above) + (first) - 1, (middle) + (first) - 1, (below) + (first) - 1, (final) - (first) + 1)
+
+/**
+ * @brief Applies a correction kernel to columns \p first to \p final of a row, see KERNEL_SPAN().
+ * @param kernel The kernel, such as kernel_correct_float.
+ * @param row The row to write.
+ * @param above The row above.
+ * @param middle The same row, read.
+ * @param below The row below.
+ * @param source The row added to the average.
+ * @param first The first column to compute.
+ * @param final The last column to compute.
+ * @return What the kernel returns.
+ **/
+#define KERNEL_CORRECT_SPAN(kernel, row, above, middle, below, source, first, final) \
+	kernel((row) + (first) - 1, (above) + (first) - 1, (middle) + (first) - 1, (below) + (first) - 1, (source) + (first) - 1, (final) - (first) + 1)
+
+/**
+ * @brief Computes a tile of an iteration with kernel_row, leaving out the cells the heat cannot have reached, see front.h.
+ * @details An empty tile, or one the heat has not reached yet, computes nothing.
+ * @param[out] to The grid in which to compute the iteration.
+ * @param[in] from The grid containing the temperatures of the iteration before.
+ * @param[in] i_first The first row of the tile.
+ * @param[in] i_final The last row of the tile.
+ * @param[in] j_first The first column of the tile.
+ * @param[in] j_final The last column of the tile.
+ * @param[in] front_iteration The furthest iteration any grid holds, at least the one computed, which tells the cells left out.
+ * @param[inout] cells Increased by the number of cells computed.
+ * @return The maximal temperature change across the cells computed.
+ **/
+double kernel_tile(double to[ROWS+2][COLUMNS+2], double from[ROWS+2][COLUMNS+2], int i_first, int i_final, int j_first, int j_final, unsigned int front_iteration, long* cells);
+
+#endif
@@ -0,0 +1,290 @@
+/**
+ * @file mixed.c
+ **/
+
+#include "mixed.h"
+#include "util.h"
+#include "kernel.h"
+#include "profile.h"
+#include <math.h> // fabs, fmax
+#include <stdio.h> // printf, fprintf
+#include <stdlib.h> // malloc, free, exit, EXIT_FAILURE
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+	#include "decomposition.h"
+#endif
+
+/// Distance between the temperature change slots of two OpenMP threads, in doubles, so that each fills its own cache line.
+#define MIXED_SLOT_STRIDE 8
+/// Number of correction buffers: the change of the first iteration of a period, and two for the other iterations by turns.
+#define MIXED_BUFFERS 3
+/// Number of requests per buffer: one send and one receive per neighbour.
+#define MIXED_REQUESTS_PER_BUFFER 8
+/// Tag of the messages sent to the bottom neighbour, distinct from those of halo.c.
+#define MIXED_TAG_DOWNWARDS 4
+/// Tag of the messages sent to the top neighbour.
+#define MIXED_TAG_UPWARDS 5
+/// Tag of the messages sent to the right neighbour.
+#define MIXED_TAG_RIGHTWARDS 6
+/// Tag of the messages sent to the left neighbour.
+#define MIXED_TAG_LEFTWARDS 7
+
+/// Pastes the name of a floating-point type after a prefix, once the type is expanded.
+#define MIXED_PASTE(prefix, real) prefix##real
+/// The correction kernel of a floating-point type, see kernel.h.
+#define MIXED_KERNEL(real) MIXED_PASTE(kernel_correct_, real)
+/// The residual kernel of a floating-point type, see kernel.h.
+#define MIXED_RESIDUAL(real) MIXED_PASTE(kernel_residual_, real)
+
+/// The correction buffers, halos included. The first holds the change of the first iteration of a period, which is also added to every correction of the period.
+static MIXED_REAL* mixed_buffers[MIXED_BUFFERS] = {NULL, NULL, NULL};
+/// The maximal temperature change found by each OpenMP thread, in two sets used by turns.
+static double* mixed_slots = NULL;
+#ifdef VERSION_RUN_IS_MPI
+	/// The temperature change across all MPI processes found by the master thread, in two sets used by turns.
+	static double mixed_dt_global[2];
+	/// The persistent requests of the halo swap of each buffer.
+	static MPI_Request mixed_requests[MIXED_BUFFERS][MIXED_REQUESTS_PER_BUFFER];
+	/// A column of a buffer, halos excluded.
+	static MPI_Datatype mixed_column = MPI_DATATYPE_NULL;
+#endif
+/// The number of iterations of the current period run by my OpenMP thread, 0 at the start of a period.
+static int mixed_sweeps = 0;
+/// The number of iterations run so far by my OpenMP thread, which tells the set of slots to use.
+static unsigned int mixed_round = 0;
+#pragma omp threadprivate(mixed_sweeps, mixed_round)
+
+/**
+ * @brief Gives the buffer holding the correction of an iteration of the period.
+ * @param[in] sweep The iteration, counted from 0 at the start of the period.
+ * @return The index of the buffer.
+ **/
+static inline int mixed_buffer(int sweep)
+{
+	return (sweep == 0) ? 0 : 1 + sweep % 2;
+}
+
+/**
+ * @brief Computes the correction of an iteration on part of a row.
+ * @details At the start of a period, it is the change a Jacobi iteration makes to the temperatures, computed in double precision by the residual kernel like that solver does. Afterwards, it is that change plus the average of the neighbours in the correction of the iteration before, computed in MIXED_REAL by the correction kernel.
+ * @param[in] grid The temperatures at the start of the period.
+ * @param[in] sweep The iteration, counted from 0 at the start of the period.
+ * @param[in] i The row.
+ * @param[in] first The first column.
+ * @param[in] final The last column.
+ * @return The maximal change of the correction across the cells computed, which is the temperature change of the iteration.
+ **/
+static double mixed_row(double grid[ROWS+2][COLUMNS+2], int sweep, int i, int first, int final)
+{
+	MIXED_REAL (*target)[COLUMNS+2] = (MIXED_REAL (*)[COLUMNS+2])mixed_buffers[mixed_buffer(sweep)];
+	if(sweep == 0)
+	{
+		return KERNEL_SPAN(MIXED_RESIDUAL(MIXED_REAL), target[i], grid[i-1], grid[i], grid[i+1], first, final);
+	}
+
+	MIXED_REAL (*last)[COLUMNS+2] = (MIXED_REAL (*)[COLUMNS+2])mixed_buffers[mixed_buffer(sweep - 1)];
+	MIXED_REAL (*change)[COLUMNS+2] = (MIXED_REAL (*)[COLUMNS+2])mixed_buffers[0];
+	return KERNEL_CORRECT_SPAN(MIXED_KERNEL(MIXED_REAL), target[i], last[i-1], last[i], last[i+1], change[i], first, final);
+}
+
+void mixed_initialise(void)
+{
+	int my_rank = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	#endif
+	if(my_rank == 0)
+	{
+		fprintf(stderr, "Mixed-precision Jacobi iterations, with corrections in %s precision and temperatures refreshed in double precision every %d iterations at most.\n", (sizeof(MIXED_REAL) == sizeof(float)) ? "single" : "double", MIXED_PERIOD);
+	}
+
+	int thread_count = 1;
+	#ifdef _OPENMP
+		thread_count = omp_get_max_threads();
+	#endif
+	size_t row_length = (size_t)COLUMNS + 2;
+	size_t buffer_size = ((size_t)ROWS + 2) * row_length;
+	mixed_buffers[0] = malloc(sizeof(MIXED_REAL) * MIXED_BUFFERS * buffer_size);
+	mixed_slots = malloc(sizeof(double) * 2 * thread_count * MIXED_SLOT_STRIDE);
+	if(mixed_buffers[0] == NULL || mixed_slots == NULL)
+	{
+		printf("Failed to allocate the mixed-precision buffers.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	// Corrections are zero on the boundaries. First touch: each row is zeroed by the thread that computes it later.
+	for(int b = 0; b < MIXED_BUFFERS; b++)
+	{
+		MIXED_REAL* buffer = mixed_buffers[0] + b * buffer_size;
+		mixed_buffers[b] = buffer;
+		#pragma omp parallel for schedule(static)
+		for(int i = 1; i <= ROWS; i++)
+		{
+			for(size_t j = 0; j < row_length; j++)
+			{
+				buffer[i * row_length + j] = 0;
+			}
+		}
+		for(size_t j = 0; j < row_length; j++)
+		{
+			buffer[j] = 0;
+			buffer[(ROWS + 1) * row_length + j] = 0;
+		}
+	}
+
+	#ifdef VERSION_RUN_IS_MPI
+		// The halos hold corrections, sent in MIXED_REAL as well
+		MPI_Datatype real = (sizeof(MIXED_REAL) == sizeof(float)) ? MPI_FLOAT : MPI_DOUBLE;
+		MPI_Type_vector(ROWS, 1, COLUMNS + 2, real, &mixed_column);
+		MPI_Type_commit(&mixed_column);
+
+		const int* neighbours = decomposition_neighbours;
+		MPI_Comm communicator = decomposition_communicator;
+		for(int b = 0; b < MIXED_BUFFERS; b++)
+		{
+			MIXED_REAL (*buffer)[COLUMNS+2] = (MIXED_REAL (*)[COLUMNS+2])mixed_buffers[b];
+			MPI_Request* requests = mixed_requests[b];
+			MPI_Recv_init(&buffer[0][1], COLUMNS, real, neighbours[DECOMPOSITION_TOP], MIXED_TAG_DOWNWARDS, communicator, &requests[0]);
+			MPI_Recv_init(&buffer[ROWS+1][1], COLUMNS, real, neighbours[DECOMPOSITION_BOTTOM], MIXED_TAG_UPWARDS, communicator, &requests[1]);
+			MPI_Recv_init(&buffer[1][0], 1, mixed_column, neighbours[DECOMPOSITION_LEFT], MIXED_TAG_RIGHTWARDS, communicator, &requests[2]);
+			MPI_Recv_init(&buffer[1][COLUMNS+1], 1, mixed_column, neighbours[DECOMPOSITION_RIGHT], MIXED_TAG_LEFTWARDS, communicator, &requests[3]);
+			MPI_Send_init(&buffer[ROWS][1], COLUMNS, real, neighbours[DECOMPOSITION_BOTTOM], MIXED_TAG_DOWNWARDS, communicator, &requests[4]);
+			MPI_Send_init(&buffer[1][1], COLUMNS, real, neighbours[DECOMPOSITION_TOP], MIXED_TAG_UPWARDS, communicator, &requests[5]);
+			MPI_Send_init(&buffer[1][COLUMNS], 1, mixed_column, neighbours[DECOMPOSITION_RIGHT], MIXED_TAG_RIGHTWARDS, communicator, &requests[6]);
+			MPI_Send_init(&buffer[1][1], 1, mixed_column, neighbours[DECOMPOSITION_LEFT], MIXED_TAG_LEFTWARDS, communicator, &requests[7]);
+		}
+	#endif
+}
+
+double mixed_advance(double grid[ROWS+2][COLUMNS+2], int needed)
+{
+	int thread_count = 1;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_count = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+	#endif
+	int set = mixed_round % 2;
+	double* slots = mixed_slots + set * thread_count * MIXED_SLOT_STRIDE;
+	mixed_round++;
+	int sweep = mixed_sweeps;
+
+	double dt = 0.0;
+	double profile_start;
+	#ifdef VERSION_RUN_IS_MPI
+		// The first and last rows and columns go first, so that they are sent to the neighbours while the other cells
+		// are computed by all threads
+		#pragma omp master
+		{
+			profile_start = profile_now();
+			dt = fmax(mixed_row(grid, sweep, 1, 1, COLUMNS), dt);
+			dt = fmax(mixed_row(grid, sweep, ROWS, 1, COLUMNS), dt);
+			for(int i = 2; i <= ROWS - 1; i++)
+			{
+				dt = fmax(mixed_row(grid, sweep, i, 1, 1), dt);
+				dt = fmax(mixed_row(grid, sweep, i, COLUMNS, COLUMNS), dt);
+			}
+			profile_add(PROFILE_STENCIL, profile_start, 2L * (ROWS + COLUMNS) - 4);
+
+			profile_start = profile_now();
+			MPI_Startall(MIXED_REQUESTS_PER_BUFFER, mixed_requests[mixed_buffer(sweep)]);
+			profile_add(PROFILE_HALO, profile_start, 0);
+		} // End of OpenMP master region
+
+		profile_start = profile_now();
+		long rows_computed = 0;
+		#pragma omp for schedule(static) nowait
+		for(int i = 2; i <= ROWS - 1; i++)
+		{
+			dt = fmax(mixed_row(grid, sweep, i, 2, COLUMNS - 1), dt);
+			rows_computed++;
+		}
+		profile_add(PROFILE_STENCIL, profile_start, rows_computed * (COLUMNS - 2));
+
+		#pragma omp master
+		{
+			profile_start = profile_now();
+			MPI_Waitall(MIXED_REQUESTS_PER_BUFFER, mixed_requests[mixed_buffer(sweep)], MPI_STATUSES_IGNORE);
+			profile_add(PROFILE_HALO, profile_start, 0);
+		} // End of OpenMP master region
+	#else
+		profile_start = profile_now();
+		long rows_computed = 0;
+		#pragma omp for schedule(static) nowait
+		for(int i = 1; i <= ROWS; i++)
+		{
+			dt = fmax(mixed_row(grid, sweep, i, 1, COLUMNS), dt);
+			rows_computed++;
+		}
+		profile_add(PROFILE_STENCIL, profile_start, rows_computed * COLUMNS);
+	#endif
+
+	// The next iteration needs the corrections, and halos, just computed by the other threads, and the same barrier
+	// publishes the temperature change of each thread. Slots alternate between two sets from one iteration to the
+	// next, so that a thread can fill a slot of the next iteration while the others still read those of this one.
+	slots[thread_id * MIXED_SLOT_STRIDE] = dt;
+	#pragma omp barrier
+
+	profile_start = profile_now();
+	for(int t = 0; t < thread_count; t++)
+	{
+		dt = fmax(slots[t * MIXED_SLOT_STRIDE], dt);
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+
+	#ifdef VERSION_RUN_IS_MPI
+		#pragma omp master
+		{
+			profile_start = profile_now();
+			MPI_Allreduce(&dt, &mixed_dt_global[set], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+			profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+		} // End of OpenMP master region
+		#pragma omp barrier
+		dt = mixed_dt_global[set];
+	#endif
+
+	// End the period by adding the correction to the temperatures. Halos are included: those of the correction were
+	// just swapped, so the same sums are made by the neighbours and the halos of the temperatures stay up to date.
+	mixed_sweeps++;
+	if(needed || dt <= MAX_TEMP_ERROR || mixed_sweeps == MIXED_PERIOD)
+	{
+		profile_start = profile_now();
+		MIXED_REAL (*correction)[COLUMNS+2] = (MIXED_REAL (*)[COLUMNS+2])mixed_buffers[mixed_buffer(sweep)];
+		#pragma omp for schedule(static)
+		for(int i = 0; i <= ROWS + 1; i++)
+		{
+			for(int j = 0; j <= COLUMNS + 1; j++)
+			{
+				grid[i][j] += correction[i][j];
+			}
+		}
+		profile_add(PROFILE_STENCIL, profile_start, 0);
+		mixed_sweeps = 0;
+	}
+
+	return dt;
+}
+
+void mixed_finalise(void)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		for(int b = 0; b < MIXED_BUFFERS; b++)
+		{
+			for(int r = 0; r < MIXED_REQUESTS_PER_BUFFER; r++)
+			{
+				MPI_Request_free(&mixed_requests[b][r]);
+			}
+		}
+		MPI_Type_free(&mixed_column);
+	#endif
+	free(mixed_buffers[0]);
+	free(mixed_slots);
+	for(int b = 0; b < MIXED_BUFFERS; b++)
+	{
+		mixed_buffers[b] = NULL;
+	}
+	mixed_slots = NULL;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file mixed.h
+ * @brief This file contains the mixed-precision Jacobi solver of the CPU versions.
+ * @details The Jacobi iteration is affine: from temperatures T plus a correction d, the next iteration gives T + r + A d, where r is the change a Jacobi iteration would make to T and A d averages the four neighbours of each cell of d. Temperatures are therefore kept in double precision, and refreshed only every MIXED_PERIOD iterations. At the start of a period, r is computed from them in double precision, and rounded to MIXED_REAL; it is also the correction after the first iteration. The following iterations of the period only sweep the corrections, d = r + A d, in MIXED_REAL, single precision by default, and the halos swapped in the MPI versions hold corrections too. At the end of the period, the correction is added to the temperatures in double precision, and the next period starts from them.
+ *
+ * A sweep in single precision reads the correction and the change, and writes the correction: 4-byte values instead of the 8-byte temperatures of a Jacobi sweep in double precision, and halo messages half as large. The corrections stay of the order of the temperature changes over a period, so rounding them costs little, and the refresh in double precision keeps rounding errors from piling up in the temperatures. The temperature change of each iteration is the largest change of a correction, compared with the tolerance like that of the Jacobi solver; it is exact at the first iteration of a period, and within rounding of the corrections at the others.
+ *
+ * A period also ends at any iteration whose temperatures are needed: when progress is printed, a checkpoint written or a snapshot taken, when convergence is reached and at the last iteration allowed. At the small size, the temperatures stay within 4e-8 of those of the Jacobi solver in double precision, so the tracked cells printed are the same, convergence is reached at the same iteration and the temperature change printed agrees to within 1e-8. All kernels, and all decompositions, give the same results.
+ *
+ * The precision is a compilation parameter: defining MIXED_REAL as 'double' gives the Jacobi solver back up to rounding, through the same code.
+ **/
+
+#ifndef MIXED_H_INCLUDED
+#define MIXED_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+#ifndef MIXED_REAL
+	/// The floating-point type of the corrections, 'float' or 'double'. It can be overriden at compilation.
+	#define MIXED_REAL float
+#endif
+#ifndef MIXED_PERIOD
+	/// Maximum number of iterations between two refreshes of the temperatures. It can be overriden at compilation.
+	#define MIXED_PERIOD 16
+#endif
+
+/**
+ * @brief Allocates the corrections and, in the MPI versions, prepares their halo swaps.
+ * @pre In the MPI versions, decomposition_initialise() has been called, and it is called by all MPI processes.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void mixed_initialise(void);
+/**
+ * @brief Runs one Jacobi iteration, in place.
+ * @param[inout] grid The temperatures, with their boundaries set. They hold those of the iteration run on return only if a period ended, which it does if \p needed is set or convergence is reached. In the MPI versions, their halos must be up to date at the start of a period, and are kept so.
+ * @param[in] needed Whether the temperatures of the iteration run are needed on return.
+ * @return The maximal temperature change of the iteration; in the MPI versions, across all MPI processes. All OpenMP threads get the same.
+ * @pre kernel_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, if any, with the same arguments.
+ **/
+double mixed_advance(double grid[ROWS+2][COLUMNS+2], int needed);
+/**
+ * @brief Frees the corrections and, in the MPI versions, the requests of their halo swaps.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void mixed_finalise(void);
+
+#endif
@@ -8,50 +8,194 @@
 
 #include <stdio.h> // printf
 #include <stdlib.h> // EXIT_FAILURE
-#include <math.h> // fabs
+#include <math.h> // fmax
 #include <mpi.h> // MPI_*
-#include <string.h> // strcmp
-#include "util.h"  
+#include "util.h"
+#include "kernel.h"
+#include "decomposition.h"
+#include "halo.h"
+#include "convergence.h"
+#include "checkpoint.h"
+#include "relaxation.h"
+#include "multigrid.h"
+#include "conjugate.h"
+#include "mixed.h"
+#include "deep.h"
+#include "front.h"
+#include "progress.h"
+#include "snapshot.h"
+#include "profile.h"
+
+/**
+ * @brief Runs one iteration.
+ * @details The first and last rows and columns are computed first, so that they are sent to the neighbours while the other cells are computed. The halos are received in \p current since it becomes the grid of the last iteration afterwards. Cells the heat cannot have reached are left out, see front.h.
+ * @param[out] current The grid in which to compute the iteration.
+ * @param[in] last The grid containing the temperatures of the last iteration.
+ * @param[in] front_iteration The furthest iteration any grid holds, at least the one computed, which tells the cells left out.
+ * @return The maximal temperature change of my MPI process.
+ **/
+static double advance(double current[ROWS+2][COLUMNS+2], double last[ROWS+2][COLUMNS+2], unsigned int front_iteration)
+{
+	// Average my four neighbours and find my maximal temperature change in the same pass
+	double profile_start = profile_now();
+	long cells = 0;
+	double dt = kernel_tile(current, last, 1, 1, 1, COLUMNS, front_iteration, &cells);
+	dt = fmax(kernel_tile(current, last, ROWS, ROWS, 1, COLUMNS, front_iteration, &cells), dt);
+	dt = fmax(kernel_tile(current, last, 2, ROWS - 1, 1, 1, front_iteration, &cells), dt);
+	dt = fmax(kernel_tile(current, last, 2, ROWS - 1, COLUMNS, COLUMNS, front_iteration, &cells), dt);
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+
+	int quiet[4];
+	front_quiet(front_iteration, quiet);
+	halo_start(current, quiet);
+
+	// The first and last columns are computed already
+	profile_start = profile_now();
+	cells = 0;
+	dt = fmax(kernel_tile(current, last, 2, ROWS - 1, 2, COLUMNS - 1, front_iteration, &cells), dt);
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+
+	halo_finish();
+
+	return dt;
+}
+
+/**
+ * @brief Picks the grid in which to compute the next iteration.
+ * @param[in] grid_count The number of grids.
+ * @param[in] last The index of the grid containing the temperatures of the last iteration.
+ * @param[in] kept The index of a grid that must not be overwritten, ignored if there are only two grids.
+ * @return The index of the first grid that is neither \p last nor \p kept.
+ **/
+static int spare_grid(int grid_count, int last, int kept)
+{
+	int spare = 0;
+	while(spare == last || (grid_count > 2 && spare == kept))
+	{
+		spare++;
+	}
+	return spare;
+}
+
+/**
+ * @brief Runs the simulation with a solver that updates the grid in place.
+ * @details The temperature changes are combined across all MPI processes at every iteration, by relaxation_advance() for the red-black solver, see relaxation.h, by multigrid_cycle() for the multigrid one, see multigrid.h, by conjugate_advance() for the conjugate gradient one, see conjugate.h, by mixed_advance() for the mixed-precision one, see mixed.h, or by deep_advance() for the Jacobi one with deep halos, see deep.h, which runs several iterations at once.
+ * @param[inout] grid The grid, holding the initial temperatures.
+ * @param[inout] iteration_reached The first iteration to run; the iteration at which the simulation stopped on return.
+ * @param[inout] dt_global_reached The temperature change across all MPI processes of the iteration before the first one; that when the simulation stopped on return.
+ * @param[in] tracking Whether my MPI process prints the progress.
+ * @pre relaxation_initialise(), multigrid_initialise(), conjugate_initialise(), mixed_initialise() or deep_initialise() has been called, depending on the solver.
+ **/
+static void relax(double grid[ROWS+2][COLUMNS+2], int* iteration_reached, double* dt_global_reached, int tracking)
+{
+    int iteration = *iteration_reached;
+    double dt_global = *dt_global_reached;
+
+    // Temperature change of each iteration run at once, several with deep halos
+    double dt_trip[DEEP_MAX_DEPTH];
+
+    while(dt_global > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
+    {
+        unsigned int advanced = 1;
+        if(config_solver == CONFIG_SOLVER_SOR)
+        {
+            dt_trip[0] = relaxation_advance(grid);
+        }
+        else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+        {
+            dt_trip[0] = multigrid_cycle(grid);
+        }
+        else if(config_solver == CONFIG_SOLVER_CG)
+        {
+            dt_trip[0] = conjugate_advance(grid);
+        }
+        else if(config_precision == CONFIG_PRECISION_MIXED)
+        {
+            // The temperatures are needed when progress is printed, when a checkpoint is written, when a snapshot is
+            // taken and at the last iteration allowed
+            int needed = ((iteration + 1) % PRINT_FREQUENCY) == 0 || checkpoint_due(iteration + 1) || snapshot_due(iteration + 1) || iteration + 1 > MAX_NUMBER_OF_ITERATIONS;
+            dt_trip[0] = mixed_advance(grid, needed);
+        }
+        else
+        {
+            // Deep halos stop short of the iterations whose temperatures are needed, so only the last one may be
+            unsigned int depth = deep_depth(iteration);
+            int needed = ((iteration + depth) % PRINT_FREQUENCY) == 0 || checkpoint_due(iteration + depth) || snapshot_due(iteration + depth) || iteration + depth > MAX_NUMBER_OF_ITERATIONS;
+            advanced = deep_advance(grid, depth, needed, dt_trip);
+        }
+        for(unsigned int k = 0; k < advanced; k++)
+        {
+            progress_log(dt_trip[k]);
+        }
+        dt_global = dt_trip[advanced - 1];
+        iteration += advanced;
+
+        // Periodically record test values
+        if((iteration % PRINT_FREQUENCY) == 0 && tracking)
+        {
+            checkpoint_track_progress(iteration, grid);
+        }
+
+        // Periodically save the temperatures
+        if(dt_global > MAX_TEMP_ERROR && checkpoint_due(iteration))
+        {
+            checkpoint_write(iteration, grid, dt_global);
+        }
+
+        // Periodically save a snapshot of the temperatures, unless the last one, saved once the timer is stopped
+        if(dt_global > MAX_TEMP_ERROR && snapshot_due(iteration))
+        {
+            snapshot_write(iteration, grid, dt_global);
+        }
+    }
+
+    *iteration_reached = iteration;
+    *dt_global_reached = dt_global;
+}
 
 /**
  * @brief Runs the experiment.
- * @pre The macro 'ROWS' contains the number of rows (excluding boundaries) per MPI process. It is a define passed as a compilation flag, see makefile.
- * @pre The macro 'COLUMNS' contains the number of columns (excluding boundaries). It is a define passed as a compilation flag, see makefile.
+ * @details The grid size and the other settings of the run are read from the command line or the environment, see config.h.
  **/
 int main(int argc, char *argv[])
 {
-	// Temperature grid.
-	double temperature[ROWS+2][COLUMNS+2];
-	// Temperature grid from last iteration
-	double temperature_last[ROWS+2][COLUMNS+2]; 
 	// Current iteration
     int iteration = 0;
     // Temperature change for our MPI process
-    double dt;
+    double dt = 0.0;
     // Temperature change across all MPI processes
     double dt_global = 100;
     // The number of MPI processes in total
     int comm_size;
     // The rank of my MPI process
     int my_rank;
-    // Status returned by MPI calls
-    MPI_Status status;
 
     // The usual MPI startup routines
     MPI_Init(&argc, &argv);
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
 
-    if(strcmp(VERSION_RUN, "mpi_small") == 0 && comm_size != 4)
-    {
-        printf("The small version is meant to be run with 4 MPI processes, not %d.\n", comm_size);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
-    else if(strcmp(VERSION_RUN, "mpi_big") == 0 && comm_size != 112)
-    {
-        printf("The big version is meant to be run with 112 MPI processes, not %d.\n", comm_size);
-        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
-    }
+    // Read the grid size and the other settings of the run
+    config_initialise(argc, argv);
+
+    // Split the grid in tiles, one per MPI process
+    decomposition_initialise();
+
+    // The grids. A third one is needed when convergence is checked every few iterations, so that a window that
+    // converged before its end can be replayed from the grid it started from, and a single one by the red-black,
+    // multigrid, conjugate gradient, mixed-precision and deep halo solvers which update it in place, the latter through
+    // grids of its own.
+    // They are allocated along with their halo swaps, in memory shared with the MPI processes of my node, followed by
+    // the vectors whose halos the conjugate gradient solver swaps.
+    double (*grids[HALO_MAX_GRIDS])[COLUMNS+2] = {NULL, NULL, NULL};
+    int grid_count = CONFIG_IN_PLACE ? 1 : (config_convergence_window > 1) ? 3 : 2;
+    int vector_count = (config_solver == CONFIG_SOLVER_CG) ? CONJUGATE_HALO_VECTORS : 0;
+    halo_initialise(grid_count + vector_count, (double**)grids);
+
+    // Temperature grid.
+    double (*temperature)[COLUMNS+2] = grids[0];
+    // Temperature grid from last iteration
+    double (*temperature_last)[COLUMNS+2] = (grid_count > 1) ? grids[1] : grids[0];
 
     if(my_rank == 0)
     {
@@ -61,6 +205,56 @@ int main(int argc, char *argv[])
     // Initialise temperatures and temperature_last including boundary conditions
     initialise_temperatures(temperature, temperature_last);
 
+    // Pick the stencil kernel best suited to this processor
+    kernel_initialise();
+
+    // Only the boundaries of the third grid matter, so it is initialised on its own
+    if(grid_count == 3)
+    {
+        initialise_temperatures(grids[2], grids[2]);
+    }
+
+    // Index of the grid holding the temperatures of the last iteration
+    int last = (grid_count > 1) ? 1 : 0;
+
+    // Buffer the progress, printed once the timer is stopped, including that of the checkpoint resumed from
+    progress_initialise();
+
+    // Prepare the snapshots of the temperatures, if asked for
+    snapshot_initialise();
+
+    // Resume from a checkpoint if asked to, swapping the halos of the temperatures read
+    checkpoint_initialise();
+    if(config_restart_file != NULL)
+    {
+        iteration = checkpoint_read(grids[last], &dt_global);
+        halo_start(grids[last], NULL);
+        halo_finish();
+    }
+
+    // The Jacobi solver skips the cells the heat has not reached yet
+    if(!CONFIG_IN_PLACE)
+    {
+        front_initialise(grids[last], iteration);
+    }
+
+    // Keep the temperature changes of the iterations whose convergence is checked together
+    convergence_initialise();
+
+    // Iteration the convergence check window in progress started from, its last iteration and the grid it started from
+    unsigned int window_first = iteration;
+    unsigned int window_last = convergence_window_end(window_first);
+    int window_first_grid = last;
+    // Same for the window whose convergence check is in progress, plus the grid of its last iteration
+    int checking = 0;
+    unsigned int checked_first = 0;
+    unsigned int checked_last = 0;
+    int checked_first_grid = 0;
+    int checked_last_grid = 0;
+
+    // Time the phases of the hot loop from here on
+    profile_initialise();
+
     ///////////////////////////////////
     // -- Code from here is timed -- //
     ///////////////////////////////////
@@ -69,83 +263,119 @@ int main(int argc, char *argv[])
         start_timer(&timer_simulation);
     }
 
-    while(dt_global > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
+    // The red-black, multigrid, conjugate gradient, mixed-precision and deep halo solvers run their own loop, the Jacobi
+    // one runs until it breaks off
+    if(config_solver == CONFIG_SOLVER_SOR)
     {
-        iteration++;
-
-        // Main calculation: average my four neighbours
-        for(unsigned int i = 1; i <= ROWS; i++)
-        {
-            for(unsigned int j = 1; j <= COLUMNS; j++)
-            {
-                temperature[i][j] = 0.25 * (temperature_last[i+1][j  ] +
-                                            temperature_last[i-1][j  ] +
-                                            temperature_last[i  ][j+1] +
-                                            temperature_last[i  ][j-1]);
-            }
-        }
-
-        //////////////////////
-        // HALO SWAP PHASE //
-        ////////////////////
+        relaxation_initialise();
+        relax(grids[last], &iteration, &dt_global, my_rank == comm_size - 1);
+        relaxation_finalise();
+    }
+    else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+    {
+        multigrid_initialise();
+        relax(grids[last], &iteration, &dt_global, my_rank == comm_size - 1);
+    }
+    else if(config_solver == CONFIG_SOLVER_CG)
+    {
+        conjugate_initialise((double**)&grids[grid_count]);
+        relax(grids[last], &iteration, &dt_global, my_rank == comm_size - 1);
+        conjugate_finalise();
+    }
+    else if(config_precision == CONFIG_PRECISION_MIXED)
+    {
+        mixed_initialise();
+        relax(grids[last], &iteration, &dt_global, my_rank == comm_size - 1);
+        mixed_finalise();
+    }
+    else if(config_halo_depth > 1)
+    {
+        deep_initialise(grids[last]);
+        relax(grids[last], &iteration, &dt_global, my_rank == comm_size - 1);
+        deep_finalise();
+    }
 
-        // If we are not the last MPI process, we have a bottom neighbour
-        if(my_rank != comm_size-1)
+    while(!CONFIG_IN_PLACE)
+    {
+        // Run the next iteration, if allowed, while the convergence check of the last window completes. It must not
+        // overwrite the grid that window started from, in case it has to be replayed.
+        int next = spare_grid(grid_count, last, checking ? checked_first_grid : window_first_grid);
+        int allowed = iteration <= MAX_NUMBER_OF_ITERATIONS;
+        if(allowed)
         {
-			// We send our bottom row to our bottom neighbour
-            MPI_Send(&temperature[ROWS][1], COLUMNS, MPI_DOUBLE, my_rank+1, 0, MPI_COMM_WORLD);
+            dt = advance(grids[next], grids[last], iteration + 1);
         }
 
-        // If we are not the first MPI process, we have a top neighbour
-        if(my_rank != 0)
+        if(checking)
         {
-            // We receive the bottom row from that neighbour into our top halo
-            MPI_Recv(&temperature_last[0][1], COLUMNS, MPI_DOUBLE, my_rank-1, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-        }
+            checking = 0;
+            unsigned int needed = convergence_finish(&dt_global);
+            if(dt_global <= MAX_TEMP_ERROR || !allowed)
+            {
+                // The iteration just run is discarded. If convergence was reached before the end of the window, the
+                // window is replayed from the grid it started from up to that iteration. The grids it overwrites may hold
+                // the iteration just run, whose heat went further.
+                unsigned int furthest = iteration + 1;
+                iteration = checked_first + needed;
+                last = checked_last_grid;
+                if(checked_first + needed < checked_last)
+                {
+                    last = checked_first_grid;
+                    for(unsigned int i = 0; i < needed; i++)
+                    {
+                        next = spare_grid(grid_count, last, last);
+                        advance(grids[next], grids[last], furthest);
+                        last = next;
+                    }
+                }
+            }
 
-        // If we are not the first MPI process, we have a top neighbour
-        if(my_rank != 0)
-        {
-            // Send out top row to our top neighbour
-            MPI_Send(&temperature[1][1], COLUMNS, MPI_DOUBLE, my_rank-1, 0, MPI_COMM_WORLD);
-        }
+            // Periodically record test values
+            if((iteration % PRINT_FREQUENCY) == 0 && iteration == (int)checked_last)
+            {
+                if(my_rank == comm_size - 1)
+                {
+                    checkpoint_track_progress(iteration, grids[checked_last_grid]);
+                }
+            }
 
-        // If we are not the last MPI process, we have a bottom neighbour
-        if(my_rank != comm_size-1)
-        {   
-            // We receive the top row from that neighbour into our bottom halo
-            MPI_Recv(&temperature_last[ROWS+1][1], COLUMNS, MPI_DOUBLE, my_rank+1, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
-        }
+            if(dt_global <= MAX_TEMP_ERROR || !allowed)
+            {
+                break;
+            }
 
-        //////////////////////////////////////
-        // FIND MAXIMAL TEMPERATURE CHANGE //
-        ////////////////////////////////////
-        dt = 0.0;
+            // Periodically save the temperatures
+            if(checkpoint_due(iteration))
+            {
+                checkpoint_write(iteration, grids[checked_last_grid], dt_global);
+            }
 
-        for(unsigned int i = 1; i <= ROWS; i++)
-        {
-            for(unsigned int j = 1; j <= COLUMNS; j++)
+            // Periodically save a snapshot of the temperatures
+            if(snapshot_due(iteration))
             {
-    	        dt = fmax(fabs(temperature[i][j]-temperature_last[i][j]), dt);
-    	        temperature_last[i][j] = temperature[i][j];
+                snapshot_write(iteration, grids[checked_last_grid], dt_global);
             }
         }
 
-        // We know our temperature delta, we now need to sum it with that of other MPI processes
-        MPI_Reduce(&dt, &dt_global, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-        MPI_Bcast(&dt_global, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        iteration++;
+        last = next;
+        convergence_record(dt);
 
-        // Periodically print test values
-        if((iteration % PRINT_FREQUENCY) == 0)
+        // At the end of a window, start combining its temperature changes with those of other MPI processes
+        if(iteration == (int)window_last)
         {
-            if(my_rank == comm_size - 1)
-            {
-                track_progress(iteration, temperature);
-    	    }
+            convergence_start();
+            checking = 1;
+            checked_first = window_first;
+            checked_last = window_last;
+            checked_first_grid = window_first_grid;
+            checked_last_grid = last;
+            window_first = iteration;
+            window_last = convergence_window_end(window_first);
+            window_first_grid = last;
         }
     }
 
-
     // Slightly more accurate timing and cleaner output 
     MPI_Barrier(MPI_COMM_WORLD);
 
@@ -155,15 +385,40 @@ int main(int argc, char *argv[])
     if(my_rank == 0)
     {
         stop_timer(&timer_simulation);
+        timer_simulation -= checkpoint_elapsed();
+    }
+
+    // Print the progress recorded, on the MPI process of rank 0 so that it comes out before the summary
+    progress_finalise(iteration);
+    if(my_rank == 0)
+    {
         print_summary(iteration, dt_global, timer_simulation);
     }
+
+    // Save a snapshot of the temperatures reached, if asked for, and wait for all snapshots to be written
+    snapshot_finalise(iteration, grids[last], dt_global);
+
+    // Write the time spent in each phase across all MPI processes, if asked to
+    profile_report(iteration, timer_simulation);
+
+    // Tell how far the multigrid solution is from that of the Jacobi solver, if asked to
+    if(config_solver == CONFIG_SOLVER_MULTIGRID)
+    {
+        multigrid_compare(grids[last]);
+        multigrid_finalise();
+    }
 	
 	// Print the halo swap verification cell value 
 	MPI_Barrier(MPI_COMM_WORLD);
-	if(my_rank == comm_size - 2)
+	if(my_rank == decomposition_rank(decomposition_dimensions[0] - 2, decomposition_dimensions[1] - 1))
 	{
-		printf("Value of halo swap verification cell [%d][%d] is %.18f\n", ROWS_GLOBAL - ROWS - 1, COLUMNS - 1, temperature[ROWS][COLUMNS]);
+		printf("Value of halo swap verification cell [%d][%d] is %.18f\n", decomposition_offsets[0] + ROWS - 1, decomposition_offsets[1] + COLUMNS - 1, grids[last][ROWS][COLUMNS]);
 	}
 
+    convergence_finalise();
+    checkpoint_finalise();
+    // Frees the grids too
+    halo_finalise();
+
     MPI_Finalize();
 }
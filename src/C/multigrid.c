@@ -0,0 +1,835 @@
+/**
+ * @file multigrid.c
+ **/
+
+#include "multigrid.h"
+#include "util.h"
+#include "kernel.h"
+#include "profile.h"
+#include <math.h> // fabs, fmax, sqrt
+#include <stdio.h> // printf, fprintf
+#include <stdlib.h> // calloc, malloc, free, exit, EXIT_FAILURE
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+	#include "decomposition.h"
+#endif
+
+/// Distance between the temperature change slots of two OpenMP threads, in doubles, so that each fills its own cache line.
+#define MULTIGRID_SLOT_STRIDE 8
+
+/// A grid of the hierarchy or, in the MPI versions, my tile of it.
+typedef struct
+{
+	/// The number of rows and columns, excluding boundaries.
+	int extents[2];
+	/// The global row and column of cell [0][0] on this grid: cell [i][j] is cell [offset + i][offset + j] of the grid.
+	int offsets[2];
+	/// The number of rows and columns of the whole grid, excluding boundaries.
+	int global_extents[2];
+	/// The distance from the last row and column of the whole grid to the boundary after them, in spacings of this grid, between 0 excluded and 1.
+	double distances[2];
+	/// The temperatures on the finest grid, the correction on the others, boundaries and halos included.
+	double* u;
+	/// The right-hand side, scaled like the residual; NULL on the finest grid, where it is zero.
+	double* f;
+	/// The residual, that is the change a Jacobi iteration would make to each cell. The Jacobi smoother uses it as scratch.
+	double* r;
+	/// Whether the halos are swapped with the neighbouring MPI processes.
+	int distributed;
+	#ifdef VERSION_RUN_IS_MPI
+		/// A column of the grid, rows 1 to extents[0].
+		MPI_Datatype column;
+	#endif
+} multigrid_level;
+
+/// The hierarchy of grids, starting from the finest one. In the MPI versions, my tiles, the last one being gathered on the MPI process of rank 0.
+static multigrid_level multigrid_levels[MULTIGRID_MAX_LEVELS];
+/// The number of grids in multigrid_levels.
+static int multigrid_level_count = 0;
+/// The maximal temperature change found by each OpenMP thread, in two sets used by turns.
+static double* multigrid_slots = NULL;
+/// The number of calls to multigrid_cycle() made so far by my OpenMP thread, which tells the set of slots to use.
+static unsigned int multigrid_round = 0;
+#pragma omp threadprivate(multigrid_round)
+#ifdef VERSION_RUN_IS_MPI
+	/// The rank of my MPI process, kept so that threads other than the master do not call MPI.
+	static int multigrid_rank = 0;
+	/// On the MPI process of rank 0, the grid gathered and the coarser ones.
+	static multigrid_level multigrid_global[MULTIGRID_MAX_LEVELS];
+	/// The number of grids in multigrid_global, 0 on the other MPI processes.
+	static int multigrid_global_count = 0;
+	/// On the MPI process of rank 0, the offsets and extents of the tiles of the grid gathered, 4 integers per MPI process.
+	static int* multigrid_pieces = NULL;
+	/// On the MPI process of rank 0, the number of cells gathered from, and scattered to, each MPI process.
+	static int* multigrid_gather_counts = NULL;
+	static int* multigrid_scatter_counts = NULL;
+	/// On the MPI process of rank 0, where the cells of each MPI process start in multigrid_buffer.
+	static int* multigrid_gather_displacements = NULL;
+	static int* multigrid_scatter_displacements = NULL;
+	/// The cells gathered or scattered; on the other MPI processes, the right-hand side of my tile only.
+	static double* multigrid_buffer = NULL;
+	/// The temperature change across all MPI processes found by the master thread, in two sets used by turns.
+	static double multigrid_dt_global[2];
+#endif
+
+/**
+ * @brief Allocates a zeroed array the size of a grid, boundaries included.
+ * @param[in] level The grid.
+ * @return The array allocated. If the allocation fails, the program is terminated.
+ **/
+static double* multigrid_allocate(const multigrid_level* level)
+{
+	double* array = calloc((size_t)(level->extents[0] + 2) * (level->extents[1] + 2), sizeof(double));
+	if(array == NULL)
+	{
+		printf("Failed to allocate a multigrid level of %d x %d cells.\n", level->extents[0], level->extents[1]);
+		exit(EXIT_FAILURE);
+	}
+	return array;
+}
+
+/**
+ * @brief Derives a coarser grid, made of the cells at even global rows and columns of a finer one.
+ * @param[in] fine The finer grid.
+ * @param[out] coarse The coarser grid, whose extents and offsets are set.
+ **/
+static void multigrid_coarsen(const multigrid_level* fine, multigrid_level* coarse)
+{
+	for(int d = 0; d < 2; d++)
+	{
+		coarse->offsets[d] = fine->offsets[d] / 2;
+		coarse->extents[d] = (fine->offsets[d] + fine->extents[d]) / 2 - fine->offsets[d] / 2;
+		// The boundary stays where it is, which is a coarse cell only if the fine grid has an odd extent
+		coarse->global_extents[d] = fine->global_extents[d] / 2;
+		coarse->distances[d] = (fine->global_extents[d] + fine->distances[d]) / 2.0 - coarse->global_extents[d];
+	}
+	coarse->u = NULL;
+	coarse->f = NULL;
+	coarse->r = NULL;
+	coarse->distributed = 0;
+}
+
+/**
+ * @brief Swaps the halos of an array of a grid with the neighbouring MPI processes, if that grid is distributed.
+ * @param[in] level The grid.
+ * @param[inout] array The array whose halos to swap, rows 1 to extents[0] and the halo columns included in the rows sent.
+ * @pre The array is up to date in all OpenMP threads.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void multigrid_swap(const multigrid_level* level, double* array)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		if(level->distributed)
+		{
+			#pragma omp master
+			{
+				double profile_start = profile_now();
+				int rows = level->extents[0];
+				int columns = level->extents[1];
+				double (*a)[columns+2] = (double (*)[columns+2])array;
+				const int* neighbours = decomposition_neighbours;
+				MPI_Comm communicator = decomposition_communicator;
+
+				// Columns first, then whole rows including the halo columns just received, so that corners are swapped too
+				MPI_Sendrecv(&a[1][1], 1, level->column, neighbours[DECOMPOSITION_LEFT], 0, &a[1][columns+1], 1, level->column, neighbours[DECOMPOSITION_RIGHT], 0, communicator, MPI_STATUS_IGNORE);
+				MPI_Sendrecv(&a[1][columns], 1, level->column, neighbours[DECOMPOSITION_RIGHT], 1, &a[1][0], 1, level->column, neighbours[DECOMPOSITION_LEFT], 1, communicator, MPI_STATUS_IGNORE);
+				MPI_Sendrecv(&a[1][0], columns + 2, MPI_DOUBLE, neighbours[DECOMPOSITION_TOP], 2, &a[rows+1][0], columns + 2, MPI_DOUBLE, neighbours[DECOMPOSITION_BOTTOM], 2, communicator, MPI_STATUS_IGNORE);
+				MPI_Sendrecv(&a[rows][0], columns + 2, MPI_DOUBLE, neighbours[DECOMPOSITION_BOTTOM], 3, &a[0][0], columns + 2, MPI_DOUBLE, neighbours[DECOMPOSITION_TOP], 3, communicator, MPI_STATUS_IGNORE);
+				profile_add(PROFILE_HALO, profile_start, 0);
+			} // End of OpenMP master region
+			#pragma omp barrier
+		}
+	#else
+		(void)level;
+		(void)array;
+	#endif
+}
+
+/**
+ * @brief Gives the weights of the stencil of a grid along one dimension, at a row or column.
+ * @details Cells are evenly spaced, but the last row and column may lie closer to the boundary, which is then not one of the coarser cells: the neighbour on the other side weighs more, and so does the cell itself. The boundary holds no correction, its own weight does not matter.
+ * @param[in] level The grid.
+ * @param[in] dimension 0 for a row, 1 for a column.
+ * @param[in] index The row or column.
+ * @param[out] neighbour The weight of the neighbour before it, above or to the left.
+ * @param[out] diagonal The weight of the cell itself.
+ **/
+static inline void multigrid_weights(const multigrid_level* level, int dimension, int index, double* neighbour, double* diagonal)
+{
+	*neighbour = 1.0;
+	*diagonal = 2.0;
+	if(level->offsets[dimension] + index == level->global_extents[dimension])
+	{
+		double distance = level->distances[dimension];
+		*neighbour = 2.0 / (1.0 + distance);
+		*diagonal = 2.0 / distance;
+	}
+}
+
+/**
+ * @brief Smoothes a grid.
+ * @details Red-black Gauss-Seidel updates the red cells then the black ones in place, where red cells are those whose global row and column sum to an even number. Weighted Jacobi computes all cells in the residual array, then copies them back.
+ * @param[inout] level The grid, whose halos are swapped before each colour or sweep.
+ * @param[in] sweeps The number of sweeps.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void multigrid_smooth(multigrid_level* level, int sweeps)
+{
+	int rows = level->extents[0];
+	int columns = level->extents[1];
+	double (*u)[columns+2] = (double (*)[columns+2])level->u;
+	double (*f)[columns+2] = (double (*)[columns+2])level->f;
+	double (*r)[columns+2] = (double (*)[columns+2])level->r;
+	int parity = (level->offsets[0] + level->offsets[1]) % 2;
+
+	for(int s = 0; s < sweeps; s++)
+	{
+		if(config_smoother == CONFIG_SMOOTHER_GAUSS_SEIDEL)
+		{
+			for(int colour = 0; colour < 2; colour++)
+			{
+				multigrid_swap(level, level->u);
+
+				double profile_start = profile_now();
+				long cells = 0;
+				#pragma omp for schedule(static)
+				for(int i = 1; i <= rows; i++)
+				{
+					// The first cell of the colour in this row, the others being every other cell from there
+					int first = 1 + (parity + i + 1 + colour) % 2;
+					if(first > columns)
+					{
+						continue;
+					}
+					if(f == NULL)
+					{
+						// The finest grid has no right-hand side, the relaxation kernels apply as they are
+						kernel_relax(u[i], u[i-1], u[i+1], first, columns, 1.0);
+					}
+					else
+					{
+						double above;
+						double row_diagonal;
+						multigrid_weights(level, 0, i, &above, &row_diagonal);
+						for(int j = first; j <= columns; j += 2)
+						{
+							double left;
+							double column_diagonal;
+							multigrid_weights(level, 1, j, &left, &column_diagonal);
+							u[i][j] = (f[i][j] + u[i+1][j] + above * u[i-1][j] + u[i][j+1] + left * u[i][j-1]) / (row_diagonal + column_diagonal);
+						}
+					}
+					cells += (columns - first) / 2 + 1;
+				}
+				profile_add(PROFILE_STENCIL, profile_start, cells);
+			}
+		}
+		else
+		{
+			multigrid_swap(level, level->u);
+
+			double profile_start = profile_now();
+			#pragma omp for schedule(static)
+			for(int i = 1; i <= rows; i++)
+			{
+				double above;
+				double row_diagonal;
+				multigrid_weights(level, 0, i, &above, &row_diagonal);
+				for(int j = 1; j <= columns; j++)
+				{
+					double left;
+					double column_diagonal;
+					multigrid_weights(level, 1, j, &left, &column_diagonal);
+					double average = ((f == NULL ? 0.0 : f[i][j]) + u[i+1][j] + above * u[i-1][j] + u[i][j+1] + left * u[i][j-1]) / (row_diagonal + column_diagonal);
+					r[i][j] = u[i][j] + MULTIGRID_JACOBI_WEIGHT * (average - u[i][j]);
+				}
+			}
+			long cells = 0;
+			#pragma omp for schedule(static)
+			for(int i = 1; i <= rows; i++)
+			{
+				for(int j = 1; j <= columns; j++)
+				{
+					u[i][j] = r[i][j];
+				}
+				cells += columns;
+			}
+			profile_add(PROFILE_STENCIL, profile_start, cells);
+		}
+	}
+}
+
+/**
+ * @brief Computes the residual of a grid.
+ * @param[inout] level The grid, whose halos are swapped first.
+ * @return The largest residual, in absolute value, across the rows computed by my OpenMP thread.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static double multigrid_residual(multigrid_level* level)
+{
+	int rows = level->extents[0];
+	int columns = level->extents[1];
+	double (*u)[columns+2] = (double (*)[columns+2])level->u;
+	double (*f)[columns+2] = (double (*)[columns+2])level->f;
+	double (*r)[columns+2] = (double (*)[columns+2])level->r;
+
+	multigrid_swap(level, level->u);
+
+	double profile_start = profile_now();
+	double dt = 0.0;
+	long cells = 0;
+	#pragma omp for schedule(static)
+	for(int i = 1; i <= rows; i++)
+	{
+		if(f == NULL)
+		{
+			// The residual kernel adds the neighbours in the order of the Jacobi kernels, so that the finest residual is
+			// their temperature change
+			dt = fmax(kernel_residual_double(&r[i][0], &u[i-1][0], &u[i][0], &u[i+1][0], columns), dt);
+		}
+		else
+		{
+			double above;
+			double row_diagonal;
+			multigrid_weights(level, 0, i, &above, &row_diagonal);
+			for(int j = 1; j <= columns; j++)
+			{
+				double left;
+				double column_diagonal;
+				multigrid_weights(level, 1, j, &left, &column_diagonal);
+				r[i][j] = 0.25 * (f[i][j] + u[i+1][j] + above * u[i-1][j] + u[i][j+1] + left * u[i][j-1] - (row_diagonal + column_diagonal) * u[i][j]);
+				dt = fmax(fabs(r[i][j]), dt);
+			}
+		}
+		cells += columns;
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+	return dt;
+}
+
+/**
+ * @brief Restricts the residual of a grid to the right-hand side of the coarser one, with full weighting, and zeroes the correction of the latter.
+ * @param[inout] fine The finer grid, whose residual halos are swapped first.
+ * @param[inout] coarse The coarser grid.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void multigrid_restrict(multigrid_level* fine, multigrid_level* coarse)
+{
+	double (*r)[fine->extents[1]+2] = (double (*)[fine->extents[1]+2])fine->r;
+	double (*f)[coarse->extents[1]+2] = (double (*)[coarse->extents[1]+2])coarse->f;
+	double (*u)[coarse->extents[1]+2] = (double (*)[coarse->extents[1]+2])coarse->u;
+
+	multigrid_swap(fine, fine->r);
+
+	double profile_start = profile_now();
+	long cells = 0;
+	#pragma omp for schedule(static)
+	for(int I = 1; I <= coarse->extents[0]; I++)
+	{
+		int i = 2 * (coarse->offsets[0] + I) - fine->offsets[0];
+		for(int J = 1; J <= coarse->extents[1]; J++)
+		{
+			int j = 2 * (coarse->offsets[1] + J) - fine->offsets[1];
+			// The residual is scaled by a quarter and the coarse spacing is twice the fine one: the weights of 1/16
+			// become 1
+			f[I][J] = 4.0 * r[i][j]
+			        + 2.0 * (r[i-1][j] + r[i+1][j] + r[i][j-1] + r[i][j+1])
+			        + (r[i-1][j-1] + r[i-1][j+1] + r[i+1][j-1] + r[i+1][j+1]);
+			u[I][J] = 0.0;
+		}
+		cells += coarse->extents[1];
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+}
+
+/**
+ * @brief Gives the weights of the coarse cells around a fine one along one dimension.
+ * @param[in] coarse The coarser grid.
+ * @param[in] global The global row or column of the fine cell.
+ * @param[in] dimension 0 for a row, 1 for a column.
+ * @return The weight of the coarse cell before the fine one, that after it weighing the rest. Both are the same cell if the fine one lies on it.
+ **/
+static inline double multigrid_interpolation(const multigrid_level* coarse, int global, int dimension)
+{
+	// The fine cell lies between the last coarse cell and the boundary, which may be closer than the coarse spacing
+	if(global % 2 == 1 && (global + 1) / 2 == coarse->global_extents[dimension] + 1)
+	{
+		double distance = coarse->distances[dimension];
+		return (2.0 * distance - 1.0) / (2.0 * distance);
+	}
+	return 0.5;
+}
+
+/**
+ * @brief Interpolates the correction of a grid bilinearly onto the finer one, and adds it there.
+ * @param[inout] coarse The coarser grid, whose correction halos are swapped first.
+ * @param[inout] fine The finer grid.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void multigrid_prolong(multigrid_level* coarse, multigrid_level* fine)
+{
+	double (*e)[coarse->extents[1]+2] = (double (*)[coarse->extents[1]+2])coarse->u;
+	double (*u)[fine->extents[1]+2] = (double (*)[fine->extents[1]+2])fine->u;
+
+	multigrid_swap(coarse, coarse->u);
+
+	double profile_start = profile_now();
+	long cells = 0;
+	#pragma omp for schedule(static)
+	for(int i = 1; i <= fine->extents[0]; i++)
+	{
+		// Coarse cells around the fine one, the same twice if it lies on a coarse row
+		int global_row = fine->offsets[0] + i;
+		int i0 = global_row / 2 - coarse->offsets[0];
+		int i1 = (global_row + 1) / 2 - coarse->offsets[0];
+		double w0 = multigrid_interpolation(coarse, global_row, 0);
+		double w1 = 1.0 - w0;
+		for(int j = 1; j <= fine->extents[1]; j++)
+		{
+			int global_column = fine->offsets[1] + j;
+			int j0 = global_column / 2 - coarse->offsets[1];
+			int j1 = (global_column + 1) / 2 - coarse->offsets[1];
+			double v0 = multigrid_interpolation(coarse, global_column, 1);
+			double v1 = 1.0 - v0;
+			u[i][j] += w0 * (v0 * e[i0][j0] + v1 * e[i0][j1]) + w1 * (v0 * e[i1][j0] + v1 * e[i1][j1]);
+		}
+		cells += fine->extents[1];
+	}
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+}
+
+static void multigrid_vcycle(multigrid_level* levels, int count, int l);
+
+#ifdef VERSION_RUN_IS_MPI
+/**
+ * @brief Solves the last grid of my tiles by gathering it on the MPI process of rank 0.
+ * @details The right-hand sides of all tiles are gathered in the first grid of multigrid_global, the MPI process of rank 0 runs a V-cycle on its own from there, then scatters the correction of each tile, halos included.
+ * @param[inout] level My tile of the grid gathered.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void multigrid_agglomerate(multigrid_level* level)
+{
+	int my_rank = multigrid_rank;
+
+	#pragma omp master
+	{
+		double profile_start = profile_now();
+		double (*f)[level->extents[1]+2] = (double (*)[level->extents[1]+2])level->f;
+		double* piece = (my_rank == 0) ? multigrid_buffer + multigrid_gather_displacements[0] : multigrid_buffer;
+		int k = 0;
+		for(int i = 1; i <= level->extents[0]; i++)
+		{
+			for(int j = 1; j <= level->extents[1]; j++)
+			{
+				piece[k++] = f[i][j];
+			}
+		}
+		MPI_Gatherv((my_rank == 0) ? MPI_IN_PLACE : piece, k, MPI_DOUBLE, multigrid_buffer, multigrid_gather_counts, multigrid_gather_displacements, MPI_DOUBLE, 0, decomposition_communicator);
+
+		if(my_rank == 0)
+		{
+			multigrid_level* global = &multigrid_global[0];
+			double (*global_f)[global->extents[1]+2] = (double (*)[global->extents[1]+2])global->f;
+			double (*global_u)[global->extents[1]+2] = (double (*)[global->extents[1]+2])global->u;
+			int comm_size;
+			MPI_Comm_size(decomposition_communicator, &comm_size);
+			for(int p = 0; p < comm_size; p++)
+			{
+				const int* offsets = &multigrid_pieces[4 * p];
+				const int* extents = &multigrid_pieces[4 * p + 2];
+				const double* cells = multigrid_buffer + multigrid_gather_displacements[p];
+				for(int i = 1; i <= extents[0]; i++)
+				{
+					for(int j = 1; j <= extents[1]; j++)
+					{
+						global_f[offsets[0] + i][offsets[1] + j] = *cells++;
+						global_u[offsets[0] + i][offsets[1] + j] = 0.0;
+					}
+				}
+			}
+		}
+		profile_add(PROFILE_HALO, profile_start, 0);
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	if(my_rank == 0)
+	{
+		multigrid_vcycle(multigrid_global, multigrid_global_count, 0);
+	}
+
+	#pragma omp master
+	{
+		double profile_start = profile_now();
+		if(my_rank == 0)
+		{
+			multigrid_level* global = &multigrid_global[0];
+			double (*global_u)[global->extents[1]+2] = (double (*)[global->extents[1]+2])global->u;
+			int comm_size;
+			MPI_Comm_size(decomposition_communicator, &comm_size);
+			for(int p = 0; p < comm_size; p++)
+			{
+				const int* offsets = &multigrid_pieces[4 * p];
+				const int* extents = &multigrid_pieces[4 * p + 2];
+				double* cells = multigrid_buffer + multigrid_scatter_displacements[p];
+				for(int i = 0; i <= extents[0] + 1; i++)
+				{
+					for(int j = 0; j <= extents[1] + 1; j++)
+					{
+						*cells++ = global_u[offsets[0] + i][offsets[1] + j];
+					}
+				}
+			}
+		}
+		MPI_Scatterv(multigrid_buffer, multigrid_scatter_counts, multigrid_scatter_displacements, MPI_DOUBLE, level->u, (level->extents[0] + 2) * (level->extents[1] + 2), MPI_DOUBLE, 0, decomposition_communicator);
+		profile_add(PROFILE_HALO, profile_start, 0);
+	} // End of OpenMP master region
+	#pragma omp barrier
+}
+#endif
+
+/**
+ * @brief Runs a V-cycle from a grid of a hierarchy down.
+ * @param[inout] levels The hierarchy.
+ * @param[in] count The number of grids in the hierarchy.
+ * @param[in] l The grid to start from, whose right-hand side is set.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+static void multigrid_vcycle(multigrid_level* levels, int count, int l)
+{
+	multigrid_level* level = &levels[l];
+
+	if(l == count - 1)
+	{
+		#ifdef VERSION_RUN_IS_MPI
+			if(levels == multigrid_levels)
+			{
+				multigrid_agglomerate(level);
+				return;
+			}
+		#endif
+		multigrid_smooth(level, MULTIGRID_COARSEST_SMOOTHING);
+		return;
+	}
+
+	multigrid_smooth(level, MULTIGRID_PRE_SMOOTHING);
+	multigrid_residual(level);
+	multigrid_restrict(level, &levels[l + 1]);
+	multigrid_vcycle(levels, count, l + 1);
+	multigrid_prolong(&levels[l + 1], level);
+	multigrid_smooth(level, MULTIGRID_POST_SMOOTHING);
+}
+
+void multigrid_initialise(void)
+{
+	int my_rank = 0;
+	multigrid_level* finest = &multigrid_levels[0];
+	finest->extents[0] = ROWS;
+	finest->extents[1] = COLUMNS;
+	finest->offsets[0] = 0;
+	finest->offsets[1] = 0;
+	finest->global_extents[0] = ROWS_GLOBAL;
+	finest->global_extents[1] = COLUMNS_GLOBAL;
+	finest->distances[0] = 1.0;
+	finest->distances[1] = 1.0;
+	finest->u = NULL;
+	finest->f = NULL;
+	finest->distributed = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(decomposition_communicator, &my_rank);
+		multigrid_rank = my_rank;
+		finest->offsets[0] = decomposition_offsets[0];
+		finest->offsets[1] = decomposition_offsets[1];
+		finest->distributed = 1;
+	#endif
+	finest->r = multigrid_allocate(finest);
+	multigrid_level_count = 1;
+
+	// Coarsen my tiles until they get too small somewhere, the last one being gathered; without MPI, until the grid
+	// cannot be coarsened further
+	for(;;)
+	{
+		multigrid_level* fine = &multigrid_levels[multigrid_level_count - 1];
+		#ifdef VERSION_RUN_IS_MPI
+			multigrid_level* coarse = &multigrid_levels[multigrid_level_count];
+			multigrid_coarsen(fine, coarse);
+			int smallest = (coarse->extents[0] < coarse->extents[1]) ? coarse->extents[0] : coarse->extents[1];
+			MPI_Allreduce(MPI_IN_PLACE, &smallest, 1, MPI_INT, MPI_MIN, decomposition_communicator);
+			coarse->distributed = (smallest >= MULTIGRID_AGGLOMERATION_EXTENT && multigrid_level_count + 1 < MULTIGRID_MAX_LEVELS);
+			coarse->u = multigrid_allocate(coarse);
+			coarse->f = multigrid_allocate(coarse);
+			multigrid_level_count++;
+			if(!coarse->distributed)
+			{
+				break;
+			}
+			coarse->r = multigrid_allocate(coarse);
+		#else
+			if(fine->extents[0] <= MULTIGRID_COARSEST_EXTENT || fine->extents[1] <= MULTIGRID_COARSEST_EXTENT || multigrid_level_count == MULTIGRID_MAX_LEVELS)
+			{
+				break;
+			}
+			multigrid_level* coarse = &multigrid_levels[multigrid_level_count];
+			multigrid_coarsen(fine, coarse);
+			coarse->u = multigrid_allocate(coarse);
+			coarse->f = multigrid_allocate(coarse);
+			coarse->r = multigrid_allocate(coarse);
+			multigrid_level_count++;
+		#endif
+	}
+
+	#ifdef VERSION_RUN_IS_MPI
+		for(int l = 0; l < multigrid_level_count; l++)
+		{
+			multigrid_level* level = &multigrid_levels[l];
+			if(level->distributed)
+			{
+				MPI_Type_vector(level->extents[0], 1, level->extents[1] + 2, MPI_DOUBLE, &level->column);
+				MPI_Type_commit(&level->column);
+			}
+		}
+
+		// The MPI process of rank 0 learns the tiles of the grid gathered, and builds the coarser grids on its own
+		multigrid_level* gathered = &multigrid_levels[multigrid_level_count - 1];
+		int comm_size;
+		MPI_Comm_size(decomposition_communicator, &comm_size);
+		int piece[4] = {gathered->offsets[0], gathered->offsets[1], gathered->extents[0], gathered->extents[1]};
+		if(my_rank == 0)
+		{
+			multigrid_pieces = malloc(sizeof(int) * 4 * comm_size);
+			multigrid_gather_counts = malloc(sizeof(int) * comm_size);
+			multigrid_gather_displacements = malloc(sizeof(int) * comm_size);
+			multigrid_scatter_counts = malloc(sizeof(int) * comm_size);
+			multigrid_scatter_displacements = malloc(sizeof(int) * comm_size);
+			if(multigrid_pieces == NULL || multigrid_gather_counts == NULL || multigrid_gather_displacements == NULL || multigrid_scatter_counts == NULL || multigrid_scatter_displacements == NULL)
+			{
+				printf("Failed to allocate the multigrid agglomeration buffers.\n");
+				MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+			}
+		}
+		MPI_Gather(piece, 4, MPI_INT, multigrid_pieces, 4, MPI_INT, 0, decomposition_communicator);
+
+		size_t buffer_size = (size_t)gathered->extents[0] * gathered->extents[1];
+		if(my_rank == 0)
+		{
+			// Tiles are gathered without halos and scattered with them, one after the other in the same buffer
+			int gather_total = 0;
+			int scatter_total = 0;
+			for(int p = 0; p < comm_size; p++)
+			{
+				const int* extents = &multigrid_pieces[4 * p + 2];
+				multigrid_gather_counts[p] = extents[0] * extents[1];
+				multigrid_gather_displacements[p] = gather_total;
+				gather_total += multigrid_gather_counts[p];
+				multigrid_scatter_counts[p] = (extents[0] + 2) * (extents[1] + 2);
+				multigrid_scatter_displacements[p] = scatter_total;
+				scatter_total += multigrid_scatter_counts[p];
+			}
+			buffer_size = (gather_total > scatter_total) ? gather_total : scatter_total;
+
+			multigrid_level* global = &multigrid_global[0];
+			global->offsets[0] = 0;
+			global->offsets[1] = 0;
+			for(int d = 0; d < 2; d++)
+			{
+				global->extents[d] = gathered->global_extents[d];
+				global->global_extents[d] = gathered->global_extents[d];
+				global->distances[d] = gathered->distances[d];
+			}
+			global->distributed = 0;
+			global->u = multigrid_allocate(global);
+			global->f = multigrid_allocate(global);
+			global->r = multigrid_allocate(global);
+			multigrid_global_count = 1;
+			while(global->extents[0] > MULTIGRID_COARSEST_EXTENT && global->extents[1] > MULTIGRID_COARSEST_EXTENT && multigrid_global_count < MULTIGRID_MAX_LEVELS)
+			{
+				multigrid_level* coarse = &multigrid_global[multigrid_global_count];
+				multigrid_coarsen(global, coarse);
+				coarse->u = multigrid_allocate(coarse);
+				coarse->f = multigrid_allocate(coarse);
+				coarse->r = multigrid_allocate(coarse);
+				multigrid_global_count++;
+				global = coarse;
+			}
+		}
+		multigrid_buffer = malloc(sizeof(double) * buffer_size);
+		if(multigrid_buffer == NULL)
+		{
+			printf("Failed to allocate the multigrid agglomeration buffers.\n");
+			MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+		}
+	#endif
+
+	if(my_rank == 0)
+	{
+		int grid_count = multigrid_level_count;
+		#ifdef VERSION_RUN_IS_MPI
+			// The grid gathered is both my last tile and the first grid of the MPI process of rank 0
+			grid_count += multigrid_global_count - 1;
+		#endif
+		fprintf(stderr, "Multigrid V-cycles over %d grids, with %s smoothing.\n", grid_count, (config_smoother == CONFIG_SMOOTHER_GAUSS_SEIDEL) ? "red-black Gauss-Seidel" : "weighted Jacobi");
+	}
+
+	int thread_count = 1;
+	#ifdef _OPENMP
+		thread_count = omp_get_max_threads();
+	#endif
+	multigrid_slots = malloc(sizeof(double) * 2 * thread_count * MULTIGRID_SLOT_STRIDE);
+	if(multigrid_slots == NULL)
+	{
+		printf("Failed to allocate the multigrid buffers.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+double multigrid_cycle(double grid[ROWS+2][COLUMNS+2])
+{
+	int thread_count = 1;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_count = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+	#endif
+	int set = multigrid_round % 2;
+	double* slots = multigrid_slots + set * thread_count * MULTIGRID_SLOT_STRIDE;
+	multigrid_round++;
+
+	#pragma omp master
+	{
+		multigrid_levels[0].u = &grid[0][0];
+	} // End of OpenMP master region
+	#pragma omp barrier
+
+	multigrid_vcycle(multigrid_levels, multigrid_level_count, 0);
+
+	// The residual of the temperatures reached, combined across threads. Slots alternate between two sets from one
+	// cycle to the next, so that a thread can fill a slot of the next cycle while the others still read those of this one.
+	slots[thread_id * MULTIGRID_SLOT_STRIDE] = multigrid_residual(&multigrid_levels[0]);
+	#pragma omp barrier
+	double profile_start = profile_now();
+	double dt = 0.0;
+	for(int t = 0; t < thread_count; t++)
+	{
+		dt = fmax(slots[t * MULTIGRID_SLOT_STRIDE], dt);
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+
+	#ifdef VERSION_RUN_IS_MPI
+		#pragma omp master
+		{
+			profile_start = profile_now();
+			MPI_Allreduce(&dt, &multigrid_dt_global[set], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+			profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+		} // End of OpenMP master region
+		#pragma omp barrier
+		dt = multigrid_dt_global[set];
+	#endif
+
+	return dt;
+}
+
+void multigrid_compare(double grid[ROWS+2][COLUMNS+2])
+{
+	if(config_reference == CONFIG_REFERENCE_NONE)
+	{
+		return;
+	}
+
+	double (*current)[COLUMNS+2] = malloc(sizeof(double) * (ROWS + 2) * (COLUMNS + 2));
+	double (*last)[COLUMNS+2] = malloc(sizeof(double) * (ROWS + 2) * (COLUMNS + 2));
+	if(current == NULL || last == NULL)
+	{
+		printf("Failed to allocate the Jacobi reference grids.\n");
+		exit(EXIT_FAILURE);
+	}
+	initialise_temperatures(current, last);
+
+	// The Jacobi solver, iteration by iteration, with the same kernels
+	int iteration = 0;
+	double dt = 100;
+	while(dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
+	{
+		multigrid_swap(&multigrid_levels[0], &last[0][0]);
+		dt = 0.0;
+		#pragma omp parallel for schedule(static) reduction(max:dt)
+		for(int i = 1; i <= ROWS; i++)
+		{
+			dt = fmax(kernel_row(current[i], last[i-1], last[i], last[i+1], COLUMNS), dt);
+		}
+		#ifdef VERSION_RUN_IS_MPI
+			MPI_Allreduce(MPI_IN_PLACE, &dt, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		#endif
+		double (*swap)[COLUMNS+2] = last;
+		last = current;
+		current = swap;
+		iteration++;
+	}
+
+	double differences[2] = {0.0, 0.0};
+	for(int i = 1; i <= ROWS; i++)
+	{
+		for(int j = 1; j <= COLUMNS; j++)
+		{
+			double difference = fabs(grid[i][j] - last[i][j]);
+			differences[0] = fmax(difference, differences[0]);
+			differences[1] += difference * difference;
+		}
+	}
+	int my_rank = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+		MPI_Allreduce(MPI_IN_PLACE, &differences[0], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+		MPI_Allreduce(MPI_IN_PLACE, &differences[1], 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+	#endif
+	if(my_rank == 0)
+	{
+		fprintf(stderr, "Difference with the Jacobi solution, reached at iteration %d: %.6e at most, %.6e root mean square.\n", iteration, differences[0], sqrt(differences[1] / ((double)ROWS_GLOBAL * COLUMNS_GLOBAL)));
+	}
+
+	free(current);
+	free(last);
+}
+
+void multigrid_finalise(void)
+{
+	for(int l = 0; l < multigrid_level_count; l++)
+	{
+		multigrid_level* level = &multigrid_levels[l];
+		if(l > 0)
+		{
+			free(level->u);
+			free(level->f);
+		}
+		free(level->r);
+		#ifdef VERSION_RUN_IS_MPI
+			if(level->distributed)
+			{
+				MPI_Type_free(&level->column);
+			}
+		#endif
+	}
+	multigrid_level_count = 0;
+
+	#ifdef VERSION_RUN_IS_MPI
+		for(int l = 0; l < multigrid_global_count; l++)
+		{
+			free(multigrid_global[l].u);
+			free(multigrid_global[l].f);
+			free(multigrid_global[l].r);
+		}
+		multigrid_global_count = 0;
+		free(multigrid_pieces);
+		free(multigrid_gather_counts);
+		free(multigrid_gather_displacements);
+		free(multigrid_scatter_counts);
+		free(multigrid_scatter_displacements);
+		free(multigrid_buffer);
+		multigrid_pieces = NULL;
+		multigrid_buffer = NULL;
+	#endif
+
+	free(multigrid_slots);
+	multigrid_slots = NULL;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file multigrid.h
+ * @brief This file contains the geometric multigrid solver of the CPU versions.
+ * @details Each iteration is a V-cycle over a hierarchy of grids, each coarse grid having every other row and column of the finer one, down to grids of MULTIGRID_COARSEST_EXTENT rows or columns. The boundary after the last row or column of a coarse grid may lie closer than its spacing, when the finer grid has an even extent; the stencil and the interpolation account for it on that row or column, so that grids of any size coarsen well. On the way down, each grid is smoothed MULTIGRID_PRE_SMOOTHING times, and its residual restricted to the coarser grid with full weighting; the coarsest grid is smoothed MULTIGRID_COARSEST_SMOOTHING times; on the way up, the correction found on each coarse grid is interpolated bilinearly onto the finer one, which is smoothed MULTIGRID_POST_SMOOTHING times. The smoother is picked with '--smoother': red-black Gauss-Seidel, by default, or weighted Jacobi.
+ *
+ * The temperature change of an iteration is the largest change a Jacobi iteration would make to the temperatures reached by the V-cycle, that is the residual of the Laplace equation scaled like the temperature changes of the Jacobi solver, and is compared with the same tolerance. The number of V-cycles needed does not grow with the size of the grid. Unless '--reference none' is given, multigrid_compare() reports the difference between the temperatures reached and those the Jacobi solver converges to. At loose tolerances, that difference mostly measures how far the Jacobi solver stops from the steady state.
+ *
+ * In the MPI versions, each MPI process holds its tile of every grid down to the first one whose tiles have fewer than MULTIGRID_AGGLOMERATION_EXTENT rows or columns somewhere. That grid is gathered on the MPI process of rank 0, which runs the coarser grids on its own, and its correction scattered back, halos included. Halos are swapped with blocking messages at each level, columns first then rows, so that corners, read by the restriction, are swapped too. Only the master thread calls MPI.
+ **/
+
+#ifndef MULTIGRID_H_INCLUDED
+#define MULTIGRID_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// Number of smoothing sweeps before restricting the residual.
+#ifndef MULTIGRID_PRE_SMOOTHING
+	#define MULTIGRID_PRE_SMOOTHING 2
+#endif
+/// Number of smoothing sweeps after interpolating the correction.
+#ifndef MULTIGRID_POST_SMOOTHING
+	#define MULTIGRID_POST_SMOOTHING 2
+#endif
+/// Number of smoothing sweeps on the coarsest grid, in place of a direct solve.
+#ifndef MULTIGRID_COARSEST_SMOOTHING
+	#define MULTIGRID_COARSEST_SMOOTHING 32
+#endif
+/// Grids with this many rows or columns, or fewer, are not coarsened further.
+#define MULTIGRID_COARSEST_EXTENT 2
+/// In the MPI versions, grids whose tiles have fewer rows or columns than this somewhere are gathered on one MPI process.
+#ifndef MULTIGRID_AGGLOMERATION_EXTENT
+	#define MULTIGRID_AGGLOMERATION_EXTENT 16
+#endif
+/// Weight of the Jacobi smoother, optimal for the smoothing of the Laplace equation in two dimensions.
+#define MULTIGRID_JACOBI_WEIGHT 0.8
+/// Maximum number of grids in the hierarchy.
+#define MULTIGRID_MAX_LEVELS 32
+
+/**
+ * @brief Builds the hierarchy of grids.
+ * @pre In the MPI versions, decomposition_initialise() has been called, and it is called by all MPI processes.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void multigrid_initialise(void);
+/**
+ * @brief Runs one V-cycle, in place.
+ * @param[inout] grid The grid to update, with its boundaries set. Its halos are swapped before being read.
+ * @return The largest change a Jacobi iteration would make to the temperatures reached; in the MPI versions, across all MPI processes. All OpenMP threads get the same.
+ * @pre kernel_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, if any, and in the MPI versions by all MPI processes.
+ **/
+double multigrid_cycle(double grid[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Reports the difference between temperatures and those the Jacobi solver converges to.
+ * @details Unless config_reference is CONFIG_REFERENCE_NONE, the Jacobi solver is run from the initial temperatures with the same tolerance and maximum number of iterations, and the largest and root mean square differences are printed on the standard error, by the MPI process of rank 0.
+ * @param[in] grid The temperatures to compare.
+ * @pre multigrid_initialise() has been called, and multigrid_finalise() not yet.
+ * @pre It is called outside of any OpenMP parallel region, and in the MPI versions by all MPI processes.
+ **/
+void multigrid_compare(double grid[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Frees the hierarchy of grids.
+ **/
+void multigrid_finalise(void);
+
+#endif
@@ -7,6 +7,7 @@
  **/
 
 #include "util.h"
+#include "progress.h"
 #include <math.h> // fabs
 #include <stdlib.h> // EXIT_SUCCESS
 
@@ -33,6 +34,9 @@ int main(int argc, char *argv[])
 	// Initialise temperatures and temperature_last including boundary conditions
 	initialise_temperatures(temperature, temperature_last);	
 
+	// Buffer the progress, printed once the timer is stopped
+	progress_initialise();
+
 	///////////////////////////////////
 	// -- Code from here is timed -- //
 	///////////////////////////////////
@@ -72,11 +76,12 @@ int main(int argc, char *argv[])
 				}
 			}
 
-			// Periodically print test values
+			// Periodically record test values
 			if((iteration % PRINT_FREQUENCY) == 0)
 			{
-				#pragma acc update host(temperature)
-				track_progress(iteration, temperature);
+				// Only the rows of the tracked cells are copied back from the device
+				#pragma acc update host(temperature[ROWS-TRACKED_CELLS+1:TRACKED_CELLS][0:COLUMNS+2])
+				progress_record(iteration, temperature);
 			}
 		}
 	}
@@ -86,6 +91,9 @@ int main(int argc, char *argv[])
 	/////////////////////////////////////////////
 	stop_timer(&timer_simulation);
 
+	// Print the progress recorded
+	progress_finalise(iteration);
+
 	print_summary(iteration, dt, timer_simulation);
 
 	return EXIT_SUCCESS;
@@ -7,92 +7,316 @@
  **/
 
 #include "util.h"
-#include <math.h> // fabs
+#include "grid.h"
+#include "tiling.h"
+#include "tasking.h"
+#include "front.h"
+#include "kernel.h"
+#include "relaxation.h"
+#include "multigrid.h"
+#include "conjugate.h"
+#include "mixed.h"
+#include "progress.h"
+#include "snapshot.h"
+#include "profile.h"
 #include <stdio.h> // printf
 #include <stdlib.h> // EXIT_SUCCESS
+#include <string.h> // memcpy
 #include <omp.h>
 
 /**
  * @brief Runs the experiment.
- * @pre The macro 'ROWS' contains the number of rows (excluding boundaries). It is a define passed as a compilation flag, see makefile.
- * @pre The macro 'COLUMNS' contains the number of columns (excluding boundaries). It is a define passed as a compilation flag, see makefile.
+ * @details The grid size and the other settings of the run are read from the command line or the environment, see config.h.
  **/
 int main(int argc, char *argv[])
 {
-    // We indicate that we are not going to use argc.
-    (void)argc;
-    // We indicate that we are not going to use argv.
-    (void)argv;
+    // Read the grid size and the other settings of the run
+    config_initialise(argc, argv);
 	// Temperature grid.
-	double temperature[ROWS+2][COLUMNS+2];
-	// Temperature grid from last iteration
-	double temperature_last[ROWS+2][COLUMNS+2]; 
+	double (*temperature)[COLUMNS+2] = grid_allocate(ROWS, COLUMNS);
+	// Temperature grid from last iteration; the red-black, multigrid, conjugate gradient and mixed-precision solvers update the temperature grid in place instead
+	double (*temperature_last)[COLUMNS+2] = CONFIG_IN_PLACE ? temperature : grid_allocate(ROWS, COLUMNS);
+	// Third grid of the Jacobi solver, in which even iterations are written so that a trip through the grid leaves the one it starts from untouched
+	double (*temperature_spare)[COLUMNS+2] = CONFIG_IN_PLACE ? NULL : grid_allocate(ROWS, COLUMNS);
     // Current iteration.
     unsigned int iteration = 0;
     // Largest change in temperature. 
     double dt = 100;
+    // Largest change in temperature of the iteration before the last one, used to pick the tiling depth.
+    double dt_before = dt;
+    // Largest change in temperature of each iteration advanced in one trip through the grid.
+    double dt_trip[TILE_DEPTH];
 
     // Initialise temperatures and temperature_last including boundary conditions
     initialise_temperatures(temperature, temperature_last);  
+    if(!CONFIG_IN_PLACE)
+    {
+        memcpy(temperature_spare, temperature_last, sizeof(double) * (ROWS + 2) * (COLUMNS + 2));
+    }
+
+    // Pick the stencil kernel best suited to this processor
+    kernel_initialise();
+
+    // The Jacobi solver skips the cells the heat has not reached yet
+    if(!CONFIG_IN_PLACE)
+    {
+        front_initialise(temperature_last, iteration);
+    }
+
+    // Grid written during the current iteration; swapped with last at the end of each iteration instead of being copied
+    double (*current)[COLUMNS+2] = temperature;
+    // Grid holding the temperatures of the last iteration
+    double (*last)[COLUMNS+2] = temperature_last;
+    // Grid written during even iterations of a trip through the grid, see tiling.h
+    double (*spare)[COLUMNS+2] = temperature_spare;
+    // Where the loop state ends up once the parallel region is over
+    unsigned int* iteration_reached = &iteration;
+    double* dt_reached = &dt;
+    double (**last_reached)[COLUMNS+2] = &last;
+
+    // Buffer the progress, printed once the timer is stopped
+    progress_initialise();
+
+    // Prepare the snapshots of the temperatures, if asked for
+    snapshot_initialise();
+
+    // Time the phases of the hot loop from here on
+    profile_initialise();
 
     ///////////////////////////////////
     // -- Code from here is timed -- //
     ///////////////////////////////////
     start_timer(&timer_simulation);
 
-    #pragma omp parallel
+    if(config_solver == CONFIG_SOLVER_SOR)
+    {
+        relaxation_initialise();
+    }
+    else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+    {
+        multigrid_initialise();
+    }
+    else if(config_solver == CONFIG_SOLVER_CG)
+    {
+        conjugate_initialise(NULL);
+    }
+    else if(config_precision == CONFIG_PRECISION_MIXED)
+    {
+        mixed_initialise();
+    }
+
+    // A single parallel region runs the whole simulation. Every thread runs the same loop on its own copy of the loop
+    // state, which stays identical across threads since the tiled or task-based engine, or the red-black, multigrid,
+    // conjugate gradient or mixed-precision solver, gives them all the same temperature changes.
+    #pragma omp parallel firstprivate(iteration, dt, dt_before, current, last, spare) private(dt_trip)
     {
         #pragma omp master
         {
 			printf("Application run using %d OpenMP threads.\n", omp_get_num_threads());
         } // End of OpenMP master region
-    } // End of OpenMP parallel region
 
-	// Do until error is under threshold or until max iterations is reached
-	while(dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
-	{
-		iteration++;
+		// Do until error is under threshold or until max iterations is reached
+		while(CONFIG_IN_PLACE && dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
+		{
+			// Main calculation: over-relax the red cells then the black ones, run a V-cycle, run a conjugate gradient
+			// iteration, or sweep the corrections of a mixed-precision iteration, and find the dt
+			if(config_solver == CONFIG_SOLVER_SOR)
+			{
+				dt = relaxation_advance(temperature);
+			}
+			else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+			{
+				dt = multigrid_cycle(temperature);
+			}
+			else if(config_solver == CONFIG_SOLVER_CG)
+			{
+				dt = conjugate_advance(temperature);
+			}
+			else
+			{
+				// The temperatures are needed when progress is printed, when a snapshot is taken and at the last iteration
+				// allowed
+				int needed = ((iteration + 1) % PRINT_FREQUENCY) == 0 || snapshot_due(iteration + 1) || iteration + 1 > MAX_NUMBER_OF_ITERATIONS;
+				dt = mixed_advance(temperature, needed);
+			}
+			progress_log(dt);
+			iteration++;
 
-		// Reset largest temperature change
-		dt = 0.0; 
+			// Periodically record test values, before the next iteration overwrites them
+			if((iteration % PRINT_FREQUENCY) == 0)
+			{
+				#pragma omp master
+				{
+					progress_record(iteration, temperature);
+				} // End of OpenMP master region
+				#pragma omp barrier
+			}
 
-		// Main calculation: average my four neighbors
-		#pragma omp parallel for
-		for(unsigned int i = 1; i <= ROWS; i++)
-		{
-			for(unsigned int j = 1; j <= COLUMNS; j++)
+			// Periodically save a snapshot of the temperatures, before the next iteration overwrites them
+			if(snapshot_due(iteration))
 			{
-				temperature[i][j] = 0.25 * (temperature_last[i+1][j  ] +
-											temperature_last[i-1][j  ] +
-											temperature_last[i  ][j+1] +
-											temperature_last[i  ][j-1]);
+				#pragma omp master
+				{
+					snapshot_write(iteration, temperature, dt);
+				} // End of OpenMP master region
+				#pragma omp barrier
 			}
 		}
 
-		// Copy grid to old grid for next iteration and find latest dt
-		#pragma omp parallel for reduction(max:dt)
-		for(unsigned int i = 1; i <= ROWS; i++)
+        // Each thread keeps the same band of rows, and the same buffers, from one trip to the next; or blocks of rows are
+        // shared out as tasks. The solvers that update the grid in place are done already and need neither.
+        if(!CONFIG_IN_PLACE)
+        {
+            if(config_threading == CONFIG_THREADING_TASKS)
+            {
+                tasking_initialise();
+            }
+            else
+            {
+                tiling_initialise();
+            }
+        }
+
+		// Do until error is under threshold or until max iterations is reached; the other solvers got there already
+		while(dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
 		{
-			for(unsigned int j = 1; j <= COLUMNS; j++)
+			// Number of iterations to advance in this trip through the grid
+			unsigned int depth = tiling_depth(iteration, dt_before, dt);
+
+			// Main calculation: average my four neighbors, iteration after iteration, and find the dt of each
+			if(config_threading == CONFIG_THREADING_TASKS)
 			{
-				dt = fmax(fabs(temperature[i][j]-temperature_last[i][j]), dt);
-				temperature_last[i][j] = temperature[i][j];
+				tasking_advance(last, current, spare, iteration, depth, dt_trip);
+			}
+			else
+			{
+				tiling_advance(last, current, spare, iteration, depth, dt_trip);
 			}
-		}
 
-		// Periodically print test values
-		if((iteration % PRINT_FREQUENCY) == 0)
-		{
-			track_progress(iteration, temperature);
+			// Check convergence after each iteration advanced, as if they had been run one by one
+			unsigned int k = 0;
+			do
+			{
+				iteration++;
+				dt_before = dt;
+				dt = dt_trip[k];
+				progress_log(dt);
+				k++;
+			} while(dt > MAX_TEMP_ERROR && k < depth);
+
+			// Should convergence be reached before the end of the trip, advance again, from the temperatures the trip started
+			// from, up to the iteration at which it is reached. All threads agree on it, having the same temperature changes.
+			if(k < depth)
+			{
+				tiling_rewind(last, current, spare);
+				if(config_threading == CONFIG_THREADING_TASKS)
+				{
+					tasking_advance(last, current, spare, iteration - k, k, dt_trip);
+				}
+				else
+				{
+					tiling_advance(last, current, spare, iteration - k, k, dt_trip);
+				}
+			}
+
+			// The latest iteration is in current if it is odd, in spare otherwise; the grid the trip started from is
+			// written next
+			double (*start)[COLUMNS+2] = last;
+			if(k % 2 == 1)
+			{
+				last = current;
+				current = start;
+			}
+			else
+			{
+				last = spare;
+				spare = start;
+			}
+
+			// Periodically record test values
+			if((iteration % PRINT_FREQUENCY) == 0)
+			{
+				// Other threads may start the next trip meanwhile, but it only reads this grid
+				#pragma omp master
+				{
+					progress_record(iteration, last);
+				} // End of OpenMP master region
+			}
+
+			// Periodically save a snapshot of the temperatures, while the other threads start the next trip like above
+			if(snapshot_due(iteration))
+			{
+				#pragma omp master
+				{
+					snapshot_write(iteration, last, dt);
+				} // End of OpenMP master region
+			}
 		}
-	}
+
+        if(!CONFIG_IN_PLACE)
+        {
+            if(config_threading == CONFIG_THREADING_TASKS)
+            {
+                tasking_finalise();
+            }
+            else
+            {
+                tiling_finalise();
+            }
+        }
+
+        #pragma omp master
+        {
+            *iteration_reached = iteration;
+            *dt_reached = dt;
+            *last_reached = last;
+        } // End of OpenMP master region
+    } // End of OpenMP parallel region
 
     /////////////////////////////////////////////
     // -- Code from here is no longer timed -- //
     /////////////////////////////////////////////
     stop_timer(&timer_simulation);
 
+    // Print the progress recorded
+    progress_finalise(iteration);
+
     print_summary(iteration, dt, timer_simulation);
 
+    // Save a snapshot of the temperatures reached, if asked for, and wait for all snapshots to be written
+    snapshot_finalise(iteration, last, dt);
+
+    // Tell how far the multigrid solution is from that of the Jacobi solver, if asked to
+    if(config_solver == CONFIG_SOLVER_MULTIGRID)
+    {
+        multigrid_compare(temperature);
+        multigrid_finalise();
+    }
+
+    // Write the time spent in each phase, if asked to
+    profile_report(iteration, timer_simulation);
+
+    if(config_solver == CONFIG_SOLVER_SOR)
+    {
+        relaxation_finalise();
+    }
+    else if(config_solver == CONFIG_SOLVER_CG)
+    {
+        conjugate_finalise();
+    }
+    else if(config_precision == CONFIG_PRECISION_MIXED)
+    {
+        mixed_finalise();
+    }
+    grid_free(temperature);
+    if(temperature_last != temperature)
+    {
+        grid_free(temperature_last);
+    }
+    if(temperature_spare != NULL)
+    {
+        grid_free(temperature_spare);
+    }
+
     return EXIT_SUCCESS;
 }
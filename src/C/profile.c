@@ -0,0 +1,256 @@
+/**
+ * @file profile.c
+ **/
+
+// clock_gettime is POSIX, not C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "profile.h"
+#include "config.h"
+#include <stdio.h> // printf, fprintf, fopen, fclose
+#include <stdlib.h> // calloc, free
+#include <string.h> // strlen, strcmp
+#include <time.h> // clock_gettime
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+#endif
+
+/// The number of statistics reduced across MPI processes: the time of each phase per MPI process, then per thread, then the stencil bandwidth.
+#define PROFILE_STATISTICS (2 * PROFILE_PHASE_COUNT + 1)
+/// The number of values summed across MPI processes: the statistics, then the cells updated, the threads and the calls of each phase.
+#define PROFILE_TOTALS (PROFILE_STATISTICS + 2 + PROFILE_PHASE_COUNT)
+
+/// The names of the phases in the report, in the order of profile_phase.
+static const char* profile_phase_names[PROFILE_PHASE_COUNT] = {"stencil", "reduction", "halo", "convergence", "progress", "checkpoint"};
+
+/// The counters of an OpenMP thread.
+typedef struct
+{
+	/// The time spent in each phase, in seconds.
+	double seconds[PROFILE_PHASE_COUNT];
+	/// The number of times each phase was entered.
+	long calls[PROFILE_PHASE_COUNT];
+	/// The number of cells updated.
+	long cells;
+	/// Keeps the counters of two threads on distinct cache lines.
+	double padding[8];
+} profile_counters;
+
+/// The counters of each OpenMP thread, NULL until profile_initialise() is called.
+static profile_counters* profile_threads = NULL;
+/// The number of counters allocated.
+static int profile_thread_count = 0;
+
+void profile_initialise(void)
+{
+	profile_thread_count = 1;
+	#ifdef _OPENMP
+		profile_thread_count = omp_get_max_threads();
+	#endif
+	profile_threads = calloc(profile_thread_count, sizeof(profile_counters));
+	if(profile_threads == NULL)
+	{
+		printf("Failed to allocate the profile counters.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+double profile_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void profile_add(profile_phase phase, double start, long cells)
+{
+	double elapsed = profile_now() - start;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_id = omp_get_thread_num();
+	#endif
+	if(profile_threads == NULL || thread_id >= profile_thread_count)
+	{
+		return;
+	}
+
+	profile_counters* counters = &profile_threads[thread_id];
+	counters->seconds[phase] += elapsed;
+	counters->calls[phase]++;
+	counters->cells += cells;
+}
+
+/**
+ * @brief Writes the report.
+ * @param[in] file The file to write to.
+ * @param[in] json Whether to write JSON rather than CSV.
+ * @param[in] iteration The iteration at which the simulation stopped.
+ * @param[in] total_seconds The time elapsed during the simulation.
+ * @param[in] process_count The number of MPI processes.
+ * @param[in] thread_count The number of OpenMP threads across all MPI processes.
+ * @param[in] cells The number of cells updated across all MPI processes.
+ * @param[in] calls The number of times each phase was entered across all threads.
+ * @param[in] minimum The minimum across MPI processes of the time of each phase, then across threads, then the stencil bandwidth.
+ * @param[in] maximum Same for the maximum.
+ * @param[in] average Same for the average.
+ **/
+static void profile_write(FILE* file, int json, int iteration, double total_seconds, int process_count, int thread_count, double cells, const double calls[PROFILE_PHASE_COUNT], const double minimum[], const double maximum[], const double average[])
+{
+	double effective_bandwidth = total_seconds > 0.0 ? cells * PROFILE_BYTES_PER_CELL / total_seconds / 1e9 : 0.0;
+	int b = 2 * PROFILE_PHASE_COUNT;
+
+	if(json)
+	{
+		fprintf(file, "{\n");
+		fprintf(file, "  \"version\": \"%s\",\n", VERSION_RUN);
+		fprintf(file, "  \"processes\": %d,\n", process_count);
+		fprintf(file, "  \"threads\": %d,\n", thread_count);
+		fprintf(file, "  \"rows\": %d,\n", ROWS_GLOBAL);
+		fprintf(file, "  \"columns\": %d,\n", COLUMNS_GLOBAL);
+		fprintf(file, "  \"iterations\": %d,\n", iteration);
+		fprintf(file, "  \"cells\": %.0f,\n", cells);
+		fprintf(file, "  \"total_seconds\": %.6f,\n", total_seconds);
+		fprintf(file, "  \"phases\": {\n");
+		for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+		{
+			int q = PROFILE_PHASE_COUNT + p;
+			fprintf(file, "    \"%s\": {\"calls\": %.0f, \"process_seconds\": {\"min\": %.6f, \"max\": %.6f, \"avg\": %.6f}, \"thread_seconds\": {\"min\": %.6f, \"max\": %.6f, \"avg\": %.6f}}%s\n",
+			        profile_phase_names[p], calls[p], minimum[p], maximum[p], average[p], minimum[q], maximum[q], average[q], p < PROFILE_PHASE_COUNT - 1 ? "," : "");
+		}
+		fprintf(file, "  },\n");
+		fprintf(file, "  \"stencil_bandwidth_gbs\": {\"min\": %.3f, \"max\": %.3f, \"avg\": %.3f},\n", minimum[b], maximum[b], average[b]);
+		fprintf(file, "  \"effective_bandwidth_gbs\": %.3f\n", effective_bandwidth);
+		fprintf(file, "}\n");
+	}
+	else
+	{
+		// Single values are given as their own minimum, maximum and average
+		fprintf(file, "metric,min,max,avg\n");
+		fprintf(file, "processes,%d,%d,%d\n", process_count, process_count, process_count);
+		fprintf(file, "threads,%d,%d,%d\n", thread_count, thread_count, thread_count);
+		fprintf(file, "iterations,%d,%d,%d\n", iteration, iteration, iteration);
+		fprintf(file, "cells,%.0f,%.0f,%.0f\n", cells, cells, cells);
+		fprintf(file, "total_seconds,%.6f,%.6f,%.6f\n", total_seconds, total_seconds, total_seconds);
+		for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+		{
+			int q = PROFILE_PHASE_COUNT + p;
+			fprintf(file, "%s_calls,%.0f,%.0f,%.0f\n", profile_phase_names[p], calls[p], calls[p], calls[p]);
+			fprintf(file, "%s_process_seconds,%.6f,%.6f,%.6f\n", profile_phase_names[p], minimum[p], maximum[p], average[p]);
+			fprintf(file, "%s_thread_seconds,%.6f,%.6f,%.6f\n", profile_phase_names[p], minimum[q], maximum[q], average[q]);
+		}
+		fprintf(file, "stencil_bandwidth_gbs,%.3f,%.3f,%.3f\n", minimum[b], maximum[b], average[b]);
+		fprintf(file, "effective_bandwidth_gbs,%.3f,%.3f,%.3f\n", effective_bandwidth, effective_bandwidth, effective_bandwidth);
+	}
+}
+
+void profile_report(int iteration, double timer_simulation)
+{
+	// Per phase: the time of my MPI process, that of its slowest thread, then the minimum, maximum and sum across
+	// threads; followed by the stencil bandwidth of my MPI process.
+	double process_seconds[PROFILE_PHASE_COUNT] = {0.0};
+	double thread_minimum[PROFILE_PHASE_COUNT];
+	double thread_maximum[PROFILE_PHASE_COUNT] = {0.0};
+	double thread_sum[PROFILE_PHASE_COUNT] = {0.0};
+	double calls[PROFILE_PHASE_COUNT] = {0.0};
+	double cells = 0.0;
+	int thread_count = 0;
+	for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+	{
+		thread_minimum[p] = 1e300;
+	}
+
+	// Threads that recorded nothing did not take part in the run
+	for(int t = 0; t < profile_thread_count; t++)
+	{
+		profile_counters* counters = &profile_threads[t];
+		long calls_made = 0;
+		for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+		{
+			calls_made += counters->calls[p];
+		}
+		if(calls_made == 0)
+		{
+			continue;
+		}
+		thread_count++;
+		cells += counters->cells;
+		for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+		{
+			double seconds = counters->seconds[p];
+			process_seconds[p] = seconds > process_seconds[p] ? seconds : process_seconds[p];
+			thread_minimum[p] = seconds < thread_minimum[p] ? seconds : thread_minimum[p];
+			thread_maximum[p] = seconds > thread_maximum[p] ? seconds : thread_maximum[p];
+			thread_sum[p] += seconds;
+			calls[p] += counters->calls[p];
+		}
+	}
+	if(thread_count == 0)
+	{
+		for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+		{
+			thread_minimum[p] = 0.0;
+		}
+	}
+	double bandwidth = process_seconds[PROFILE_STENCIL] > 0.0 ? cells * PROFILE_BYTES_PER_CELL / process_seconds[PROFILE_STENCIL] / 1e9 : 0.0;
+
+	// Minimum, maximum and sum across MPI processes
+	double minimum[PROFILE_STATISTICS];
+	double maximum[PROFILE_STATISTICS];
+	double sum[PROFILE_TOTALS];
+	for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+	{
+		minimum[p] = maximum[p] = sum[p] = process_seconds[p];
+		minimum[PROFILE_PHASE_COUNT + p] = thread_minimum[p];
+		maximum[PROFILE_PHASE_COUNT + p] = thread_maximum[p];
+		sum[PROFILE_PHASE_COUNT + p] = thread_sum[p];
+		sum[PROFILE_STATISTICS + 2 + p] = calls[p];
+	}
+	minimum[2 * PROFILE_PHASE_COUNT] = maximum[2 * PROFILE_PHASE_COUNT] = sum[2 * PROFILE_PHASE_COUNT] = bandwidth;
+	sum[PROFILE_STATISTICS] = cells;
+	sum[PROFILE_STATISTICS + 1] = thread_count;
+
+	int my_rank = 0;
+	int process_count = 1;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+		MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+		MPI_Reduce(my_rank == 0 ? MPI_IN_PLACE : minimum, minimum, PROFILE_STATISTICS, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+		MPI_Reduce(my_rank == 0 ? MPI_IN_PLACE : maximum, maximum, PROFILE_STATISTICS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+		MPI_Reduce(my_rank == 0 ? MPI_IN_PLACE : sum, sum, PROFILE_TOTALS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	#endif
+
+	if(my_rank == 0 && config_profile_file != NULL)
+	{
+		int total_threads = (int)sum[PROFILE_STATISTICS + 1];
+		double average[PROFILE_STATISTICS];
+		for(int s = 0; s < PROFILE_STATISTICS; s++)
+		{
+			average[s] = sum[s] / process_count;
+		}
+		for(int p = 0; p < PROFILE_PHASE_COUNT; p++)
+		{
+			average[PROFILE_PHASE_COUNT + p] = total_threads > 0 ? sum[PROFILE_PHASE_COUNT + p] / total_threads : 0.0;
+		}
+
+		const char* path = config_profile_file;
+		size_t length = strlen(path);
+		int json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+		FILE* file = fopen(path, "w");
+		if(file == NULL)
+		{
+			printf("Failed to write the profile to %s.\n", path);
+		}
+		else
+		{
+			profile_write(file, json, iteration, timer_simulation / 1000000.0, process_count, total_threads, sum[PROFILE_STATISTICS], &sum[PROFILE_STATISTICS + 2], minimum, maximum, average);
+			fclose(file);
+		}
+	}
+
+	free(profile_threads);
+	profile_threads = NULL;
+	profile_thread_count = 0;
+}
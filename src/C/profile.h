@@ -0,0 +1,60 @@
+/**
+ * @file profile.h
+ * @brief This file contains the instrumentation of the hot loop.
+ * @details The time spent in each phase of an iteration is accumulated per OpenMP thread, along with the number of cells the stencil updated. Timestamps come from clock_gettime(CLOCK_MONOTONIC), which costs a few tens of nanoseconds, so phases are timed as a whole rather than row by row.
+ *
+ * If config_profile_file is set, profile_report() writes the times gathered across all OpenMP threads and MPI processes to it: in JSON if its name ends with ".json", in CSV otherwise. For each phase, it gives the minimum, maximum and average across MPI processes of the time of each, that of an MPI process being that of its slowest thread, and the same across all threads. It also gives the number of cells the stencil updated across all MPI processes, which leaves out those skipped, see front.h, and the effective bandwidth of the stencil, counting PROFILE_BYTES_PER_CELL bytes of memory traffic per cell updated.
+ **/
+
+#ifndef PROFILE_H_INCLUDED
+#define PROFILE_H_INCLUDED
+
+/// Memory traffic of the stencil per cell updated, in bytes: one temperature read and one written, neighbours hitting the cache.
+#define PROFILE_BYTES_PER_CELL 16
+
+/// The phases timed.
+typedef enum
+{
+	/// The stencil, that is the averaging and the temperature change of the cells.
+	PROFILE_STENCIL,
+	/// Combining the temperature changes of the OpenMP threads, and copying rows between them.
+	PROFILE_REDUCTION,
+	/// Posting and completing the halo swaps.
+	PROFILE_HALO,
+	/// Combining the temperature changes across MPI processes.
+	PROFILE_CONVERGENCE,
+	/// Printing the progress.
+	PROFILE_PROGRESS,
+	/// Writing checkpoints.
+	PROFILE_CHECKPOINT,
+	/// The number of phases.
+	PROFILE_PHASE_COUNT
+} profile_phase;
+
+/**
+ * @brief Allocates the counters of all OpenMP threads.
+ * @details Time spent before is not recorded.
+ * @pre It is called outside of any parallel region.
+ **/
+void profile_initialise(void);
+/**
+ * @brief Gives the current time.
+ * @return The current time in seconds, from an arbitrary origin.
+ **/
+double profile_now(void);
+/**
+ * @brief Accumulates the time spent in a phase by my OpenMP thread.
+ * @param[in] phase The phase.
+ * @param[in] start The time the phase started at, as given by profile_now().
+ * @param[in] cells The number of cells updated during the phase.
+ **/
+void profile_add(profile_phase phase, double start, long cells);
+/**
+ * @brief Writes the report to config_profile_file if it is set, and frees the counters.
+ * @param[in] iteration The iteration at which the simulation stopped.
+ * @param[in] timer_simulation The time elapsed during the simulation, in microseconds; only that of the MPI process of rank 0 is used.
+ * @pre In the MPI versions, it is called by all MPI processes.
+ **/
+void profile_report(int iteration, double timer_simulation);
+
+#endif
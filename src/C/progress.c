@@ -0,0 +1,189 @@
+/**
+ * @file progress.c
+ **/
+
+#include "progress.h"
+#include <stdio.h> // printf, fopen, fwrite, fclose
+#include <stdlib.h> // malloc, realloc, free, exit, EXIT_FAILURE
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+#endif
+
+/// The tag of the messages carrying the progress to the MPI process of rank 0, distinct from those of the halo swaps.
+#define PROGRESS_TAG 8
+
+/// The iterations recorded, in order.
+static int* progress_iterations = NULL;
+/// The tracked cells recorded, TRACKED_CELLS per iteration.
+static double* progress_cells = NULL;
+/// The number of iterations recorded and not printed yet.
+static int progress_count = 0;
+/// The temperature changes logged, NULL if none are.
+static double* progress_dt_log = NULL;
+/// The number of temperature changes logged.
+static int progress_dt_count = 0;
+/// The number of temperature changes the log can hold before it grows.
+static int progress_dt_capacity = 0;
+
+/**
+ * @brief Aborts the program, once the reason is printed.
+ * @param[in] what What failed to be allocated.
+ **/
+static void progress_fail(const char* what)
+{
+	printf("Failed to allocate the %s.\n", what);
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	#else
+		exit(EXIT_FAILURE);
+	#endif
+}
+
+/**
+ * @brief Prints the progress recorded, and empties the buffer.
+ **/
+static void progress_print(void)
+{
+	for(int k = 0; k < progress_count; k++)
+	{
+		print_progress(progress_iterations[k], progress_cells + k * TRACKED_CELLS);
+	}
+	progress_count = 0;
+}
+
+void progress_initialise(void)
+{
+	progress_iterations = malloc(sizeof(int) * PROGRESS_CAPACITY);
+	progress_cells = malloc(sizeof(double) * PROGRESS_CAPACITY * TRACKED_CELLS);
+	if(progress_iterations == NULL || progress_cells == NULL)
+	{
+		progress_fail("progress buffer");
+	}
+	progress_count = 0;
+
+	int my_rank = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+	#endif
+	if(my_rank == 0 && config_dt_log_file != NULL)
+	{
+		// Enough for a run that stops at the maximum number of iterations, it grows otherwise
+		progress_dt_capacity = MAX_NUMBER_OF_ITERATIONS + 1;
+		progress_dt_log = malloc(sizeof(double) * progress_dt_capacity);
+		if(progress_dt_log == NULL)
+		{
+			progress_fail("temperature change log");
+		}
+	}
+	progress_dt_count = 0;
+}
+
+void progress_record(int iteration, double temperature[ROWS+2][COLUMNS+2])
+{
+	double cells[TRACKED_CELLS];
+	for(int i = TRACKED_CELLS; i > 0; i--)
+	{
+		cells[TRACKED_CELLS-i] = temperature[ROWS-i+1][COLUMNS-i+1];
+	}
+	progress_record_cells(iteration, cells);
+}
+
+void progress_record_cells(int iteration, const double cells[TRACKED_CELLS])
+{
+	if(progress_count == PROGRESS_CAPACITY)
+	{
+		progress_print();
+	}
+	progress_iterations[progress_count] = iteration;
+	for(int c = 0; c < TRACKED_CELLS; c++)
+	{
+		progress_cells[progress_count * TRACKED_CELLS + c] = cells[c];
+	}
+	progress_count++;
+}
+
+void progress_log(double dt)
+{
+	if(progress_dt_log == NULL)
+	{
+		return;
+	}
+	#ifdef _OPENMP
+		if(omp_get_thread_num() != 0)
+		{
+			return;
+		}
+	#endif
+
+	if(progress_dt_count == progress_dt_capacity)
+	{
+		progress_dt_capacity *= 2;
+		progress_dt_log = realloc(progress_dt_log, sizeof(double) * progress_dt_capacity);
+		if(progress_dt_log == NULL)
+		{
+			progress_fail("temperature change log");
+		}
+	}
+	progress_dt_log[progress_dt_count] = dt;
+	progress_dt_count++;
+}
+
+void progress_finalise(int iteration)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		// The progress is recorded by the MPI process holding the bottom-right tile, the last one, and printed by that
+		// of rank 0
+		int my_rank;
+		int comm_size;
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+		MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+		int tracking_rank = comm_size - 1;
+		if(tracking_rank != 0)
+		{
+			if(my_rank == tracking_rank)
+			{
+				MPI_Send(&progress_count, 1, MPI_INT, 0, PROGRESS_TAG, MPI_COMM_WORLD);
+				MPI_Send(progress_iterations, progress_count, MPI_INT, 0, PROGRESS_TAG, MPI_COMM_WORLD);
+				MPI_Send(progress_cells, progress_count * TRACKED_CELLS, MPI_DOUBLE, 0, PROGRESS_TAG, MPI_COMM_WORLD);
+				progress_count = 0;
+			}
+			else if(my_rank == 0)
+			{
+				MPI_Recv(&progress_count, 1, MPI_INT, tracking_rank, PROGRESS_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+				MPI_Recv(progress_iterations, progress_count, MPI_INT, tracking_rank, PROGRESS_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+				MPI_Recv(progress_cells, progress_count * TRACKED_CELLS, MPI_DOUBLE, tracking_rank, PROGRESS_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			}
+		}
+	#endif
+	progress_print();
+
+	if(progress_dt_log != NULL)
+	{
+		const char* path = config_dt_log_file;
+		FILE* file = fopen(path, "wb");
+		int header[2] = {iteration - progress_dt_count + 1, progress_dt_count};
+		if(file == NULL ||
+		   fwrite(PROGRESS_DT_LOG_MAGIC, 1, 8, file) != 8 ||
+		   fwrite(header, sizeof(int), 2, file) != 2 ||
+		   fwrite(progress_dt_log, sizeof(double), progress_dt_count, file) != (size_t)progress_dt_count)
+		{
+			printf("Failed to write the temperature change log to %s.\n", path);
+		}
+		if(file != NULL)
+		{
+			fclose(file);
+		}
+	}
+
+	free(progress_iterations);
+	free(progress_cells);
+	free(progress_dt_log);
+	progress_iterations = NULL;
+	progress_cells = NULL;
+	progress_dt_log = NULL;
+	progress_count = 0;
+	progress_dt_count = 0;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file progress.h
+ * @brief This file contains the deferred printing of the progress, and the log of the temperature changes.
+ * @details Printing the progress in the hot loop formats and writes a line of text, which may block on the terminal or the file the output is redirected to, and in the OpenACC versions used to copy the whole grid back from the device. Instead, only the TRACKED_CELLS tracked cells are copied, along with the iteration, into a buffer of PROGRESS_CAPACITY entries, and printed with print_progress() once the timer is stopped, before the summary, so that the output is byte for byte that of printing them on the spot. Should the buffer fill up, which takes more than PROGRESS_CAPACITY printings, it is printed on the spot and emptied. In the MPI versions, the MPI process holding the bottom-right tile records the progress and sends it to the MPI process of rank 0, which prints it right before the summary, so that all of it comes out of a single process in order. The time spent printing is still counted in the progress phase of the profile report, see profile.h.
+ *
+ * If config_dt_log_file is set, the temperature change of every iteration is kept as well, and written to it at the end of the run in binary, in the byte order of the machine that wrote it:
+ * | Content | Type |
+ * | ------- | ---- |
+ * | PROGRESS_DT_LOG_MAGIC | 8 chars |
+ * | first iteration logged, number of iterations logged | 2 ints |
+ * | the temperature change of each iteration logged, across all MPI processes | doubles |
+ * Iterations are logged from the first one run, which is not 1 when the run resumed from a checkpoint, to that at which the simulation stopped. In the MPI versions, the MPI process of rank 0 keeps and writes the log; in all versions, only the temperature changes given by the master thread are kept.
+ **/
+
+#ifndef PROGRESS_H_INCLUDED
+#define PROGRESS_H_INCLUDED
+
+#include "util.h" // ROWS, COLUMNS, TRACKED_CELLS
+
+#ifndef PROGRESS_CAPACITY
+	/// Maximum number of progress printings buffered. It can be overriden at compilation.
+	#define PROGRESS_CAPACITY 256
+#endif
+
+/// The first bytes of a temperature change log.
+#define PROGRESS_DT_LOG_MAGIC "LAPLACEL"
+
+/**
+ * @brief Allocates the progress buffer and, if config_dt_log_file is set, the temperature change log.
+ * @pre It is called before the first call to any other function of this file, outside of any OpenMP parallel region.
+ **/
+void progress_initialise(void);
+/**
+ * @brief Records the tracked cells of an iteration, to be printed by progress_finalise().
+ * @param[in] iteration The iteration at which printing progress.
+ * @param[in] temperature The temperatures of that iteration; only the tracked cells are read.
+ * @pre In the MPI versions, \p temperature is the bottom-right tile of the grid.
+ **/
+void progress_record(int iteration, double temperature[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Records the tracked cells of an iteration, given their temperatures, to be printed by progress_finalise().
+ * @param[in] iteration The iteration at which printing progress.
+ * @param[in] cells The temperatures of the TRACKED_CELLS cells, from the top-left one to the bottom-right corner.
+ **/
+void progress_record_cells(int iteration, const double cells[TRACKED_CELLS]);
+/**
+ * @brief Logs the temperature change of the next iteration, if config_dt_log_file is set.
+ * @details Calls made by other threads than the master one, and in the MPI versions by other MPI processes than that of rank 0, are ignored.
+ * @param[in] dt The temperature change of the iteration, across all MPI processes.
+ **/
+void progress_log(double dt);
+/**
+ * @brief Prints the progress recorded, writes the temperature change log if any, and frees what progress_initialise() allocated.
+ * @param[in] iteration The iteration at which the simulation stopped, which is the last one logged.
+ * @pre It is called once the timer is stopped, before print_summary(), outside of any OpenMP parallel region and, in the MPI versions, by all MPI processes.
+ **/
+void progress_finalise(int iteration);
+
+#endif
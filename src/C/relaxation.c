@@ -0,0 +1,226 @@
+/**
+ * @file relaxation.c
+ **/
+
+#include "relaxation.h"
+#include "util.h"
+#include "kernel.h"
+#include "profile.h"
+#include <math.h> // acos, cos, sqrt, fmax
+#include <stdio.h> // printf, fprintf
+#include <stdlib.h> // malloc, free, exit, EXIT_FAILURE
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+	#include "decomposition.h"
+	#include "halo.h"
+#endif
+
+/// Distance between the temperature change slots of two OpenMP threads, in doubles, so that each fills its own cache line.
+#define RELAXATION_SLOT_STRIDE 8
+
+double relaxation_omega = 1.0;
+/// The colour of cell [0][0] of my grid: 0 if red, 1 if black.
+static int relaxation_parity = 0;
+/// The maximal temperature change found by each OpenMP thread, in two sets used by turns.
+static double* relaxation_slots = NULL;
+#ifdef VERSION_RUN_IS_MPI
+	/// The temperature change across all MPI processes found by the master thread, in two sets used by turns.
+	static double relaxation_dt_global[2];
+#endif
+/// The number of iterations run so far by my OpenMP thread, which tells the set of slots to use.
+static unsigned int relaxation_round = 0;
+#pragma omp threadprivate(relaxation_round)
+
+/**
+ * @brief Updates the cells of a colour in a rectangle of the grid.
+ * @param[inout] grid The grid to update.
+ * @param[in] colour 0 for the red cells, 1 for the black ones.
+ * @param[in] row_first The first row of the rectangle.
+ * @param[in] row_last The last row of the rectangle.
+ * @param[in] column_first The first column of the rectangle.
+ * @param[in] column_last The last column of the rectangle.
+ * @return The maximal temperature change across the cells updated.
+ **/
+static double relaxation_sweep(double grid[ROWS+2][COLUMNS+2], int colour, int row_first, int row_last, int column_first, int column_last)
+{
+	double dt = 0.0;
+	for(int i = row_first; i <= row_last; i++)
+	{
+		// The first cell of the colour in this row, the others being every other cell from there
+		int first = column_first + (relaxation_parity + i + column_first + colour) % 2;
+		if(first <= column_last)
+		{
+			dt = fmax(kernel_relax(grid[i], grid[i-1], grid[i+1], first, column_last, relaxation_omega), dt);
+		}
+	}
+	return dt;
+}
+
+void relaxation_initialise(void)
+{
+	int my_rank = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+		relaxation_parity = (decomposition_offsets[0] + decomposition_offsets[1]) % 2;
+	#endif
+
+	if(config_omega > 0.0)
+	{
+		relaxation_omega = config_omega;
+	}
+	else
+	{
+		// Optimal factor for the Laplace equation on a rectangle, from the spectral radius of the Jacobi iteration
+		double pi = acos(-1.0);
+		double rho = 0.5 * (cos(pi / (ROWS_GLOBAL + 1)) + cos(pi / (COLUMNS_GLOBAL + 1)));
+		relaxation_omega = 2.0 / (1.0 + sqrt(1.0 - rho * rho));
+	}
+	if(my_rank == 0)
+	{
+		fprintf(stderr, "Red-black successive over-relaxation with a relaxation factor of %.6f.\n", relaxation_omega);
+	}
+
+	int thread_count = 1;
+	#ifdef _OPENMP
+		thread_count = omp_get_max_threads();
+	#endif
+	relaxation_slots = malloc(sizeof(double) * 2 * thread_count * RELAXATION_SLOT_STRIDE);
+	if(relaxation_slots == NULL)
+	{
+		printf("Failed to allocate the relaxation buffers.\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+double relaxation_advance(double grid[ROWS+2][COLUMNS+2])
+{
+	int thread_count = 1;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_count = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+	#endif
+	int set = relaxation_round % 2;
+	double* slots = relaxation_slots + set * thread_count * RELAXATION_SLOT_STRIDE;
+	relaxation_round++;
+
+	double dt = 0.0;
+	double profile_start;
+	#ifdef VERSION_RUN_IS_MPI
+		// The first and last rows and columns are left to the master thread, the other cells are shared out
+		int row_first = 2;
+		int row_last = ROWS - 1;
+		int column_first = 2;
+		int column_last = COLUMNS - 1;
+
+		for(int colour = 0; colour < 2; colour++)
+		{
+			// The first and last rows and columns go first, so that they are sent to the neighbours while the other
+			// cells are updated
+			#pragma omp master
+			{
+				profile_start = profile_now();
+				dt = fmax(relaxation_sweep(grid, colour, 1, 1, 1, COLUMNS), dt);
+				dt = fmax(relaxation_sweep(grid, colour, ROWS, ROWS, 1, COLUMNS), dt);
+				dt = fmax(relaxation_sweep(grid, colour, 2, ROWS - 1, 1, 1), dt);
+				dt = fmax(relaxation_sweep(grid, colour, 2, ROWS - 1, COLUMNS, COLUMNS), dt);
+				profile_add(PROFILE_STENCIL, profile_start, (2L * (ROWS + COLUMNS) - 4) / 2);
+
+				halo_start(grid, NULL);
+			} // End of OpenMP master region
+
+			profile_start = profile_now();
+			long rows_updated = 0;
+			#pragma omp for schedule(static) nowait
+			for(int i = row_first; i <= row_last; i++)
+			{
+				dt = fmax(relaxation_sweep(grid, colour, i, i, column_first, column_last), dt);
+				rows_updated++;
+			}
+			profile_add(PROFILE_STENCIL, profile_start, rows_updated * (column_last - column_first + 1) / 2);
+
+			#pragma omp master
+			{
+				halo_finish();
+			} // End of OpenMP master region
+
+			// The other colour needs the cells, and halos, just updated by the other threads. After the last colour,
+			// the same barrier publishes the temperature change of each thread.
+			if(colour == 1)
+			{
+				slots[thread_id * RELAXATION_SLOT_STRIDE] = dt;
+			}
+			#pragma omp barrier
+		}
+	#else
+		// Band of rows owned, identical to that of a schedule(static) loop over rows 1 to ROWS
+		int rows_per_thread = ROWS / thread_count;
+		int rows_remaining = ROWS % thread_count;
+		int lo = 1 + thread_id * rows_per_thread + (thread_id < rows_remaining ? thread_id : rows_remaining);
+		int hi = lo + rows_per_thread - 1 + (thread_id < rows_remaining ? 1 : 0);
+
+		// Both colours in a single pass through the band: the black cells of a row are updated as soon as the red
+		// cells of the rows around it are, while still in cache. Those of the first and last rows need the red cells of
+		// the neighbouring bands, they wait for the other threads.
+		profile_start = profile_now();
+		long rows_updated = 0;
+		for(int i = lo; i <= hi; i++)
+		{
+			dt = fmax(relaxation_sweep(grid, 0, i, i, 1, COLUMNS), dt);
+			rows_updated++;
+			if(i - 1 > lo)
+			{
+				dt = fmax(relaxation_sweep(grid, 1, i - 1, i - 1, 1, COLUMNS), dt);
+				rows_updated++;
+			}
+		}
+		profile_add(PROFILE_STENCIL, profile_start, rows_updated * COLUMNS / 2);
+
+		#pragma omp barrier
+
+		profile_start = profile_now();
+		rows_updated = 0;
+		for(int i = lo; i <= hi; i += (hi > lo ? hi - lo : 1))
+		{
+			dt = fmax(relaxation_sweep(grid, 1, i, i, 1, COLUMNS), dt);
+			rows_updated++;
+		}
+		profile_add(PROFILE_STENCIL, profile_start, rows_updated * COLUMNS / 2);
+
+		// The next iteration needs the black cells just updated by the other threads, and the same barrier publishes
+		// the temperature change of each thread
+		slots[thread_id * RELAXATION_SLOT_STRIDE] = dt;
+		#pragma omp barrier
+	#endif
+
+	// Slots alternate between two sets from one iteration to the next, so that a thread can fill a slot of the next
+	// iteration while the others still read those of this one
+	profile_start = profile_now();
+	for(int t = 0; t < thread_count; t++)
+	{
+		dt = fmax(slots[t * RELAXATION_SLOT_STRIDE], dt);
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+
+	#ifdef VERSION_RUN_IS_MPI
+		#pragma omp master
+		{
+			profile_start = profile_now();
+			MPI_Allreduce(&dt, &relaxation_dt_global[set], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+			profile_add(PROFILE_CONVERGENCE, profile_start, 0);
+		} // End of OpenMP master region
+		#pragma omp barrier
+		dt = relaxation_dt_global[set];
+	#endif
+
+	return dt;
+}
+
+void relaxation_finalise(void)
+{
+	free(relaxation_slots);
+	relaxation_slots = NULL;
+}
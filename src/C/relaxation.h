@@ -0,0 +1,38 @@
+/**
+ * @file relaxation.h
+ * @brief This file contains the red-black successive over-relaxation solver of the CPU versions.
+ * @details Cells are coloured like a chessboard, red where the global row and column sum to an even number, black elsewhere. An iteration updates all red cells, whose neighbours are all black, then all black cells from the red ones just updated, in place in a single grid. Each cell is moved by the relaxation factor times the difference between the average of its four neighbours and itself: a factor of 1 gives Gauss-Seidel, factors between 1 and 2 over-relax it. The factor is given with '--omega' or, failing that, the optimal one for the Laplace equation on the whole grid is used.
+ *
+ * The temperature change of an iteration is the largest change of a cell across both colours, compared with the tolerance like that of the Jacobi solver, so that both solvers can be compared by the number of iterations and the time they need to converge. Results differ from those of the Jacobi solver.
+ *
+ * OpenMP threads share the rows of each colour out statically and wait for each other between colours. In the MPI versions, the master thread updates the first and last rows and columns of a colour first and starts a halo swap, see halo.h, which completes while the other cells of that colour are updated: two swaps per iteration. The temperature changes are then combined across all MPI processes at every iteration, the grid being updated in place leaving no room to replay the iterations run past convergence.
+ **/
+
+#ifndef RELAXATION_H_INCLUDED
+#define RELAXATION_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// The relaxation factor used, set by relaxation_initialise().
+extern double relaxation_omega;
+
+/**
+ * @brief Picks the relaxation factor and allocates the buffers of the solver.
+ * @pre In the MPI versions, decomposition_initialise() has been called.
+ * @pre It is called outside of any OpenMP parallel region.
+ **/
+void relaxation_initialise(void);
+/**
+ * @brief Runs one iteration, both colours, in place.
+ * @param[inout] grid The grid to update. In the MPI versions, it must be one of the grids allocated by halo_initialise(), and its halos must be up to date.
+ * @return The maximal temperature change of the iteration; in the MPI versions, across all MPI processes. All OpenMP threads get the same.
+ * @pre kernel_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, if any.
+ **/
+double relaxation_advance(double grid[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Frees the buffers allocated by relaxation_initialise().
+ **/
+void relaxation_finalise(void);
+
+#endif
@@ -7,72 +7,213 @@
  **/
 
 #include "util.h"
-#include <math.h> // fabs
+#include "grid.h"
+#include "tiling.h"
+#include "front.h"
+#include "kernel.h"
+#include "relaxation.h"
+#include "multigrid.h"
+#include "conjugate.h"
+#include "mixed.h"
+#include "progress.h"
+#include "snapshot.h"
+#include "profile.h"
 #include <stdlib.h> // EXIT_SUCCESS
+#include <string.h> // memcpy
 
 /**
  * @brief Runs the experiment.
- * @pre The macro 'ROWS' contains the number of rows (excluding boundaries). It is a define passed as a compilation flag, see makefile.
- * @pre The macro 'COLUMNS' contains the number of columns (excluding boundaries). It is a define passed as a compilation flag, see makefile.
+ * @details The grid size and the other settings of the run are read from the command line or the environment, see config.h.
  **/
 int main(int argc, char *argv[])
 {
-	// We indicate that we are not going to use argc.
-	(void)argc;
-	// We indicate that we are not going to use argv.
-	(void)argv;
+	// Read the grid size and the other settings of the run
+	config_initialise(argc, argv);
 	// Temperature grid.
-	double temperature[ROWS+2][COLUMNS+2];
-	// Temperature grid from last iteration
-	double temperature_last[ROWS+2][COLUMNS+2]; 
+	double (*temperature)[COLUMNS+2] = grid_allocate(ROWS, COLUMNS);
+	// Temperature grid from last iteration; the red-black, multigrid, conjugate gradient and mixed-precision solvers update the temperature grid in place instead
+	double (*temperature_last)[COLUMNS+2] = CONFIG_IN_PLACE ? temperature : grid_allocate(ROWS, COLUMNS);
+	// Third grid of the Jacobi solver, in which even iterations are written so that a trip through the grid leaves the one it starts from untouched
+	double (*temperature_spare)[COLUMNS+2] = CONFIG_IN_PLACE ? NULL : grid_allocate(ROWS, COLUMNS);
 	// Current iteration.
 	unsigned int iteration = 0;
 	// Largest change in temperature. 
 	double dt = 100;
+	// Largest change in temperature of the iteration before the last one, used to pick the tiling depth.
+	double dt_before = dt;
+	// Largest change in temperature of each iteration advanced in one trip through the grid.
+	double dt_trip[TILE_DEPTH];
 
 	// Initialise temperatures and temperature_last including boundary conditions
 	initialise_temperatures(temperature, temperature_last);	
+	if(!CONFIG_IN_PLACE)
+	{
+		memcpy(temperature_spare, temperature_last, sizeof(double) * (ROWS + 2) * (COLUMNS + 2));
+	}
+
+	// Pick the stencil kernel best suited to this processor
+	kernel_initialise();
+
+	// The Jacobi solver skips the cells the heat has not reached yet
+	if(!CONFIG_IN_PLACE)
+	{
+		front_initialise(temperature_last, iteration);
+	}
+
+	// Grid written during the current iteration; swapped with last at the end of each iteration instead of being copied
+	double (*current)[COLUMNS+2] = temperature;
+	// Grid holding the temperatures of the last iteration
+	double (*last)[COLUMNS+2] = temperature_last;
+	// Grid written during even iterations of a trip through the grid, see tiling.h
+	double (*spare)[COLUMNS+2] = temperature_spare;
+
+	// Buffer the progress, printed once the timer is stopped
+	progress_initialise();
+
+	// Prepare the snapshots of the temperatures, if asked for
+	snapshot_initialise();
+
+	// Time the phases of the hot loop from here on
+	profile_initialise();
 
 	///////////////////////////////////
 	// -- Code from here is timed -- //
 	///////////////////////////////////
 	start_timer(&timer_simulation);
 
-	// Do until error is under threshold or until max iterations is reached
-	while(dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
+	if(CONFIG_IN_PLACE)
 	{
-		iteration++;
-
-		// Reset largest temperature change
-		dt = 0.0; 
+		if(config_solver == CONFIG_SOLVER_SOR)
+		{
+			relaxation_initialise();
+		}
+		else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+		{
+			multigrid_initialise();
+		}
+		else if(config_solver == CONFIG_SOLVER_CG)
+		{
+			conjugate_initialise(NULL);
+		}
+		else
+		{
+			mixed_initialise();
+		}
 
-		// Main calculation: average my four neighbors
-		for(unsigned int i = 1; i <= ROWS; i++)
+		// Do until error is under threshold or until max iterations is reached
+		while(dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
 		{
-			for(unsigned int j = 1; j <= COLUMNS; j++)
+			// Main calculation: over-relax the red cells then the black ones, run a V-cycle, run a conjugate gradient
+			// iteration, or sweep the corrections of a mixed-precision iteration, and find the dt
+			if(config_solver == CONFIG_SOLVER_SOR)
 			{
-				temperature[i][j] = 0.25 * (temperature_last[i+1][j  ] +
-											temperature_last[i-1][j  ] +
-											temperature_last[i  ][j+1] +
-											temperature_last[i  ][j-1]);
+				dt = relaxation_advance(temperature);
 			}
-		}
+			else if(config_solver == CONFIG_SOLVER_MULTIGRID)
+			{
+				dt = multigrid_cycle(temperature);
+			}
+			else if(config_solver == CONFIG_SOLVER_CG)
+			{
+				dt = conjugate_advance(temperature);
+			}
+			else
+			{
+				// The temperatures are needed when progress is printed, when a snapshot is taken and at the last iteration
+				// allowed
+				int needed = ((iteration + 1) % PRINT_FREQUENCY) == 0 || snapshot_due(iteration + 1) || iteration + 1 > MAX_NUMBER_OF_ITERATIONS;
+				dt = mixed_advance(temperature, needed);
+			}
+			progress_log(dt);
+			iteration++;
 
-		// Copy grid to old grid for next iteration and find latest dt
-		for(unsigned int i = 1; i <= ROWS; i++)
-		{
-			for(unsigned int j = 1; j <= COLUMNS; j++)
+			// Periodically record test values
+			if((iteration % PRINT_FREQUENCY) == 0)
+			{
+				progress_record(iteration, temperature);
+			}
+
+			// Periodically save a snapshot of the temperatures
+			if(snapshot_due(iteration))
 			{
-				dt = fmax(fabs(temperature[i][j]-temperature_last[i][j]), dt);
-				temperature_last[i][j] = temperature[i][j];
+				snapshot_write(iteration, temperature, dt);
 			}
 		}
 
-		// Periodically print test values
-		if((iteration % PRINT_FREQUENCY) == 0)
+		if(config_solver == CONFIG_SOLVER_SOR)
+		{
+			relaxation_finalise();
+		}
+		else if(config_solver == CONFIG_SOLVER_CG)
+		{
+			conjugate_finalise();
+		}
+		else if(config_precision == CONFIG_PRECISION_MIXED)
+		{
+			mixed_finalise();
+		}
+	}
+	else
+	{
+		// Prepare the buffers of the tiling engine
+		tiling_initialise();
+
+		// Do until error is under threshold or until max iterations is reached
+		while(dt > MAX_TEMP_ERROR && iteration <= MAX_NUMBER_OF_ITERATIONS)
 		{
- 			track_progress(iteration, temperature);
+			// Number of iterations to advance in this trip through the grid
+			unsigned int depth = tiling_depth(iteration, dt_before, dt);
+
+			// Main calculation: average my four neighbors, iteration after iteration, and find the dt of each
+			tiling_advance(last, current, spare, iteration, depth, dt_trip);
+
+			// Check convergence after each iteration advanced, as if they had been run one by one
+			unsigned int k = 0;
+			do
+			{
+				iteration++;
+				dt_before = dt;
+				dt = dt_trip[k];
+				progress_log(dt);
+				k++;
+			} while(dt > MAX_TEMP_ERROR && k < depth);
+
+			// Should convergence be reached before the end of the trip, advance again, from the temperatures the trip started
+			// from, up to the iteration at which it is reached
+			if(k < depth)
+			{
+				tiling_rewind(last, current, spare);
+				tiling_advance(last, current, spare, iteration - k, k, dt_trip);
+			}
+
+			// The latest iteration is in current if it is odd, in spare otherwise; the grid the trip started from is
+			// written next
+			double (*start)[COLUMNS+2] = last;
+			if(k % 2 == 1)
+			{
+				last = current;
+				current = start;
+			}
+			else
+			{
+				last = spare;
+				spare = start;
+			}
+
+			// Periodically record test values
+			if((iteration % PRINT_FREQUENCY) == 0)
+			{
+				progress_record(iteration, last);
+			}
+
+			// Periodically save a snapshot of the temperatures
+			if(snapshot_due(iteration))
+			{
+				snapshot_write(iteration, last, dt);
+			}
 		}
+
+		tiling_finalise();
 	}
 
 	/////////////////////////////////////////////
@@ -80,7 +221,33 @@ int main(int argc, char *argv[])
 	/////////////////////////////////////////////
 	stop_timer(&timer_simulation);
 
+	// Print the progress recorded
+	progress_finalise(iteration);
+
 	print_summary(iteration, dt, timer_simulation);
 
+	// Save a snapshot of the temperatures reached, if asked for, and wait for all snapshots to be written
+	snapshot_finalise(iteration, last, dt);
+
+	// Tell how far the multigrid solution is from that of the Jacobi solver, if asked to
+	if(config_solver == CONFIG_SOLVER_MULTIGRID)
+	{
+		multigrid_compare(temperature);
+		multigrid_finalise();
+	}
+
+	// Write the time spent in each phase, if asked to
+	profile_report(iteration, timer_simulation);
+
+	grid_free(temperature);
+	if(temperature_last != temperature)
+	{
+		grid_free(temperature_last);
+	}
+	if(temperature_spare != NULL)
+	{
+		grid_free(temperature_spare);
+	}
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,261 @@
+/**
+ * @file snapshot.c
+ **/
+
+// mmap, ftruncate and the file descriptors are POSIX, not C99
+#define _POSIX_C_SOURCE 200112L
+
+#include "snapshot.h"
+#include "util.h"
+#include <stdio.h> // printf, fprintf, snprintf
+#include <stdlib.h> // malloc, free, exit, EXIT_FAILURE
+#include <string.h> // memcpy
+#ifdef VERSION_RUN_IS_MPI
+	#include <mpi.h> // MPI_*
+	#include "decomposition.h"
+#else
+	#include <fcntl.h> // open, O_*
+	#include <sys/mman.h> // mmap, msync, munmap
+	#include <unistd.h> // ftruncate, close
+#endif
+
+/// The fixed part of a snapshot, see snapshot.h.
+typedef struct
+{
+	/// SNAPSHOT_MAGIC, without its terminating null character.
+	char magic[8];
+	/// The number of rows (excluding boundaries) of the grid.
+	int rows_global;
+	/// The number of columns (excluding boundaries) of the grid.
+	int columns_global;
+	/// The iteration completed.
+	int iteration;
+	/// Keeps the temperature change aligned, always 0.
+	int reserved;
+	/// The temperature change across all MPI processes at that iteration.
+	double dt;
+} snapshot_header;
+
+/// A snapshot being written, in one of the two stages used by turns.
+typedef struct
+{
+	#ifdef VERSION_RUN_IS_MPI
+		/// The copy of my tile being written.
+		double* buffer;
+		/// The file written, MPI_FILE_NULL if the stage is free.
+		MPI_File file;
+		/// The request of the write.
+		MPI_Request request;
+	#else
+		/// The file mapped in memory, NULL if the stage is free.
+		void* mapping;
+		/// The size of the mapping, in bytes.
+		size_t size;
+	#endif
+} snapshot_stage;
+
+/// The two stages.
+static snapshot_stage snapshot_stages[2];
+/// The number of snapshots written so far, which tells the stage to use next.
+static int snapshot_count = 0;
+/// The iteration of the last snapshot written, -1 if none.
+static int snapshot_last_iteration = -1;
+#ifdef VERSION_RUN_IS_MPI
+	/// My tile within the temperatures of a snapshot.
+	static MPI_Datatype snapshot_file_tile = MPI_DATATYPE_NULL;
+#endif
+
+/**
+ * @brief Aborts the program, once the reason is printed.
+ * @param[in] what What was being done, for the error message.
+ * @param[in] path The file concerned.
+ **/
+static void snapshot_fail(const char* what, const char* path)
+{
+	printf("Failed to %s snapshot %s.\n", what, path);
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	#else
+		exit(EXIT_FAILURE);
+	#endif
+}
+
+#ifdef VERSION_RUN_IS_MPI
+/**
+ * @brief Aborts the program if an MPI-IO call failed, since file errors are returned rather than fatal by default.
+ * @param[in] error The error code returned.
+ * @param[in] what What was being done, for the error message.
+ * @param[in] path The file concerned.
+ **/
+static void snapshot_check(int error, const char* what, const char* path)
+{
+	if(error != MPI_SUCCESS)
+	{
+		snapshot_fail(what, path);
+	}
+}
+#endif
+
+/**
+ * @brief Completes the snapshot written through a stage, if any, and frees the stage.
+ * @param[inout] stage The stage.
+ **/
+static void snapshot_retire(snapshot_stage* stage)
+{
+	#ifdef VERSION_RUN_IS_MPI
+		if(stage->file != MPI_FILE_NULL)
+		{
+			MPI_Wait(&stage->request, MPI_STATUS_IGNORE);
+			MPI_File_close(&stage->file);
+		}
+	#else
+		// The pages are written back by the operating system whether mapped or not
+		if(stage->mapping != NULL)
+		{
+			munmap(stage->mapping, stage->size);
+			stage->mapping = NULL;
+		}
+	#endif
+}
+
+void snapshot_initialise(void)
+{
+	snapshot_count = 0;
+	snapshot_last_iteration = -1;
+	for(int s = 0; s < 2; s++)
+	{
+		#ifdef VERSION_RUN_IS_MPI
+			snapshot_stages[s].buffer = NULL;
+			snapshot_stages[s].file = MPI_FILE_NULL;
+			snapshot_stages[s].request = MPI_REQUEST_NULL;
+		#else
+			snapshot_stages[s].mapping = NULL;
+			snapshot_stages[s].size = 0;
+		#endif
+	}
+	if(config_snapshot_frequency == 0)
+	{
+		return;
+	}
+
+	#ifdef VERSION_RUN_IS_MPI
+		for(int s = 0; s < 2; s++)
+		{
+			snapshot_stages[s].buffer = malloc(sizeof(double) * ROWS * COLUMNS);
+			if(snapshot_stages[s].buffer == NULL)
+			{
+				snapshot_fail("allocate the buffers of", config_snapshot_file);
+			}
+		}
+
+		int file_sizes[2] = {ROWS_GLOBAL, COLUMNS_GLOBAL};
+		int tile_sizes[2] = {ROWS, COLUMNS};
+		MPI_Type_create_subarray(2, file_sizes, tile_sizes, decomposition_offsets, MPI_ORDER_C, MPI_DOUBLE, &snapshot_file_tile);
+		MPI_Type_commit(&snapshot_file_tile);
+	#endif
+}
+
+int snapshot_due(int iteration)
+{
+	return config_snapshot_frequency > 0 && iteration % config_snapshot_frequency == 0;
+}
+
+void snapshot_write(int iteration, double temperature[ROWS+2][COLUMNS+2], double dt)
+{
+	snapshot_stage* stage = &snapshot_stages[snapshot_count % 2];
+	snapshot_retire(stage);
+
+	// The file of the snapshot is named after its iteration
+	char path[4096];
+	if(snprintf(path, sizeof(path), "%s.%d", config_snapshot_file, iteration) >= (int)sizeof(path))
+	{
+		snapshot_fail("name", config_snapshot_file);
+	}
+
+	snapshot_header header;
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.rows_global = ROWS_GLOBAL;
+	header.columns_global = COLUMNS_GLOBAL;
+	header.iteration = iteration;
+	header.reserved = 0;
+	header.dt = dt;
+
+	#ifdef VERSION_RUN_IS_MPI
+		int my_rank;
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+		// The buffer is left untouched until the write completes, the temperatures may change meanwhile
+		for(int i = 1; i <= ROWS; i++)
+		{
+			memcpy(stage->buffer + (size_t)(i - 1) * COLUMNS, &temperature[i][1], sizeof(double) * COLUMNS);
+		}
+
+		snapshot_check(MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &stage->file), "create", path);
+		snapshot_check(MPI_File_set_size(stage->file, SNAPSHOT_HEADER_SIZE + (MPI_Offset)ROWS_GLOBAL * COLUMNS_GLOBAL * sizeof(double)), "size", path);
+		if(my_rank == 0)
+		{
+			snapshot_check(MPI_File_write_at(stage->file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE), "write", path);
+		}
+		snapshot_check(MPI_File_set_view(stage->file, SNAPSHOT_HEADER_SIZE, MPI_DOUBLE, snapshot_file_tile, "native", MPI_INFO_NULL), "write", path);
+		snapshot_check(MPI_File_iwrite_all(stage->file, stage->buffer, ROWS * COLUMNS, MPI_DOUBLE, &stage->request), "write", path);
+	#else
+		stage->size = SNAPSHOT_HEADER_SIZE + sizeof(double) * ROWS * COLUMNS;
+		int descriptor = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if(descriptor < 0 || ftruncate(descriptor, stage->size) != 0)
+		{
+			snapshot_fail("create", path);
+		}
+		stage->mapping = mmap(NULL, stage->size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+		close(descriptor);
+		if(stage->mapping == MAP_FAILED)
+		{
+			stage->mapping = NULL;
+			snapshot_fail("map", path);
+		}
+
+		memcpy(stage->mapping, &header, sizeof(header));
+		double* field = (double*)((char*)stage->mapping + SNAPSHOT_HEADER_SIZE);
+		for(int i = 1; i <= ROWS; i++)
+		{
+			memcpy(field + (size_t)(i - 1) * COLUMNS, &temperature[i][1], sizeof(double) * COLUMNS);
+		}
+
+		// Start writing the pages back without waiting for them
+		msync(stage->mapping, stage->size, MS_ASYNC);
+	#endif
+
+	snapshot_count++;
+	snapshot_last_iteration = iteration;
+}
+
+void snapshot_finalise(int iteration, double temperature[ROWS+2][COLUMNS+2], double dt)
+{
+	if(config_snapshot_frequency == 0)
+	{
+		return;
+	}
+
+	if(iteration != snapshot_last_iteration)
+	{
+		snapshot_write(iteration, temperature, dt);
+	}
+	for(int s = 0; s < 2; s++)
+	{
+		snapshot_retire(&snapshot_stages[s]);
+	}
+
+	int my_rank = 0;
+	#ifdef VERSION_RUN_IS_MPI
+		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+		for(int s = 0; s < 2; s++)
+		{
+			free(snapshot_stages[s].buffer);
+			snapshot_stages[s].buffer = NULL;
+		}
+		MPI_Type_free(&snapshot_file_tile);
+	#endif
+	if(my_rank == 0)
+	{
+		fprintf(stderr, "%d snapshots written to %s.*.\n", snapshot_count, config_snapshot_file);
+	}
+}
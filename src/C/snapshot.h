@@ -0,0 +1,57 @@
+/**
+ * @file snapshot.h
+ * @brief This file contains the snapshots of the temperatures of the CPU versions.
+ * @details Every config_snapshot_frequency iterations, and once more when the simulation stops, the temperatures are written to a file of their own, named after config_snapshot_file followed by a dot and the iteration. A snapshot is a single binary file, in the byte order of the machine that wrote it:
+ * | Content | Type |
+ * | ------- | ---- |
+ * | SNAPSHOT_MAGIC | 8 chars |
+ * | ROWS_GLOBAL, COLUMNS_GLOBAL, iteration, 0 | 4 ints |
+ * | temperature change across all MPI processes | double |
+ * | the temperatures, boundaries excluded, row by row | ROWS_GLOBAL x COLUMNS_GLOBAL doubles |
+ * so that it can be read as a raw array once the SNAPSHOT_HEADER_SIZE bytes of its header are skipped.
+ *
+ * Writing a snapshot must not stall the iterations. In the MPI versions, each MPI process copies its tile into one of two staging buffers, used by turns, and writes it with a non-blocking collective MPI-IO write through a view of the file on its tile; the write completes while the next iterations run, and is waited for only when its buffer comes round again, or at the end of the run. In the serial and OpenMP versions, the file is mapped in memory and the temperatures copied into it, after which the operating system writes the pages back in the background; the mappings of the last two snapshots are kept, and each released when its turn comes round again.
+ *
+ * Periodic snapshots are taken like progress printings, at the end of a trip of the tiling engine, see tiling.h, or of a convergence check window, see convergence.h, and at the end of a period of the mixed-precision solver, see mixed.h, which all stop at them.
+ **/
+
+#ifndef SNAPSHOT_H_INCLUDED
+#define SNAPSHOT_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+/// The first bytes of a snapshot.
+#define SNAPSHOT_MAGIC "LAPLACES"
+/// The size of the header of a snapshot, in bytes.
+#define SNAPSHOT_HEADER_SIZE 32
+
+/**
+ * @brief Prepares the snapshots, if config_snapshot_frequency is set.
+ * @pre In the MPI versions, decomposition_initialise() has been called, and it is called by all MPI processes.
+ **/
+void snapshot_initialise(void);
+/**
+ * @brief Tells whether a snapshot is due at an iteration.
+ * @param[in] iteration The iteration.
+ * @return 1 if snapshots are enabled and \p iteration is a multiple of config_snapshot_frequency, 0 otherwise.
+ **/
+int snapshot_due(int iteration);
+/**
+ * @brief Starts writing a snapshot, and returns as soon as the temperatures are copied.
+ * @param[in] iteration The iteration completed.
+ * @param[in] temperature The temperatures of that iteration; their halos are not read.
+ * @param[in] dt The temperature change of that iteration, across all MPI processes.
+ * @pre It is called by a single OpenMP thread and, in the MPI versions, by all MPI processes.
+ **/
+void snapshot_write(int iteration, double temperature[ROWS+2][COLUMNS+2], double dt);
+/**
+ * @brief Writes the snapshot of the iteration at which the simulation stopped, unless written already, and completes the writes in progress.
+ * @details The number of snapshots written is reported on the standard error, so that the output stays comparable.
+ * @param[in] iteration The iteration at which the simulation stopped.
+ * @param[in] temperature The temperatures the simulation stopped with.
+ * @param[in] dt The temperature change when the simulation stopped.
+ * @pre It is called outside of any OpenMP parallel region and, in the MPI versions, by all MPI processes.
+ **/
+void snapshot_finalise(int iteration, double temperature[ROWS+2][COLUMNS+2], double dt);
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file stream.c
+ * @brief Contains a STREAM-style measurement of the memory bandwidth, used as the baseline of benchmark.sh.
+ * @details The copy and triad kernels of STREAM are run over arrays far larger than the caches, by all OpenMP threads if compiled with OpenMP, and the best of several repetitions is kept. Like STREAM, only the bytes explicitly read and written are counted: 16 per element for the copy, which matches the traffic of the stencil counted by profile.h, and 24 for the triad.
+ **/
+
+// clock_gettime is POSIX, not C99
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h> // printf
+#include <stdlib.h> // malloc, free, strtol, EXIT_SUCCESS, EXIT_FAILURE
+#include <time.h> // clock_gettime
+
+/// Number of elements of each array, unless given on the command line; 3 arrays of 80 MB.
+#define STREAM_DEFAULT_ELEMENTS 10000000L
+/// Number of times each kernel is run; the first run only warms up.
+#define STREAM_REPETITIONS 10
+
+/**
+ * @brief Gives the current time.
+ * @return The current time in seconds, from an arbitrary origin.
+ **/
+static double stream_now(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Measures the bandwidth.
+ * @details The number of elements per array can be given as the only argument. The bandwidths are printed one per line, as 'copy_gbs X' and 'triad_gbs Y', so that scripts can read them.
+ **/
+int main(int argc, char* argv[])
+{
+	long elements = argc > 1 ? strtol(argv[1], NULL, 10) : STREAM_DEFAULT_ELEMENTS;
+	if(elements <= 0)
+	{
+		printf("The number of elements must be a strictly positive integer.\n");
+		return EXIT_FAILURE;
+	}
+
+	double* a = malloc(sizeof(double) * elements);
+	double* b = malloc(sizeof(double) * elements);
+	double* c = malloc(sizeof(double) * elements);
+	if(a == NULL || b == NULL || c == NULL)
+	{
+		printf("Failed to allocate the arrays.\n");
+		return EXIT_FAILURE;
+	}
+
+	// First touch by the threads that use the pages afterwards
+	#pragma omp parallel for schedule(static)
+	for(long i = 0; i < elements; i++)
+	{
+		a[i] = 1.0;
+		b[i] = 2.0;
+		c[i] = 0.0;
+	}
+
+	double best_copy = 1e300;
+	double best_triad = 1e300;
+	for(int r = 0; r < STREAM_REPETITIONS; r++)
+	{
+		double start = stream_now();
+		#pragma omp parallel for schedule(static)
+		for(long i = 0; i < elements; i++)
+		{
+			c[i] = a[i];
+		}
+		double copy = stream_now() - start;
+
+		start = stream_now();
+		#pragma omp parallel for schedule(static)
+		for(long i = 0; i < elements; i++)
+		{
+			c[i] = a[i] + 3.0 * b[i];
+		}
+		double triad = stream_now() - start;
+
+		if(r > 0)
+		{
+			best_copy = copy < best_copy ? copy : best_copy;
+			best_triad = triad < best_triad ? triad : best_triad;
+		}
+	}
+
+	// Use the results, so that the kernels are not optimised away
+	if(c[elements / 2] != 7.0)
+	{
+		printf("The triad gave %f instead of 7.\n", c[elements / 2]);
+		return EXIT_FAILURE;
+	}
+
+	printf("copy_gbs %.3f\n", 16.0 * elements / best_copy / 1e9);
+	printf("triad_gbs %.3f\n", 24.0 * elements / best_triad / 1e9);
+
+	free(a);
+	free(b);
+	free(c);
+
+	return EXIT_SUCCESS;
+}
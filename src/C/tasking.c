@@ -0,0 +1,133 @@
+/**
+ * @file tasking.c
+ **/
+
+#include "tasking.h"
+#include "tiling.h"
+#include "kernel.h"
+#include "profile.h"
+#include "front.h"
+#include <math.h> // fmax
+#include <stdio.h> // printf
+#include <stdlib.h> // malloc, free, EXIT_FAILURE
+
+/// The number of blocks the rows are split into.
+static int tasking_block_count = 0;
+/// The maximal temperature change of each block at each iteration of a trip, in two sets used by turns.
+static double* tasking_dt_blocks = NULL;
+/// One element per block and per parity, plus one before and after the blocks, that the dependencies of tasks name.
+static char* tasking_dependencies = NULL;
+/// The number of trips made so far by my OpenMP thread, which tells the set of temperature changes to use.
+static unsigned int tasking_round;
+#pragma omp threadprivate(tasking_round)
+
+/**
+ * @brief Computes a block of rows at an iteration.
+ * @param[out] to The grid in which to compute the iteration.
+ * @param[in] from The grid containing the temperatures of the iteration before.
+ * @param[in] front_iteration The iteration computed, which tells the cells left out.
+ * @param[in] block The block.
+ * @return The maximal temperature change of the block.
+ **/
+static double tasking_block(double to[ROWS+2][COLUMNS+2], double from[ROWS+2][COLUMNS+2], unsigned int front_iteration, int block)
+{
+	double profile_start = profile_now();
+	long cells = 0;
+	int i_first = 1 + block * TASKING_BLOCK_ROWS;
+	int i_final = (i_first + TASKING_BLOCK_ROWS - 1 < ROWS) ? i_first + TASKING_BLOCK_ROWS - 1 : ROWS;
+	double dt = kernel_tile(to, from, i_first, i_final, 1, COLUMNS, front_iteration, &cells);
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+	return dt;
+}
+
+void tasking_initialise(void)
+{
+	tasking_round = 0;
+
+	#pragma omp single
+	{
+		tasking_block_count = (ROWS + TASKING_BLOCK_ROWS - 1) / TASKING_BLOCK_ROWS;
+		tasking_dt_blocks = malloc(sizeof(double) * 2 * TILE_DEPTH * tasking_block_count);
+		tasking_dependencies = malloc(sizeof(char) * 2 * (tasking_block_count + 2));
+		if(tasking_dt_blocks == NULL || tasking_dependencies == NULL)
+		{
+			printf("Failed to allocate the tasking buffers.\n");
+			exit(EXIT_FAILURE);
+		}
+	} // End of OpenMP single region, whose implicit barrier publishes the buffers
+}
+
+void tasking_advance(double last[ROWS+2][COLUMNS+2], double current[ROWS+2][COLUMNS+2], double spare[ROWS+2][COLUMNS+2], unsigned int iteration, unsigned int depth, double dt[])
+{
+	int block_count = tasking_block_count;
+
+	// Temperature changes alternate between two sets from one trip to the next, so that the tasks of a trip do not
+	// overwrite them before all threads have read those of the trip before
+	double* dt_blocks = tasking_dt_blocks + (tasking_round % 2) * TILE_DEPTH * block_count;
+	tasking_round++;
+
+	#pragma omp master
+	{
+		// Iteration k is written in the grid of parity k, current or spare, and the dependencies of its blocks named by the
+		// elements of that parity, which also name the blocks of last read by the first iteration. Those before the first
+		// block and after the last one are never written. Block b of iteration k is created during wave b + k - 1, after
+		// every task it depends on, and so that threads running tasks in the order they are created find the rows they
+		// read still in cache, as with the tiled engine.
+		for(int wave = 0; wave < block_count + (int)depth - 1; wave++)
+		{
+			for(unsigned int k = 1; k <= depth; k++)
+			{
+				int b = wave - (int)k + 1;
+				if(b >= 0 && b < block_count)
+				{
+					double* dt_block = dt_blocks + (k - 1) * block_count + b;
+					int written = (k % 2) * (block_count + 2) + 1 + b;
+					int read = ((k - 1) % 2) * (block_count + 2) + 1 + b;
+					#pragma omp task firstprivate(k, b, dt_block) depend(in: tasking_dependencies[read-1], tasking_dependencies[read], tasking_dependencies[read+1]) depend(out: tasking_dependencies[written])
+					{
+						if(k == 1)
+						{
+							*dt_block = tasking_block(current, last, iteration + k, b);
+						}
+						else if(k % 2 == 1)
+						{
+							*dt_block = tasking_block(current, spare, iteration + k, b);
+						}
+						else
+						{
+							*dt_block = tasking_block(spare, current, iteration + k, b);
+						}
+					} // End of OpenMP task
+				}
+			}
+		}
+	} // End of OpenMP master region
+
+	// All tasks are completed by the time the team leaves the barrier. Threads spend it running them, which is timed as
+	// the stencil, so only what follows is timed as the reduction.
+	#pragma omp barrier
+
+	double profile_start = profile_now();
+	for(unsigned int k = 0; k < depth; k++)
+	{
+		dt[k] = 0.0;
+		for(int b = 0; b < block_count; b++)
+		{
+			dt[k] = fmax(dt_blocks[k * block_count + b], dt[k]);
+		}
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+}
+
+void tasking_finalise(void)
+{
+	// Nobody may be reading the temperature changes any longer
+	#pragma omp barrier
+	#pragma omp single
+	{
+		free(tasking_dt_blocks);
+		tasking_dt_blocks = NULL;
+		free(tasking_dependencies);
+		tasking_dependencies = NULL;
+	} // End of OpenMP single region
+}
@@ -0,0 +1,44 @@
+/**
+ * @file tasking.h
+ * @brief This file contains the task-based Jacobi engine used by the OpenMP version when config_threading is CONFIG_THREADING_TASKS.
+ * @details The tiled engine of tiling.h gives every OpenMP thread the same band of rows at every trip, so a trip lasts as long as its slowest thread: one preempted or slowed down by a noisy neighbour holds all others at the barrier ending the trip. This engine advances the same trips, but splits the grid into blocks of TASKING_BLOCK_ROWS rows and makes each block of each iteration an OpenMP task. A task depends on the tasks computing the same block and its two neighbours at the iteration before, whose rows it reads, and which in turn read the rows it overwrites in the grid of the same parity two iterations before. As with the tiled engine, the grid of the iteration a trip starts from is only read. Idle threads pick the next task ready, so fast threads run ahead, iterations later if need be, rather than wait for slow ones, and neither rows are recomputed nor threads synchronised within a trip.
+ *
+ * The maximal temperature change of each block at each iteration is kept apart, and those of an iteration are combined once the trip is over, so convergence is detected at the same iteration, with the same temperatures, as with a plain sweep. Cells the heat cannot have reached are left out, see front.h.
+ **/
+
+#ifndef TASKING_H_INCLUDED
+#define TASKING_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+#ifndef TASKING_BLOCK_ROWS
+	/// Number of rows of a block, the work of a task at one iteration. It can be overriden at compilation.
+	#define TASKING_BLOCK_ROWS 32
+#endif
+
+/**
+ * @brief Allocates the buffers shared by the team.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+void tasking_initialise(void);
+/**
+ * @brief Advances the temperatures by \p depth iterations, as tasks shared out among the OpenMP threads.
+ * @details The master thread creates the tasks, so that the grids are left untouched until it is done with those of the last trip, for instance recording progress.
+ * @param[in] last The grid containing the temperatures of the last iteration. It is left untouched.
+ * @param[inout] current Another grid, whose boundaries must be set. On exit it contains the temperatures of the last odd iteration advanced.
+ * @param[inout] spare The third grid, whose boundaries must be set. On exit it contains the temperatures of the last even iteration advanced, if any.
+ * @param[in] iteration The last iteration completed, which tells the cells the heat cannot have reached and that are left out, see front.h.
+ * @param[in] depth The number of iterations to advance, between 1 and TILE_DEPTH, as picked by tiling_depth().
+ * @param[out] dt The maximal temperature change of each iteration advanced, across all blocks. Each thread passes its own array.
+ * @pre front_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, with the same arguments apart from \p dt.
+ * @post All OpenMP threads have completed the trip.
+ **/
+void tasking_advance(double last[ROWS+2][COLUMNS+2], double current[ROWS+2][COLUMNS+2], double spare[ROWS+2][COLUMNS+2], unsigned int iteration, unsigned int depth, double dt[]);
+/**
+ * @brief Frees the buffers allocated by tasking_initialise().
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+void tasking_finalise(void);
+
+#endif
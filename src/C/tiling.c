@@ -0,0 +1,234 @@
+/**
+ * @file tiling.c
+ **/
+
+#include "tiling.h"
+#include "util.h"
+#include "kernel.h"
+#include "profile.h"
+#include "front.h"
+#include <math.h> // fmax, log
+#include <stdio.h> // printf
+#include <stdlib.h> // malloc, free, EXIT_FAILURE
+#include <string.h> // memcpy
+#ifdef _OPENMP
+	#include <omp.h>
+#endif
+
+/// Distance between the temperature change slots of two OpenMP threads, in doubles, rounded up to whole cache lines.
+#define TILING_SLOT_STRIDE ((TILE_DEPTH + 7) / 8 * 8)
+
+/// The maximal temperature change of each iteration found by each OpenMP thread, in two sets used by turns.
+static double* tiling_dt_slots = NULL;
+/// The first and last rows owned by my OpenMP thread.
+static int tiling_lo, tiling_hi;
+/// The rows of each parity, and those of the iteration a trip starts from, read or written by my OpenMP thread, see tiling_advance().
+static double** tiling_rows[3];
+/// The private copies of the rows of neighbouring bands recomputed by my OpenMP thread.
+static double* tiling_redundant;
+/// The number of trips made so far by my OpenMP thread, which tells the set of slots to use.
+static unsigned int tiling_round;
+#pragma omp threadprivate(tiling_lo, tiling_hi, tiling_rows, tiling_redundant, tiling_round)
+
+unsigned int tiling_depth(unsigned int iteration, double dt_before, double dt)
+{
+	unsigned int depth = TILE_DEPTH;
+
+	// Do not go past the next progress printing, which needs the temperatures of that very iteration
+	unsigned int next_print = (iteration / PRINT_FREQUENCY + 1) * PRINT_FREQUENCY;
+	if(iteration + depth > next_print)
+	{
+		depth = next_print - iteration;
+	}
+
+	// Nor past the next snapshot
+	if(config_snapshot_frequency > 0)
+	{
+		unsigned int next_snapshot = (iteration / config_snapshot_frequency + 1) * config_snapshot_frequency;
+		if(iteration + depth > next_snapshot)
+		{
+			depth = next_snapshot - iteration;
+		}
+	}
+
+	// Nor past the last iteration allowed
+	if(iteration + depth > MAX_NUMBER_OF_ITERATIONS + 1)
+	{
+		depth = MAX_NUMBER_OF_ITERATIONS + 1 - iteration;
+	}
+
+	// The temperature change decays almost geometrically, which tells roughly how many iterations remain
+	if(depth > 1 && dt < dt_before)
+	{
+		double iterations_remaining = log(MAX_TEMP_ERROR / dt) / log(dt / dt_before);
+		if(iterations_remaining < TILING_SAFETY_FACTOR * depth)
+		{
+			depth = 1;
+		}
+	}
+
+	return depth;
+}
+
+void tiling_initialise(void)
+{
+	int thread_count = 1;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_count = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+	#endif
+
+	// Band of rows owned, identical to that of a schedule(static) loop over rows 1 to ROWS
+	int rows_per_thread = ROWS / thread_count;
+	int rows_remaining = ROWS % thread_count;
+	tiling_lo = 1 + thread_id * rows_per_thread + (thread_id < rows_remaining ? thread_id : rows_remaining);
+	tiling_hi = tiling_lo + rows_per_thread - 1 + (thread_id < rows_remaining ? 1 : 0);
+	tiling_round = 0;
+
+	// Enough for the deepest trip: the band, TILE_DEPTH rows on each side, of which all but the boundaries redundant
+	int row_count = tiling_hi - tiling_lo + 1 + 2 * TILE_DEPTH;
+	tiling_rows[0] = malloc(sizeof(double*) * 3 * row_count);
+	tiling_redundant = malloc(sizeof(double) * 2 * 2 * TILE_DEPTH * (COLUMNS + 2));
+	if(tiling_rows[0] == NULL || tiling_redundant == NULL)
+	{
+		printf("Failed to allocate the tiling buffers.\n");
+		exit(EXIT_FAILURE);
+	}
+	tiling_rows[1] = tiling_rows[0] + row_count;
+	tiling_rows[2] = tiling_rows[1] + row_count;
+
+	#pragma omp single
+	{
+		tiling_dt_slots = malloc(sizeof(double) * 2 * thread_count * TILING_SLOT_STRIDE);
+		if(tiling_dt_slots == NULL)
+		{
+			printf("Failed to allocate the tiling buffers.\n");
+			exit(EXIT_FAILURE);
+		}
+	} // End of OpenMP single region, whose implicit barrier publishes the slots
+}
+
+void tiling_advance(double last[ROWS+2][COLUMNS+2], double current[ROWS+2][COLUMNS+2], double spare[ROWS+2][COLUMNS+2], unsigned int iteration, unsigned int depth, double dt[])
+{
+	int thread_count = 1;
+	int thread_id = 0;
+	#ifdef _OPENMP
+		thread_count = omp_get_num_threads();
+		thread_id = omp_get_thread_num();
+	#endif
+	int lo = tiling_lo;
+	int hi = tiling_hi;
+	double profile_start = profile_now();
+
+	// Rows read or written during the trip, redundant rows from neighbouring bands included
+	int first = lo - (int)depth > 0 ? lo - (int)depth : 0;
+	int final = hi + (int)depth < ROWS + 1 ? hi + (int)depth : ROWS + 1;
+
+	// Rows of each parity and of the iteration the trip starts from; owned and boundary rows point to the grids,
+	// redundant rows to a private copy, that of the iteration the trip starts from being overwritten by even iterations
+	double** rows[2] = {tiling_rows[0], tiling_rows[1]};
+	double** start = tiling_rows[2];
+	double* next_redundant = tiling_redundant;
+	for(int r = first; r <= final; r++)
+	{
+		if((r < lo && r > 0) || (r > hi && r <= ROWS))
+		{
+			rows[0][r - first] = next_redundant;
+			rows[1][r - first] = next_redundant + COLUMNS + 2;
+			start[r - first] = rows[0][r - first];
+			next_redundant += 2 * (COLUMNS + 2);
+			memcpy(rows[0][r - first], last[r], sizeof(double) * (COLUMNS + 2));
+			memcpy(rows[1][r - first], current[r], sizeof(double) * (COLUMNS + 2));
+		}
+		else
+		{
+			rows[0][r - first] = spare[r];
+			rows[1][r - first] = current[r];
+			start[r - first] = last[r];
+		}
+	}
+
+	// Neighbouring bands must be copied before their owners start overwriting them
+	#pragma omp barrier
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+	profile_start = profile_now();
+
+	// Maximal temperature change of each iteration across the rows owned, in the slots of my thread
+	double* slots = tiling_dt_slots + (tiling_round % 2) * thread_count * TILING_SLOT_STRIDE;
+	tiling_round++;
+	double* dt_local = slots + thread_id * TILING_SLOT_STRIDE;
+	for(unsigned int k = 0; k < depth; k++)
+	{
+		dt_local[k] = 0.0;
+	}
+
+	// Row r of iteration k is computed during wave r + k - 1, after rows r - 1 to r + 1 of iteration k - 1 and
+	// before row r of iteration k - 2 is needed by nobody. The band shrinks by one row on each side per iteration.
+	long cells = 0;
+	int wave_first = lo - (int)depth + 1 > 1 ? lo - (int)depth + 1 : 1;
+	int wave_final = hi + (int)depth - 1;
+	for(int wave = wave_first; wave <= wave_final; wave++)
+	{
+		for(int k = 1; k <= (int)depth; k++)
+		{
+			int r = wave - k + 1;
+			int r_first = lo - ((int)depth - k) > 1 ? lo - ((int)depth - k) : 1;
+			int r_final = hi + ((int)depth - k) < ROWS ? hi + ((int)depth - k) : ROWS;
+			// The rows are not those of a grid, so the row is computed from the first column the heat may have reached
+			// like kernel_tile() would
+			int c = front_first_column(iteration + k, r);
+			if(r >= r_first && r <= r_final && c <= COLUMNS)
+			{
+				double** from = (k == 1) ? start : rows[(k - 1) % 2];
+				double dt_row = KERNEL_SPAN(kernel_row, rows[k % 2][r - first], from[r - 1 - first], from[r - first], from[r + 1 - first], c, COLUMNS);
+				if(r >= lo && r <= hi)
+				{
+					dt_local[k - 1] = fmax(dt_row, dt_local[k - 1]);
+					cells += COLUMNS - c + 1;
+				}
+			}
+		}
+	}
+
+	profile_add(PROFILE_STENCIL, profile_start, cells);
+	profile_start = profile_now();
+
+	// A single barrier, after which every thread combines the slots of all. Slots alternate between two sets from one
+	// trip to the next, so that they are not overwritten before all threads have read them.
+	#pragma omp barrier
+
+	for(unsigned int k = 0; k < depth; k++)
+	{
+		dt[k] = 0.0;
+		for(int t = 0; t < thread_count; t++)
+		{
+			dt[k] = fmax(slots[t * TILING_SLOT_STRIDE + k], dt[k]);
+		}
+	}
+	profile_add(PROFILE_REDUCTION, profile_start, 0);
+}
+
+void tiling_rewind(double last[ROWS+2][COLUMNS+2], double current[ROWS+2][COLUMNS+2], double spare[ROWS+2][COLUMNS+2])
+{
+	#pragma omp for schedule(static)
+	for(int i = 0; i <= ROWS + 1; i++)
+	{
+		memcpy(current[i], last[i], sizeof(double) * (COLUMNS + 2));
+		memcpy(spare[i], last[i], sizeof(double) * (COLUMNS + 2));
+	}
+}
+
+void tiling_finalise(void)
+{
+	free(tiling_redundant);
+	free(tiling_rows[0]);
+
+	// Nobody may be reading the slots any longer
+	#pragma omp barrier
+	#pragma omp single
+	{
+		free(tiling_dt_slots);
+		tiling_dt_slots = NULL;
+	} // End of OpenMP single region
+}
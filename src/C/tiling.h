@@ -0,0 +1,66 @@
+/**
+ * @file tiling.h
+ * @brief This file contains the temporally tiled Jacobi engine used by the serial and OpenMP versions.
+ * @details Instead of streaming the whole grid once per iteration, the engine advances several iterations in a single trip through the grid. It uses a wavefront time-skewing: when row r of iteration k is computed, rows r-1 to r+1 of iteration k-1 are still in cache. Iteration k is written in the grid of parity k, over iteration k-2 which is no longer needed by then. The grid of the iteration a trip starts from is only read, even iterations being written in a third grid, so that a trip that went past the iteration at which convergence is reached can be advanced again, up to that iteration only.
+ *
+ * Each OpenMP thread owns the same band of rows as with a schedule(static) loop. The rows of neighbouring bands that it needs are recomputed redundantly in a private buffer, the band widened by one row on each side per iteration remaining, so that threads only synchronise at the start and at the end of each trip. The engine does not open parallel regions itself: its functions are called by every thread of the team from within a single parallel region covering the whole simulation, or outside any in the serial version.
+ *
+ * The maximal temperature change of every iteration advanced is computed exactly, so convergence is detected at the same iteration as with a plain sweep.
+ **/
+
+#ifndef TILING_H_INCLUDED
+#define TILING_H_INCLUDED
+
+#include "config.h" // ROWS, COLUMNS
+
+#ifndef TILE_DEPTH
+	/// Maximum number of iterations advanced in a single trip through the grid. It can be overriden at compilation.
+	#define TILE_DEPTH 8
+#endif
+/// A trip through the grid is reduced to one iteration once convergence is predicted to be less than this many trips away.
+#define TILING_SAFETY_FACTOR 4
+
+/**
+ * @brief Picks the number of iterations to advance in the next trip through the grid.
+ * @details The depth is bounded by TILE_DEPTH, by the next iteration at which progress is printed, by the next snapshot and by the maximum number of iterations. It falls back to 1 when the decay of the temperature change predicts convergence within the next few trips, so that trips going past the iteration at which convergence is reached, and advanced again up to it, are rare. The decay is not known before the second iteration, so the first trip is never shortened this way.
+ * @param[in] iteration The last iteration completed.
+ * @param[in] dt_before The maximal temperature change of the iteration before the last one.
+ * @param[in] dt The maximal temperature change of the last iteration.
+ * @return The number of iterations to advance, between 1 and TILE_DEPTH.
+ **/
+unsigned int tiling_depth(unsigned int iteration, double dt_before, double dt);
+/**
+ * @brief Allocates the buffers of my OpenMP thread and those shared by the team.
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+void tiling_initialise(void);
+/**
+ * @brief Advances the temperatures by \p depth iterations in a single trip through the grid.
+ * @param[in] last The grid containing the temperatures of the last iteration. It is left untouched.
+ * @param[inout] current Another grid, whose boundaries must be set. On exit it contains the temperatures of the last odd iteration advanced.
+ * @param[inout] spare The third grid, whose boundaries must be set. On exit it contains the temperatures of the last even iteration advanced, if any.
+ * @param[in] iteration The last iteration completed, which tells the cells the heat cannot have reached and that are left out, see front.h.
+ * @param[in] depth The number of iterations to advance, between 1 and TILE_DEPTH.
+ * @param[out] dt The maximal temperature change of each iteration advanced, across all OpenMP threads. Each thread passes its own array.
+ * @pre front_initialise() has been called.
+ * @pre It is called by all OpenMP threads of the team, with the same arguments apart from \p dt.
+ * @post All OpenMP threads have completed the trip.
+ **/
+void tiling_advance(double last[ROWS+2][COLUMNS+2], double current[ROWS+2][COLUMNS+2], double spare[ROWS+2][COLUMNS+2], unsigned int iteration, unsigned int depth, double dt[]);
+/**
+ * @brief Copies the temperatures of the iteration a trip started from into the two other grids, before the trip is advanced again up to an earlier iteration.
+ * @details The cells the heat has not reached are left out, so they must hold 0 in the grids written, which is no longer the case once a trip went past the iteration advanced again. The tasks engine of tasking.h uses it too.
+ * @param[in] last The grid containing the temperatures the trip started from.
+ * @param[out] current The grid in which the trip wrote odd iterations.
+ * @param[out] spare The grid in which the trip wrote even iterations.
+ * @pre It is called by all OpenMP threads of the team.
+ * @post All OpenMP threads have completed the copy.
+ **/
+void tiling_rewind(double last[ROWS+2][COLUMNS+2], double current[ROWS+2][COLUMNS+2], double spare[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Frees the buffers allocated by tiling_initialise().
+ * @pre It is called by all OpenMP threads of the team.
+ **/
+void tiling_finalise(void);
+
+#endif
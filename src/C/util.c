@@ -3,74 +3,89 @@
  **/
 
 #include "util.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h> // gettimeofday
-#include <string.h> // memcpy
 #ifdef VERSION_RUN_IS_MPI
 	#include <mpi.h>
+	#include "decomposition.h"
 #endif
 
 void initialise_temperatures(double temperature[ROWS+2][COLUMNS+2], double temperature_last[ROWS+2][COLUMNS+2])
 {
-	//////////////////////////////////////
-	// Previous iteration temperatures //
-	////////////////////////////////////
-	#ifdef VERSION_RUN_IS_MPI
-		// Retrieve my MPI information
-		int my_rank;
-		MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
-		int comm_size;
-		MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
-
-	    for(int i = 0; i <= ROWS+1; i++)
-	    {
-	        for(int j = 0; j <= COLUMNS+1; j++)
-	        {
-	            temperature_last[i][j] = 0.0;
-	        }
-	    }
+	// Both grids are filled directly instead of copying one into the other. Rows 1 to ROWS are filled by the OpenMP
+	// threads using the same static partitioning as the calculation loops, so that each row stays on the NUMA node of
+	// the thread that computes it.
 
-	    // Local boundry condition endpoints
-	    double tMin = (my_rank) * 100.0 / comm_size;
-	    double tMax = (my_rank+1) * 100.0 / comm_size;
+	// Default all values to 0.
+	#pragma omp parallel for schedule(static)
+	for(int i = 1; i <= ROWS; i++)
+	{
+		for(int j = 0; j <= COLUMNS+1; j++)
+		{
+			temperature_last[i][j] = 0.0;
+			temperature[i][j] = 0.0;
+		}
+	}
+	for(int j = 0; j <= COLUMNS+1; j++)
+	{
+		temperature_last[0][j] = 0.0;
+		temperature[0][j] = 0.0;
+		temperature_last[ROWS+1][j] = 0.0;
+		temperature[ROWS+1][j] = 0.0;
+	}
 
-	    // Left and right boundaries
+	#ifdef VERSION_RUN_IS_MPI
+		// Retrieve the position of my tile in the process grid
+		int process_row = decomposition_coordinates[0];
+		int process_rows = decomposition_dimensions[0];
+		int row_offset = decomposition_offsets[0];
+		int column_offset = decomposition_offsets[1];
+		int process_column = decomposition_coordinates[1];
+		int process_columns = decomposition_dimensions[1];
+
+	    // Local boundry condition endpoints, from the global rows spanned by my tile
+	    double tMin = (row_offset) * 100.0 / ROWS_GLOBAL;
+	    double tMax = (row_offset+ROWS) * 100.0 / ROWS_GLOBAL;
+
+	    // Left and right boundaries (for the first and last MPI processes of each row only), other tiles have halos there
 	    for(int i = 0; i <= ROWS+1; i++)
 	    {
-			temperature_last[i][0] = 0.0;
-			temperature_last[i][COLUMNS+1] = tMin + ((tMax-tMin)/ROWS)*i;
+			if(process_column == 0)
+			{
+				temperature_last[i][0] = 0.0;
+				temperature[i][0] = temperature_last[i][0];
+			}
+			if(process_column == process_columns - 1)
+			{
+				temperature_last[i][COLUMNS+1] = tMin + ((tMax-tMin)/ROWS)*i;
+				temperature[i][COLUMNS+1] = temperature_last[i][COLUMNS+1];
+			}
 	    }
 
-	    // Top boundary (for first MPI process only)
-	    if(my_rank == 0)
+	    // Top boundary (for the first row of MPI processes only)
+	    if(process_row == 0)
 	    {
 			for(int j = 0; j <= COLUMNS+1; j++)
 			{
 				temperature_last[0][j] = 0.0;
+				temperature[0][j] = 0.0;
 			}
 	    }
 
-	    // Bottom boundary (for last MPI process only)
-	    if(my_rank == comm_size - 1)
+	    // Bottom boundary (for the last row of MPI processes only), continuing the slope of the tiles on the left
+	    if(process_row == process_rows - 1)
 	    {
 			for(int j = 0; j <= COLUMNS + 1; j++)
 			{
-				temperature_last[ROWS+1][j] = (100.0 / COLUMNS) * j;
+				temperature_last[ROWS+1][j] = (100.0 / COLUMNS_GLOBAL) * (column_offset + j);
+				temperature[ROWS+1][j] = temperature_last[ROWS+1][j];
 			}
 	    }
 	#else
 		int i, j;
 
-		// Default all values to 0.
-		for(i = 0; i <= ROWS+1; i++)
-		{
-			for(j = 0; j <= COLUMNS+1; j++)
-			{
-				temperature_last[i][j] = 0.0;
-			}
-		}
-
 		// NOTE: these boundary conditions never change throughout the run
 
 		// Set left side to 0 and right to a linear increase
@@ -78,6 +93,8 @@ void initialise_temperatures(double temperature[ROWS+2][COLUMNS+2], double tempe
 		{
 			temperature_last[i][0] = 0.0;
 			temperature_last[i][COLUMNS+1] = (100.0/ROWS)*i;
+			temperature[i][0] = temperature_last[i][0];
+			temperature[i][COLUMNS+1] = temperature_last[i][COLUMNS+1];
 		}
 
 		// Set top to 0 and bottom to linear increase
@@ -85,14 +102,11 @@ void initialise_temperatures(double temperature[ROWS+2][COLUMNS+2], double tempe
 		{
 			temperature_last[0][j] = 0.0;
 			temperature_last[ROWS+1][j] = (100.0/COLUMNS)*j;
+			temperature[0][j] = temperature_last[0][j];
+			temperature[ROWS+1][j] = temperature_last[ROWS+1][j];
 		}
 	#endif
 
-	/////////////////////////////////////
-	// Current iteration temperatures //
-	///////////////////////////////////
-	memcpy(temperature, temperature_last, sizeof(double) * (ROWS + 2) * (COLUMNS + 2));
-
 	#ifdef VERSION_RUN_IS_MPI
 		MPI_Barrier(MPI_COMM_WORLD);
 	#endif
@@ -100,14 +114,25 @@ void initialise_temperatures(double temperature[ROWS+2][COLUMNS+2], double tempe
 
 void track_progress(int iteration, double temperature[ROWS+2][COLUMNS+2])
 {
-	int number_of_cells = 6;
-	if(iteration == 100)
+	double cells[TRACKED_CELLS];
+	for(int i = TRACKED_CELLS; i > 0; i--)
+	{
+		cells[TRACKED_CELLS-i] = temperature[ROWS-i+1][COLUMNS-i+1];
+	}
+	print_progress(iteration, cells);
+}
+
+void print_progress(int iteration, const double cells[TRACKED_CELLS])
+{
+	double profile_start = profile_now();
+	int number_of_cells = TRACKED_CELLS;
+	if(iteration == PRINT_FREQUENCY)
 	{
 		printf("ITERATION NUMBER");
 		for(int i = number_of_cells; i > 0; i--)
 		{
 			#ifdef VERSION_RUN_IS_MPI
-				printf(" | [%5d,%5d]", ROWS_GLOBAL-i, COLUMNS-i);
+				printf(" | [%5d,%5d]", ROWS_GLOBAL-i, COLUMNS_GLOBAL-i);
 			#else
 				printf(" | [%5d,%5d]", ROWS-i, COLUMNS-i);
 			#endif
@@ -123,9 +148,10 @@ void track_progress(int iteration, double temperature[ROWS+2][COLUMNS+2])
 	printf("ITERATION %6d", iteration);
 	for(int i = number_of_cells; i > 0; i--)
 	{
-		printf(" |         %2.2f", temperature[ROWS-i+1][COLUMNS-i+1]);
+		printf(" |         %2.2f", cells[number_of_cells-i]);
 	}
 	printf("\n");
+	profile_add(PROFILE_PROGRESS, profile_start, 0);
 }
 
 void print_summary(int iteration, double dt, double timer_simulation)
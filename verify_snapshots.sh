@@ -0,0 +1,124 @@
+#!/bin/bash
+
+################################################################################
+# READ ME                                                                      #
+#------------------------------------------------------------------------------#
+# MOTIVATION                                                                   #
+# The reference outputs only cover a few cells, every 100 iterations, at the   #
+# default tolerance. The serial and OpenMP versions advance several iterations #
+# per trip through the grid and must leave the temperatures of the iteration   #
+# at which convergence is reached, even when it falls in the middle of a trip, #
+# which the MPI versions find through convergence check windows instead. This  #
+# script checks that every C CPU version ends on the same temperatures as the  #
+# MPI version, cell by cell, for tolerances reached in the middle of a trip.   #
+#                                                                              #
+# HOW IT WORKS                                                                 #
+# Each version runs on the small grid for each tolerance and writes a snapshot #
+# of the temperatures reached, see src/C/snapshot.h. Every snapshot must have  #
+# the same size and iteration as that of the MPI version, and no cell may      #
+# differ from it by more than a rounding error.                                #
+#                                                                              #
+# PARAMETERS                                                                   #
+# They are all optional environment variables:                                 #
+# - VERIFY_TOLERANCES: tolerances to run, '9 8 0.5 0.01'. The first two       #
+#   converge at iterations 4 and 5, in the middle of the first trip, which     #
+#   advances 8 iterations; the others at iterations 71 and 3264.               #
+# - VERIFY_MAX_DIFFERENCE: largest difference allowed on a cell, '1e-9'.       #
+# - VERIFY_MPIRUN: command launching MPI processes, 'mpirun'.                  #
+#                                                                              #
+# EXAMPLES                                                                     #
+# make verify_snapshots                                                        #
+# VERIFY_TOLERANCES="2 1" ./verify_snapshots.sh                                #
+################################################################################
+
+function echo_good
+{
+	echo -e "\033[32m$1\033[0m\c"
+}
+
+function echo_bad
+{
+	echo -e "\033[31m$1\033[0m\c"
+}
+
+function echo_success
+{
+	echo_good "[SUCCESS]"
+	echo " $1"
+}
+
+function echo_failure
+{
+	echo_bad "[FAILURE]"
+	echo " $1"
+	exit -1
+}
+
+tolerances=${VERIFY_TOLERANCES:-"9 8 0.5 0.01"};
+max_difference=${VERIFY_MAX_DIFFERENCE:-"1e-9"};
+mpirun=${VERIFY_MPIRUN:-"mpirun"};
+directory=`mktemp -d`;
+trap "rm -rf ${directory}" EXIT;
+
+# Prints the rows, columns and iteration of a snapshot.
+# Parameters: the snapshot.
+function snapshot_header
+{
+	od -A n -v -t d4 -j 8 -N 12 "$1" | awk '{ print $1, $2, $3 }';
+}
+
+# Prints the largest difference between the temperatures of two snapshots.
+# Parameters: the two snapshots.
+function snapshot_difference
+{
+	paste <(od -A n -v -w8 -t f8 -j 32 "$1") <(od -A n -v -w8 -t f8 -j 32 "$2") | awk '{
+		difference = $1 - $2;
+		if(difference < 0) difference = -difference;
+		if(difference > largest) largest = difference;
+	} END { printf("%.3g", largest); }';
+}
+
+for version in serial openmp mpi hybrid_cpu; do
+	if [ ! -f "./bin/C/${version}_small" ]; then
+		echo_failure "The executable ./bin/C/${version}_small does not exist, please run 'make verify_snapshots'.";
+	fi
+done
+
+# Runs a version and prints the snapshot it wrote once the simulation was over, or nothing if it failed.
+# Parameters: a name for the run, the command to run, then the tolerance.
+function run
+{
+	local file="${directory}/$1_$3";
+	if ! eval $2 --tolerance $3 --snapshot-frequency 1000000 --snapshot-file ${file} > /dev/null 2>&1; then
+		return;
+	fi
+	ls ${file}.* 2> /dev/null | head -n 1;
+}
+
+for tolerance in ${tolerances}; do
+	reference=`run mpi "${mpirun} -n 4 ./bin/C/mpi_small" ${tolerance}`;
+	if [ -z "${reference}" ]; then
+		echo_failure "The MPI run with a tolerance of ${tolerance} failed or wrote no snapshot.";
+	fi
+	reference_header=`snapshot_header ${reference}`;
+
+	for configuration in "serial:./bin/C/serial_small" \
+	                     "openmp:OMP_NUM_THREADS=4 ./bin/C/openmp_small" \
+	                     "openmp_tasks:OMP_NUM_THREADS=4 ./bin/C/openmp_small --threading tasks" \
+	                     "hybrid_cpu:${mpirun} -n 2 -x OMP_NUM_THREADS=2 ./bin/C/hybrid_cpu_small"; do
+		name=${configuration%%:*};
+		snapshot=`run ${name} "${configuration#*:}" ${tolerance}`;
+		if [ -z "${snapshot}" ]; then
+			echo_failure "The ${name} run with a tolerance of ${tolerance} failed or wrote no snapshot.";
+		fi
+		header=`snapshot_header ${snapshot}`;
+		if [ "${header}" != "${reference_header}" ]; then
+			echo_failure "The ${name} snapshot with a tolerance of ${tolerance} has rows, columns and iteration ${header}, the MPI one ${reference_header}.";
+		fi
+		difference=`snapshot_difference ${snapshot} ${reference}`;
+		if [ `awk -v d=${difference} -v m=${max_difference} 'BEGIN { print (d <= m) ? 1 : 0 }'` -ne "1" ]; then
+			echo_failure "The ${name} snapshot with a tolerance of ${tolerance} differs from the MPI one by up to ${difference}.";
+		fi
+		echo_success "The ${name} snapshot with a tolerance of ${tolerance} matches the MPI one at iteration ${header##* }, within ${difference}.";
+	done
+done